@@ -0,0 +1,18 @@
+/*
+ * icelake.test.c -- test if -march=icelake-server works
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdint.h>
+#include <immintrin.h>
+
+int main(int argc, char *argv[])
+{
+  (void)argv;
+  __m512i argc512 = _mm512_set1_epi8((char)argc);
+  __m512i compressed = _mm512_maskz_compress_epi8((__mmask64)argc, argc512);
+  return (int)_mm512_cmpeq_epi8_mask(compressed, _mm512_set1_epi8(11));
+}
@@ -0,0 +1,18 @@
+/*
+ * neon.test.c -- test if NEON intrinsics are available
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdint.h>
+#include <arm_neon.h>
+
+int main(int argc, char *argv[])
+{
+  (void)argv;
+  uint8x16_t argc8x16 = vdupq_n_u8((uint8_t)argc);
+  uint8x16_t r = vceqq_u8(argc8x16, vdupq_n_u8(11));
+  return vgetq_lane_u8(vpaddq_u8(r, r), 0);
+}
@@ -0,0 +1,20 @@
+/*
+ * vector.test.c -- test if GCC/Clang vector extensions work
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdint.h>
+
+typedef uint8_t uint8x16_t __attribute__((vector_size(16)));
+typedef uint64_t uint64x2_t __attribute__((vector_size(16)));
+
+int main(int argc, char *argv[])
+{
+  (void)argv;
+  uint8x16_t argc8x16 = { (uint8_t)argc };
+  uint64x2_t r = (uint64x2_t)(argc8x16 == 11) >> 7;
+  return (int)(r[0] + (uint64_t)__builtin_ctzll(r[1] | 1));
+}
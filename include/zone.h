@@ -278,8 +278,8 @@ extern "C" {
  * bytes in a single block.
  *
  * @warning The input buffer to @zone_parse_string is required to be
- *          null-terminated and padded, which is somewhat counter intuitive. A
- *          future release may lift this requirement (@issue{174}).
+ *          null-terminated and padded, which is somewhat counter intuitive.
+ *          Use @zone_parse_buffer for input that is not (@issue{174}).
  */
 #define ZONE_BLOCK_SIZE (64)
 
@@ -321,6 +321,38 @@ struct zone_rdata_buffer {
  */
 #define ZONE_TAPE_SIZE ((100 * ZONE_BLOCK_SIZE) + ZONE_BLOCK_SIZE)
 
+/**
+ * @brief Source of input other than a file.
+ *
+ * Readers allow for parsing input from sources that are not accessible as
+ * a file, e.g. the output of a custom decompression or decryption layer or
+ * an object store, without copying through a pipe. Applications typically
+ * embed the reader in a structure that holds state for the source.
+ */
+typedef struct zone_reader zone_reader_t;
+struct zone_reader {
+  /** Read at most size bytes into data. */
+  /** Store the number of bytes read in count, zero signals end of input.
+      Reads are repeated until the window is filled, short reads are
+      allowed. Returns zero on success or a negative number (e.g. @ref
+      ZONE_READ_ERROR) on error. */
+  int32_t (*read)(zone_reader_t *, char *data, size_t size, size_t *count);
+  /** Hand over input in its entirety without copying, optional. */
+  /** Store the address and length of the input in data and length and
+      return a positive number if input is available in a single buffer.
+      The buffer must be null-terminated and padded with at least @ref
+      ZONE_BLOCK_SIZE bytes and remain valid until the reader is closed.
+      Return zero to have the parser read the input instead. */
+  int32_t (*map)(zone_reader_t *, const char **data, size_t *length);
+  /** Invoked once the parser is done with the reader, optional. */
+  void (*close)(zone_reader_t *);
+  /** Preferred number of bytes per read, zero for default. */
+  /** Windows are allocated to hold at least this many bytes (up to an
+      implementation defined maximum) so that the reader is asked for large
+      reads. Reads start where unread data in the window ends. */
+  size_t window_size;
+};
+
 typedef struct zone_file zone_file_t;
 struct zone_file {
   /** @private */
@@ -354,17 +386,61 @@ struct zone_file {
   /** @private */
   FILE *handle;
   /** @private */
+  zone_reader_t *reader;
+  /** @private */
   bool grouped;
   /** @private */
+  /** buffer is a read-only mapping of the file, not an allocated window */
+  bool mapped;
+  /** @private */
+  /** buffer is handed over by the reader, not an allocated window */
+  bool borrowed;
+  /** @private */
+  /** window mapped twice back-to-back, buffer data points into ring */
+  struct { char *data; size_t size; } ring;
+  /** @private */
+  struct zone_read_ahead *read_ahead;
+  /** @private */
+  struct zone_decompressor *decompressor;
+  /** @private */
+  /** scanner that fills tapes ahead of the parser, see pipeline option */
+  struct zone_pipeline *pipeline;
+  /** @private */
+  /** number of bytes read and offset at which the page cache was dropped */
+  struct { uint64_t offset, dropped; } cache;
+  /** @private */
   bool start_of_line;
   /** @private */
   uint8_t end_of_file;
   /** @private */
   struct {
     size_t index, length, size;
+    /** number of consecutive refills window was larger than required */
+    size_t oversized;
+    /** size the window shrinks back to */
+    size_t minimum;
     char *data;
   } buffer;
   /** @private */
+  /** input pushed by the application, see @ref zone_stream_feed */
+  struct {
+    bool open, finished;
+    const char *data;
+    size_t length;
+    /** start of record to resume from if more input is required */
+    const char *restart;
+    /** tokens of that record, kept to parse it again without scanning */
+    const char **fields, **delimiters;
+    uint16_t *newlines;
+    size_t line, span;
+    bool start_of_line;
+  } stream;
+  /** @private */
+  /** chunks of a file parsed in parallel end at the first entry at or past
+      the limit, see @ref zone_parse_parallel. end is set to the start of
+      that entry, or remains NULL if the end of the file was reached */
+  struct { const char *limit, *end; } chunk;
+  /** @private */
   /** scanner state is kept per-file */
   struct {
     uint64_t in_comment;
@@ -426,6 +502,108 @@ typedef int32_t(*zone_accept_t)(
   const uint8_t *, // rdata
   void *); // user data
 
+/**
+ * @brief Resource record returned by @ref zone_next.
+ *
+ * Header is in host order, RDATA section is in network order. Owner and
+ * RDATA point into scratch buffers of the parser and remain valid until
+ * the next invocation of @ref zone_next.
+ */
+typedef struct zone_rr zone_rr_t;
+struct zone_rr {
+  /** Owner (length + octets). */
+  zone_name_t owner;
+  uint16_t type;
+  /** Class, class is a reserved word in C++. */
+  uint16_t rrclass;
+  uint32_t ttl;
+  uint16_t rdlength;
+  const uint8_t *rdata;
+};
+
+/**
+ * @brief Chunk of zone file parsed by @ref zone_parse_parallel,
+ *        @ref zone_parse_includes or @ref zone_parse_batch.
+ *
+ * Passed as user data to callbacks so that records can be put back in
+ * order if required. Records in a chunk are delivered in order, on the
+ * same thread. For @ref zone_parse_includes, every file included from the
+ * top-level file is a chunk, as is every run of records in the top-level
+ * file between $INCLUDE entries.
+ */
+typedef struct zone_chunk zone_chunk_t;
+struct zone_chunk {
+  /** Thread the chunk is delivered on, zero up to the number of threads. */
+  size_t thread;
+  /** Sequence number, records in chunks with lower numbers come first. */
+  size_t sequence;
+  /** Pointer passed verbatim to @ref zone_parse_parallel. */
+  void *user_data;
+};
+
+/**
+ * @brief Zone parsed by @ref zone_parse_batch.
+ *
+ * Callbacks receive a @ref zone_chunk_t with the index of the job as
+ * sequence number and the user data of the job.
+ */
+typedef struct zone_job zone_job_t;
+struct zone_job {
+  /** Path of master file to parse. */
+  const char *path;
+  /** Origin in wire format, origin in options is used if octets is NULL. */
+  zone_name_t origin;
+  /** Pointer passed in @ref zone_chunk_t to callbacks. */
+  void *user_data;
+};
+
+/**
+ * @brief State of the parser at the start of an entry.
+ *
+ * Checkpoints are placed at the start of entries in the top-level file,
+ * i.e. outside quoted sections, comments and parentheses, so that the
+ * scanner state is empty and parsing can resume without looking back.
+ */
+typedef struct zone_checkpoint zone_checkpoint_t;
+struct zone_checkpoint {
+  /** Offset of the entry in the file. */
+  size_t offset;
+  /** Line of the entry. */
+  size_t line;
+  /** Origin in effect. */
+  zone_name_buffer_t origin;
+  /** Owner of the preceding record, used if the entry omits the owner. */
+  zone_name_buffer_t owner;
+  /** Last explicitly stated TTL. */
+  uint32_t last_ttl;
+  /** TTL stated in the last $TTL entry. */
+  uint32_t dollar_ttl;
+  /** $TTL entry was found, records without a TTL use dollar_ttl. */
+  bool use_dollar_ttl;
+  /** Last explicitly stated class. */
+  uint16_t last_class;
+};
+
+/**
+ * @brief Index of checkpoints into a zone file.
+ *
+ * Built by @ref zone_build_index, stored next to the zone file with
+ * @ref zone_write_index and used by @ref zone_parse_range to parse parts of
+ * the file without parsing what comes before, e.g. on multiple threads.
+ */
+typedef struct zone_index zone_index_t;
+struct zone_index {
+  /** Length of the indexed file, an index for another length is rejected. */
+  size_t length;
+  /** Minimum distance in octets between checkpoints. */
+  size_t interval;
+  /** Number of checkpoints, the first is always at the top of the file. */
+  size_t count;
+  /** @private */
+  size_t size;
+  zone_checkpoint_t *checkpoints;
+};
+
 /**
  * @brief Signature of callback function invoked on $INCLUDE.
  *
@@ -438,6 +616,20 @@ typedef int32_t(*zone_include_t)(
   const char *, // fully qualified path
   void *); // user data
 
+/**
+ * @brief Signature of callback function invoked to open included files.
+ *
+ * Provide input for the file name in the $INCLUDE directive if included
+ * files are not to be opened from the filesystem. The name is used verbatim
+ * to detect circular includes. Returns zero on success or a negative number
+ * (e.g. @ref ZONE_NOT_A_FILE) on error.
+ */
+typedef int32_t(*zone_open_t)(
+  zone_parser_t *,
+  const char *, // name in $INCLUDE entry
+  zone_reader_t **, // reader, closed by the parser
+  void *); // user data
+
 /**
  * @brief Available configuration options.
  */
@@ -454,6 +646,20 @@ typedef struct {
   uint32_t include_limit;
   /** Enable 1h2m3s notations for TTLS. */
   bool pretty_ttls;
+  /** Drop zone files from the page cache once read. */
+  /** Useful on servers that load large zones while answering queries as
+      reading zones through the page cache evicts memory that is in use.
+      Files are not mapped into memory if set. */
+  bool no_page_cache;
+  /** Number of threads to decompress multi-frame zstd files. */
+  /** Frames are decompressed ahead of the parser. 0 or 1 to decompress on
+      the calling thread. Only used if zstd support is enabled. */
+  uint32_t decompress_threads;
+  /** Scan files on a separate thread ahead of the parser. */
+  /** Scanning and parsing overlap on multi-core systems. Only used for
+      files that are mapped into memory, including included files, and if
+      threads are supported. */
+  bool pipeline;
   /** Origin in wire format. */
   zone_name_t origin;
   /** Default TTL to use. */
@@ -473,6 +679,8 @@ typedef struct {
   struct {
     /** Callback invoked for each $INCLUDE entry. */
     zone_include_t callback;
+    /** Callback invoked to open included files, NULL to open files. */
+    zone_open_t open;
   } include;
 } zone_options_t;
 
@@ -517,6 +725,14 @@ struct zone_parser {
   /** @private */
   zone_rdata_buffer_t *rdata;
   /** @private */
+  zone_rr_t *rr;
+  /** @private */
+  int32_t (*next)(zone_parser_t *);
+  /** @private */
+  /** files included from the top-level file are handed over to other
+      threads rather than parsed, see @ref zone_parse_includes */
+  struct zone_include_pool *includes;
+  /** @private */
   zone_file_t *file, first;
 };
 
@@ -543,6 +759,8 @@ struct zone_parser {
 #define ZONE_NOT_A_FILE (-1792)  // (-7 << 8)
 /** Access to specified file is not allowed. */
 #define ZONE_NOT_PERMITTED (-2048)  // (-8 << 8)
+/** Error writing index file. */
+#define ZONE_WRITE_ERROR (-2304)  // (-9 << 8)
 /** @} */
 
 /**
@@ -594,6 +812,417 @@ zone_parse_string(
   void *user_data)
 zone_nonnull((1,2,3,4));
 
+/**
+ * @brief Parse zone from buffer
+ *
+ * Parse buffer containing resource records in presentation format. Unlike
+ * @ref zone_parse_string, the buffer is not required to be null-terminated
+ * or padded. The buffer is scanned in place, only the last few blocks are
+ * copied.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing.
+ * @param[in]  data       Input buffer.
+ * @param[in]  length     Length of input buffer.
+ * @param[in]  user_data  Pointer passed verbatim to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_parse_buffer(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *data,
+  size_t length,
+  void *user_data)
+zone_nonnull((1,2,3,4));
+
+/**
+ * @brief Parse zone from reader
+ *
+ * Parse input provided by a reader containing resource records in
+ * presentation format.
+ *
+ * @note The close callback of the reader, if any, is invoked before the
+ *       function returns, including on error.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing.
+ * @param[in]  name       Name of input used in log messages.
+ * @param[in]  reader     Reader to provide input.
+ * @param[in]  user_data  Pointer passed verbatim to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_parse_reader(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *name,
+  zone_reader_t *reader,
+  void *user_data)
+zone_nonnull((1,2,3,4,5));
+
+/**
+ * @brief Open zone for incremental parsing
+ *
+ * Prepare parser to parse input that is pushed by the application in
+ * chunks of arbitrary size using @ref zone_stream_feed, e.g. as it is
+ * received from a socket or pipe by an event loop. Records are passed to
+ * the accept callback as soon as they are complete.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing.
+ * @param[in]  user_data  Pointer passed verbatim to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_stream_open(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  void *user_data)
+zone_nonnull((1,2,3));
+
+/**
+ * @brief Push chunk of input to parser
+ *
+ * Parse records that are complete. The remainder, i.e. the start of a
+ * record that is split across chunks, is retained by the parser, the chunk
+ * need not remain valid after the function returns. Input is scanned in
+ * blocks of @ref ZONE_BLOCK_SIZE bytes, records in the last partial block
+ * are parsed once more input is fed or the input is finished.
+ *
+ * Input is scanned once. A record that is split across chunks is parsed
+ * again from its start whenever fed input completes a block, which costs
+ * time proportional to the part of the record received so far. Records
+ * with more tokens than fit half of the tape (@ref ZONE_TAPE_SIZE) are
+ * scanned again too, such records are best fed in larger chunks.
+ *
+ * @note The parser is closed on error, @ref zone_stream_finish must not be
+ *       invoked. Otherwise @ref zone_stream_finish must be invoked to
+ *       release resources held by the parser.
+ *
+ * @param[in]  parser  Zone parser
+ * @param[in]  data    Chunk of input.
+ * @param[in]  length  Length of chunk.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_stream_feed(
+  zone_parser_t *parser,
+  const char *data,
+  size_t length)
+zone_nonnull((1,2));
+
+/**
+ * @brief Signal end of input to parser
+ *
+ * Parse the remainder of the input and close the parser.
+ *
+ * @param[in]  parser  Zone parser
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_stream_finish(
+  zone_parser_t *parser)
+zone_nonnull((1));
+
+/**
+ * @brief Open zone file to iterate over records
+ *
+ * Prepare parser to return records one at a time using @ref zone_next
+ * instead of passing them to the accept callback, which is not required.
+ * Useful if records of multiple zones are to be merged, e.g. to compute
+ * differences or apply journals.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing.
+ * @param[in]  path       Path of master file to parse.
+ * @param[in]  user_data  Pointer passed verbatim to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_open(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  void *user_data)
+zone_nonnull((1,2,3,4));
+
+/**
+ * @brief Return next record
+ *
+ * Parse up to and including the next record. Parsing resumes where it left
+ * off on the next invocation.
+ *
+ * @note @ref zone_next must not be invoked again once zero or an error is
+ *       returned.
+ *
+ * @param[in]  parser  Zone parser opened with @ref zone_open.
+ * @param[out] rr      Record, valid until the next invocation.
+ *
+ * @returns A positive number if a record is returned, zero if no records
+ *          are left or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_next(
+  zone_parser_t *parser,
+  zone_rr_t *rr)
+zone_nonnull((1,2));
+
+/**
+ * @brief Close zone file
+ *
+ * Release resources held by a parser opened with @ref zone_open.
+ *
+ * @param[in]  parser  Zone parser
+ */
+ZONE_EXPORT void
+zone_close(
+  zone_parser_t *parser)
+zone_nonnull((1));
+
+/**
+ * @brief Parse zone file on multiple threads
+ *
+ * Split file into chunks at line boundaries that likely start a record and
+ * parse chunks concurrently. Chunks are parsed speculatively, i.e. without
+ * knowing if the boundary is inside a quoted section or parentheses, or
+ * which origin, TTL and class apply. Once the preceding chunk is done, the
+ * guess is validated and records are delivered, or the chunk is parsed
+ * again if the guess was wrong. Errors and warnings are always reported by
+ * the latter, speculation never shows.
+ *
+ * Callbacks are invoked concurrently and receive a @ref zone_chunk_t as
+ * user data. Each thread uses its own scratch buffers.
+ *
+ * @note Files that cannot be mapped into memory, e.g. compressed files, or
+ *       files too small to split, are parsed on the calling thread.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing, one per thread.
+ * @param[in]  path       Path of master file to parse.
+ * @param[in]  threads    Number of threads, including the calling thread.
+ *                        Limited to the number of scratch buffers.
+ * @param[in]  user_data  Pointer passed in @ref zone_chunk_t to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_parse_parallel(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  size_t threads,
+  void *user_data)
+zone_nonnull((1,2,3,4));
+
+/**
+ * @brief Parse zone file and files included from it on multiple threads
+ *
+ * Files included from the top-level file are handed over to a pool of
+ * threads as $INCLUDE entries are found and parsed while the top-level file
+ * is parsed further. Included files start with the origin, TTL and class in
+ * effect at the $INCLUDE entry, as they would if parsed sequentially. Files
+ * included from included files are parsed by the same thread.
+ *
+ * Callbacks are invoked concurrently and receive a @ref zone_chunk_t as
+ * user data. The sequence number identifies the included file, or the run
+ * of records in the top-level file, and follows the order of the entries.
+ * If ordered is set, records are delivered in the order of a sequential
+ * parse, i.e. one chunk after the other. Records of chunks whose turn has
+ * not yet come are held in memory until then.
+ *
+ * @note Parsing stops on the first error, whether records are delivered in
+ *       order or not. Chunks that follow the chunk that failed are abandoned
+ *       shortly after, chunks that precede it are parsed to the end. The
+ *       error of the chunk with the lowest sequence number is returned.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing, one per thread.
+ * @param[in]  path       Path of master file to parse.
+ * @param[in]  threads    Number of threads, including the calling thread.
+ *                        Limited to the number of scratch buffers.
+ * @param[in]  ordered    Deliver records in order of a sequential parse.
+ * @param[in]  user_data  Pointer passed in @ref zone_chunk_t to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_parse_includes(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  size_t threads,
+  bool ordered,
+  void *user_data)
+zone_nonnull((1,2,3,4));
+
+/**
+ * @brief Parse a batch of zone files on multiple threads
+ *
+ * Parse many, typically small, zone files, e.g. to load every zone at
+ * startup. Every thread reuses a parser and a window into which small
+ * files are read, jobs are distributed over threads in ranges and threads
+ * that run out of jobs take over part of the range of another thread. The
+ * kernel is selected once for the batch.
+ *
+ * Callbacks are invoked concurrently and receive a @ref zone_chunk_t as
+ * user data with the thread, the index of the job as sequence number and
+ * the user data of the job. Each thread uses its own scratch buffers.
+ *
+ * @note Included files are opened relative to the working directory, like
+ *       zone files. Paths of zone files are only resolved if includes are
+ *       enabled as the absolute path is used to detect circular includes.
+ *
+ * @param[in]  options  Settings used for parsing.
+ * @param[in]  buffers  Scratch buffers used by parsing, one per thread.
+ * @param[in]  jobs     Zone files to parse.
+ * @param[in]  count    Number of jobs.
+ * @param[in]  threads  Number of threads, including the calling thread.
+ *                      Limited to the number of scratch buffers.
+ * @param[out] codes    Result per job, @ref ZONE_SUCCESS or a negative
+ *                      number, may be NULL.
+ *
+ * @returns @ref ZONE_SUCCESS if every zone was parsed, the code of the
+ *          first job that failed otherwise. @ref ZONE_BAD_PARAMETER is
+ *          returned if options are invalid, no job is parsed then.
+ */
+ZONE_EXPORT int32_t
+zone_parse_batch(
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const zone_job_t *jobs,
+  size_t count,
+  size_t threads,
+  int32_t *codes)
+zone_nonnull((1,2,3));
+
+/**
+ * @brief Parse zone file and build an index of checkpoints
+ *
+ * Parse file and record the state of the parser at the first entry at or
+ * past every interval octets. Records are passed to the accept callback if
+ * one is specified, which allows for building the index on the first load.
+ *
+ * @note Only files that can be mapped into memory can be indexed, i.e. not
+ *       compressed files or pipes.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing.
+ * @param[in]  path       Path of master file to index.
+ * @param[in]  interval   Minimum distance in octets between checkpoints.
+ * @param[out] index      Index, release with @ref zone_free_index.
+ * @param[in]  user_data  Pointer passed verbatim to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ */
+ZONE_EXPORT int32_t
+zone_build_index(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  size_t interval,
+  zone_index_t *index,
+  void *user_data)
+zone_nonnull((1,2,3,4,6));
+
+/**
+ * @brief Parse range of zone file
+ *
+ * Parse entries from checkpoint from up to checkpoint to, or the end of the
+ * file if to equals the number of checkpoints. The state of the parser is
+ * restored from the index, origin, TTL and class in options only apply to
+ * building the index. Ranges are independent, parsing a range on each of
+ * a number of threads yields the records of the file, without speculation.
+ *
+ * @param[in]  parser     Zone parser
+ * @param[in]  options    Settings used for parsing.
+ * @param[in]  buffers    Scratch buffers used by parsing.
+ * @param[in]  path       Path of master file to parse.
+ * @param[in]  index      Index built for the file.
+ * @param[in]  from       First checkpoint of the range.
+ * @param[in]  to         Checkpoint past the range.
+ * @param[in]  user_data  Pointer passed verbatim to callbacks.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ *          @ref ZONE_BAD_PARAMETER is returned if the index does not match
+ *          the file.
+ */
+ZONE_EXPORT int32_t
+zone_parse_range(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  const zone_index_t *index,
+  size_t from,
+  size_t to,
+  void *user_data)
+zone_nonnull((1,2,3,4,5));
+
+/**
+ * @brief Write index to file
+ *
+ * Indexes are written in a portable format, typically to a file next to
+ * the zone file.
+ *
+ * @param[in]  index  Index to write.
+ * @param[in]  path   Path of index file.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ *          @ref ZONE_WRITE_ERROR is returned if the index is not written
+ *          in its entirety.
+ */
+ZONE_EXPORT int32_t
+zone_write_index(
+  const zone_index_t *index,
+  const char *path)
+zone_nonnull_all;
+
+/**
+ * @brief Read index from file
+ *
+ * @param[out] index  Index, release with @ref zone_free_index.
+ * @param[in]  path   Path of index file.
+ *
+ * @returns @ref ZONE_SUCCESS on success or a negative number on error.
+ *          @ref ZONE_BAD_PARAMETER is returned if the file is not an index.
+ */
+ZONE_EXPORT int32_t
+zone_read_index(
+  zone_index_t *index,
+  const char *path)
+zone_nonnull_all;
+
+/**
+ * @brief Release memory held by index
+ *
+ * @param[in]  index  Index built or read.
+ */
+ZONE_EXPORT void
+zone_free_index(
+  zone_index_t *index)
+zone_nonnull_all;
+
 /**
  * @defgroup log_priorities Log categories.
  *
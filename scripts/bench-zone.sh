@@ -0,0 +1,291 @@
+#!/bin/sh
+#
+# bench-zone.sh -- generate zone files to benchmark specific code paths
+#
+# Copyright (c) 2024, NLnet Labs. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Usage: bench-zone.sh <corpus> [records] > corpus.zone
+#
+#   comments  annotated zone, e.g. dig AXFR dumps or signer output, where
+#             each record is followed by a comment. a few comments contain
+#             quotes and some quoted strings contain semicolons
+#   signed    signed zone where DNSKEY and RRSIG records make up the bulk of
+#             the data. half of the signatures are split over multiple
+#             lines, as is common for zones printed by dig or signers
+#   ds        top-level domain with delegations where DS records make up the
+#             bulk of the data. digests are split into multiple words
+#             every other record, as is done by BIND
+#   aaaa      hosting provider zone where AAAA records make up the bulk of
+#             the data. addresses are printed in compressed form, a few
+#             are fully expanded or embed an IPv4 address
+#   escaped   zone where names and TXT records are dense with escape
+#             sequences, e.g. as printed by tools that escape non-ASCII
+#             octets in labels and DKIM or SPF records with \DDD escapes
+#
+# Pathological inputs. CPU time per byte should be in the same ballpark as
+# for regular zones, zone-bench reports it for comparison.
+#
+#   tokens    maximum-size tokens, i.e. DNSKEY records with a single base64
+#             word that decodes to 65526 octets and TXT records with 255
+#             strings of 255 octets. the window grows if the zone is read
+#             from a pipe or dropped from the page cache
+#   svcb      SVCB and HTTPS records with deeply escaped values, i.e. alpn
+#             lists where every octet is a \DDD escape and commas within
+#             values are escaped twice, and long escaped generic keys
+#   tiny      thousands of tiny tokens per line, i.e. TXT records with
+#             single character strings and NSEC records with type bitmaps
+#             listing thousands of types
+#   quotes    zone that ends in an unterminated quote, everything after the
+#             quote is part of a single string. parsing fails
+#
+
+usage() {
+	>&2 echo "Usage: $0 <comments|signed|ds|aaaa|escaped|tokens|svcb|tiny|quotes> [records]"
+	exit 1
+}
+
+[ $# -ge 1 ] || usage
+CORPUS="$1"
+RECORDS="${2:-1000000}"
+
+case "${CORPUS}" in
+comments)
+	awk -v records="${RECORDS}" 'BEGIN {
+		print "$ORIGIN example.com."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600 ; serial, refresh, retry, expire, minimum"
+		for (i = 0; i < records; i++) {
+			r = i % 8
+			if (r == 0)
+				printf "host%d 3600 IN A 192.0.2.%d ; cname=no; zsk=%d\n", i, i % 256, i % 65536
+			else if (r == 1)
+				printf "host%d 3600 IN AAAA 2001:db8::%x ; bits=128\n", i, i % 65536
+			else if (r == 2)
+				printf "host%d 3600 IN MX 10 mail%d ; preference=10, exchange=mail%d\n", i, i, i
+			else if (r == 3)
+				printf "host%d 3600 IN TXT \"v=spf1 a mx; -all\" ; quoted semicolon\n", i
+			else if (i % 64 == 4)
+				printf "host%d 3600 IN NS ns%d.example.net. ; delegation to \"ns%d\"\n", i, i % 4, i % 4
+			else if (r == 4)
+				printf "host%d 3600 IN NS ns%d.example.net. ; delegation\n", i, i % 4
+			else if (r == 5)
+				printf "; host%d was removed on 2024-01-01\n", i
+			else if (r == 6)
+				printf "host%d 3600 IN DS 31589 8 1 ( 3490A6806D47F17A34C29E2CE80E8A999FFBE4BE ; key id = 31589\n  ) ; sha-1\n", i
+			else
+				printf "host%d 3600 IN CNAME host%d ; alias\n", i, i - 1
+		}
+	}'
+	;;
+signed)
+	awk -v records="${RECORDS}" '
+	function base64(n,    i, s) {
+		s = ""
+		for (i = 0; i < n; i++)
+			s = s substr(alphabet, int(rand() * 64) + 1, 1)
+		return s
+	}
+	function signature(    s) {
+		s = base64(342) "=="
+		if (r % 2)
+			return s
+		return "(\n\t" substr(s, 1, 56) "\n\t" substr(s, 57, 56) "\n\t" \
+		       substr(s, 113, 56) "\n\t" substr(s, 169, 56) "\n\t" \
+		       substr(s, 225, 56) "\n\t" substr(s, 281, 64) " )"
+	}
+	BEGIN {
+		srand(1)
+		alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+		print "$ORIGIN example.com."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600"
+		print "@ IN DNSKEY 257 3 8 " base64(342) "=="
+		print "@ IN DNSKEY 256 3 8 " base64(342) "=="
+		for (r = 0; r < records; r++) {
+			printf "host%d IN A 192.0.2.%d\n", r, r % 256
+			printf "host%d IN RRSIG A 8 3 3600 20240201000000 20240101000000 12345 example.com. %s\n", r, signature()
+		}
+	}'
+	;;
+ds)
+	awk -v records="${RECORDS}" '
+	function base16(n,    i, s) {
+		s = ""
+		for (i = 0; i < n; i++)
+			s = s substr(alphabet, int(rand() * 16) + 1, 1)
+		return s
+	}
+	BEGIN {
+		srand(1)
+		alphabet = "0123456789ABCDEF"
+		print "$ORIGIN example."
+		print "$TTL 86400"
+		print "@ IN SOA a.nic hostmaster 2024010101 1800 900 604800 86400"
+		for (r = 0; r < records; r++) {
+			printf "domain%d IN NS ns1.domain%d.net.\n", r, r
+			printf "domain%d IN NS ns2.domain%d.net.\n", r, r
+			if (r % 2)
+				printf "domain%d IN DS %d 13 2 %s\n", r, r % 65536, base16(64)
+			else
+				printf "domain%d IN DS %d 13 2 %s %s\n", r, r % 65536, base16(56), base16(8)
+			if (r % 4 == 0)
+				printf "domain%d IN DS %d 8 4 %s\n", r, (r + 1) % 65536, base16(96)
+		}
+	}'
+	;;
+aaaa)
+	awk -v records="${RECORDS}" '
+	function group() {
+		return sprintf("%x", int(rand() * 65536))
+	}
+	BEGIN {
+		srand(1)
+		print "$ORIGIN example.net."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600"
+		for (r = 0; r < records; r++) {
+			if (r % 16 == 0)
+				printf "host%d IN AAAA 2001:db8:%s:%s:%s:%s:%s:%s\n", r, group(), group(), group(), group(), group(), group()
+			else if (r % 16 == 1)
+				printf "host%d IN AAAA ::ffff:192.0.2.%d\n", r, r % 256
+			else if (r % 4 == 0)
+				printf "host%d IN AAAA 2001:db8:%s::%s\n", r, group(), group()
+			else
+				printf "host%d IN AAAA 2001:db8:%s:%s::%s:%s\n", r, group(), group(), group(), group()
+		}
+	}'
+	;;
+escaped)
+	awk -v records="${RECORDS}" '
+	function label(n,    i, s) {
+		s = ""
+		for (i = 0; i < n; i++) {
+			if (rand() < 0.5)
+				s = s sprintf("\\%03d", 128 + int(rand() * 128))
+			else
+				s = s substr(alphabet, int(rand() * 36) + 1, 1)
+		}
+		return s
+	}
+	function text(n,    i, s) {
+		s = ""
+		for (i = 0; i < n; i++) {
+			if (rand() < 0.25)
+				s = s sprintf("\\%03d", int(rand() * 256))
+			else if (rand() < 0.1)
+				s = s "\\;"
+			else
+				s = s substr(alphabet, int(rand() * 36) + 1, 1)
+		}
+		return s
+	}
+	BEGIN {
+		srand(1)
+		alphabet = "abcdefghijklmnopqrstuvwxyz0123456789"
+		print "$ORIGIN example.com."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600"
+		for (r = 0; r < records; r++) {
+			if (r % 2)
+				printf "%s.%s IN A 192.0.2.%d\n", label(8), label(12), r % 256
+			else
+				printf "s%d._domainkey IN TXT \"%s\" \"%s\"\n", r, text(120), text(60)
+		}
+	}'
+	;;
+tokens)
+	awk -v records="${RECORDS}" '
+	function base64(n,    i, s) {
+		s = ""
+		for (i = 0; i < n; i++)
+			s = s substr(alphabet, int(rand() * 64) + 1, 1)
+		return s
+	}
+	BEGIN {
+		srand(1)
+		alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+		# 65526 octets of public key take 87368 characters, no padding
+		key = base64(87368)
+		string = "\"" base64(255) "\""
+		strings = string
+		for (i = 1; i < 255; i++)
+			strings = strings " " string
+		print "$ORIGIN example.com."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600"
+		for (r = 0; r < records; r++) {
+			if (r % 2)
+				printf "host%d IN TXT %s\n", r, strings
+			else
+				printf "host%d IN DNSKEY 256 3 8 %s\n", r, key
+		}
+	}'
+	;;
+svcb)
+	awk -v records="${RECORDS}" '
+	function escape(s,    i, e) {
+		e = ""
+		for (i = 1; i <= length(s); i++)
+			e = e sprintf("\\%03d", index(ascii, substr(s, i, 1)) + 31)
+		return e
+	}
+	function octets(n,    i, s) {
+		s = ""
+		for (i = 0; i < n; i++)
+			s = s sprintf("\\%03d", int(rand() * 256))
+		return s
+	}
+	BEGIN {
+		srand(1)
+		for (i = 32; i < 127; i++)
+			ascii = ascii sprintf("%c", i)
+		alpn = escape("h2") "," escape("h3") "," escape("h3") "\\\\," escape("29")
+		for (i = 0; i < 16; i++)
+			alpn = alpn "," escape("proto") "\\\\," escape(sprintf("%02d", i))
+		print "$ORIGIN example.com."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600"
+		for (r = 0; r < records; r++) {
+			if (r % 2)
+				printf "_443._https.host%d IN HTTPS 1 . alpn=\"%s\" port=443\n", r, alpn
+			else
+				printf "_443._https.host%d IN SVCB 1 %s. alpn=%s key65000=\"%s\"\n", r, escape("svc" r), alpn, octets(256)
+		}
+	}'
+	;;
+tiny)
+	awk -v records="${RECORDS}" '
+	BEGIN {
+		text = "a"
+		for (i = 1; i < 4000; i++)
+			text = text " " substr("abcdefghijklmnopqrstuvwxyz", i % 26 + 1, 1)
+		types = "A NS SOA"
+		for (i = 1000; i < 4000; i++)
+			types = types " TYPE" i
+		print "$ORIGIN example.com."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600"
+		for (r = 0; r < records; r++) {
+			if (r % 2)
+				printf "host%d IN NSEC host%d %s\n", r, r + 1, types
+			else
+				printf "host%d IN TXT %s\n", r, text
+		}
+	}'
+	;;
+quotes)
+	awk -v records="${RECORDS}" 'BEGIN {
+		print "$ORIGIN example.com."
+		print "$TTL 3600"
+		print "@ IN SOA ns1 hostmaster 2024010101 7200 3600 1209600 3600"
+		print "@ IN TXT \"unterminated"
+		for (r = 0; r < records; r++)
+			printf "host%d IN TXT v=spf1 a mx -all\n", r
+	}'
+	;;
+*)
+	usage
+	;;
+esac
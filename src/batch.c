@@ -0,0 +1,322 @@
+/*
+ * batch.c -- load many small zone files on multiple threads
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if !_WIN32
+#  include <unistd.h>
+#endif
+#if HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include "zone.h"
+#include "attributes.h"
+#include "internal.h"
+
+// zones loaded at startup are typically small, parsers are allocated once
+// per thread and small files are read into a window that is reused rather
+// than mapped or read into a window allocated for every zone
+#define SMALL_FILE_SIZE (1024u * 1024u)
+
+typedef struct batch batch_t;
+struct batch {
+  int32_t (*parse)(parser_t *);
+  const zone_options_t *options;
+  const zone_job_t *jobs;
+  size_t count;
+  int32_t *codes;
+  size_t worker_count;
+  struct batch_worker *workers;
+};
+
+typedef struct batch_worker batch_worker_t;
+struct batch_worker {
+#if HAVE_PTHREAD
+  pthread_mutex_t lock;
+#endif
+  /** jobs not yet claimed, other workers take from the end */
+  size_t begin, end;
+  batch_t *batch;
+  parser_t *parser;
+  zone_buffers_t buffers;
+  zone_chunk_t chunk;
+  struct { size_t size; char *data; } window;
+  /** index of the first job that failed and its code */
+  size_t failed;
+  int32_t code;
+};
+
+#if !_WIN32
+// read regular file into the window of the worker, files that are large or
+// may be compressed are opened as usual. returns zero if the file is to be
+// opened as usual
+nonnull_all
+static int32_t read_small_file(
+  parser_t *parser, batch_worker_t *worker, const char *path)
+{
+  static const char gzip[2] = { '\x1f', '\x8b' };
+  static const char zstd[4] = { '\x28', '\xb5', '\x2f', '\xfd' };
+  struct stat status;
+  file_t *file = &parser->first;
+  size_t length = 0;
+  char *resolved = NULL;
+  int fd;
+
+  if (parser->options.no_page_cache)
+    return 0;
+  if ((fd = open(path, O_RDONLY)) == -1)
+    return 0;
+  if (fstat(fd, &status) == -1 || !S_ISREG(status.st_mode) ||
+      (uint64_t)status.st_size >= SMALL_FILE_SIZE)
+    return (void)close(fd), 0;
+
+  const size_t size = (size_t)status.st_size + ZONE_BLOCK_SIZE + 1;
+  if (worker->window.size < size) {
+    char *data;
+    if (!(data = realloc(worker->window.data, size)))
+      return (void)close(fd), 0;
+    worker->window.data = data;
+    worker->window.size = size;
+  }
+
+  char *data = worker->window.data;
+  for (ssize_t count; length < (size_t)status.st_size; length += (size_t)count)
+    if ((count = read(fd, data + length, (size_t)status.st_size - length)) <= 0)
+      break;
+  (void)close(fd);
+  if (length < (size_t)status.st_size)
+    return 0;
+  if ((length >= sizeof(gzip) && memcmp(data, gzip, sizeof(gzip)) == 0) ||
+      (length >= sizeof(zstd) && memcmp(data, zstd, sizeof(zstd)) == 0))
+    return 0;
+  // absolute path is only used to detect circular includes
+  if (!parser->options.no_includes && zone_resolve_path(path, &resolved) != 0)
+    return 0;
+  memset(data + length, 0, ZONE_BLOCK_SIZE + 1);
+
+  zone_initialize_file(parser, file);
+  file->name = (char *)path;
+  file->path = resolved ? resolved : (char *)path;
+  file->borrowed = true;
+  file->buffer.data = data;
+  file->buffer.size = length;
+  file->buffer.length = length;
+  file->fields.tape[0] = &data[length];
+  file->fields.tape[1] = &data[length];
+  return 1;
+}
+#endif
+
+nonnull_all
+static int32_t parse_job(batch_worker_t *worker, size_t index)
+{
+  const batch_t *batch = worker->batch;
+  const zone_job_t *job = &batch->jobs[index];
+  parser_t *parser = worker->parser;
+  zone_options_t options = *batch->options;
+  int32_t code;
+
+  if (job->origin.octets)
+    options.origin = job->origin;
+  worker->chunk.sequence = index;
+  worker->chunk.user_data = job->user_data;
+  // only the state that precedes the files is reset, tapes are not
+  if ((code = zone_setup_parser(parser, &options, &worker->buffers, &worker->chunk)) < 0)
+    return code;
+
+#if !_WIN32
+  if (read_small_file(parser, worker, job->path)) {
+    code = batch->parse(parser);
+    // name and, if not resolved, path are borrowed from the job
+    if (parser->first.path == job->path)
+      parser->first.path = NULL;
+    parser->first.name = NULL;
+    zone_close(parser);
+    return code;
+  }
+#endif
+
+  if ((code = zone_open_first(parser, job->path)) < 0)
+    return code;
+  code = batch->parse(parser);
+  zone_close(parser);
+  return code;
+}
+
+nonnull_all
+static void finish_job(batch_worker_t *worker, size_t index, int32_t code)
+{
+  if (code > 0)
+    code = 0;
+  if (worker->batch->codes)
+    worker->batch->codes[index] = code;
+  if (code < 0 && (!worker->code || index < worker->failed)) {
+    worker->code = code;
+    worker->failed = index;
+  }
+}
+
+#if HAVE_PTHREAD
+// claim the next job in the range of the worker, or take over half of what
+// remains of the range of another worker
+nonnull_all
+static bool claim_job(batch_worker_t *worker, size_t *index)
+{
+  batch_t *batch = worker->batch;
+
+  pthread_mutex_lock(&worker->lock);
+  if (worker->begin < worker->end) {
+    *index = worker->begin++;
+    pthread_mutex_unlock(&worker->lock);
+    return true;
+  }
+  pthread_mutex_unlock(&worker->lock);
+
+  const size_t self = (size_t)(worker - batch->workers);
+  for (size_t i=1; i < batch->worker_count; i++) {
+    batch_worker_t *victim =
+      &batch->workers[(self + i) % batch->worker_count];
+    pthread_mutex_lock(&victim->lock);
+    const size_t remaining = victim->end - victim->begin;
+    if (!remaining) {
+      pthread_mutex_unlock(&victim->lock);
+      continue;
+    }
+    const size_t end = victim->end;
+    victim->end -= (remaining + 1) / 2;
+    const size_t begin = victim->end;
+    pthread_mutex_unlock(&victim->lock);
+
+    pthread_mutex_lock(&worker->lock);
+    worker->begin = begin + 1;
+    worker->end = end;
+    pthread_mutex_unlock(&worker->lock);
+    *index = begin;
+    return true;
+  }
+
+  return false;
+}
+
+static void *parse_jobs(void *argument)
+{
+  batch_worker_t *worker = argument;
+  size_t index;
+
+  while (claim_job(worker, &index))
+    finish_job(worker, index, parse_job(worker, index));
+  return NULL;
+}
+#endif
+
+int32_t zone_parse_batch(
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const zone_job_t *jobs,
+  size_t count,
+  size_t threads,
+  int32_t *codes)
+{
+  int32_t code;
+  batch_t batch;
+  batch_worker_t *workers;
+
+  if (!options->accept.callback)
+    return ZONE_BAD_PARAMETER;
+  if (!buffers->size)
+    return ZONE_BAD_PARAMETER;
+  if (!count)
+    return ZONE_SUCCESS;
+  if (threads > buffers->size)
+    threads = buffers->size;
+  if (threads > count)
+    threads = count;
+  if (!threads)
+    threads = 1;
+#if !HAVE_PTHREAD
+  threads = 1;
+#endif
+
+  memset(&batch, 0, sizeof(batch));
+  batch.parse = zone_select_kernel()->parse;
+  batch.options = options;
+  batch.jobs = jobs;
+  batch.count = count;
+  batch.codes = codes;
+  if (!(workers = calloc(threads, sizeof(*workers))))
+    return ZONE_OUT_OF_MEMORY;
+  batch.workers = workers;
+
+  code = 0;
+  for (; batch.worker_count < threads; batch.worker_count++) {
+    batch_worker_t *worker = &workers[batch.worker_count];
+    if (!(worker->parser = malloc(sizeof(*worker->parser)))) {
+      code = ZONE_OUT_OF_MEMORY;
+      break;
+    }
+    // options are validated once, setup_parser only fails on bad options
+    if (batch.worker_count == 0 &&
+        (code = zone_setup_parser(worker->parser, options, buffers, NULL)) < 0)
+    {
+      free(worker->parser);
+      break;
+    }
+    worker->batch = &batch;
+    worker->buffers.size = 1;
+    worker->buffers.owner = &buffers->owner[batch.worker_count];
+    worker->buffers.rdata = &buffers->rdata[batch.worker_count];
+    worker->chunk.thread = batch.worker_count;
+    worker->begin = (count * batch.worker_count) / threads;
+    worker->end = (count * (batch.worker_count + 1)) / threads;
+  }
+
+  if (code == 0) {
+#if HAVE_PTHREAD
+    size_t started = 1;
+    pthread_t *handles;
+    if (!(handles = calloc(threads, sizeof(*handles))))
+      code = ZONE_OUT_OF_MEMORY;
+    for (size_t i=0; code == 0 && i < threads; i++)
+      pthread_mutex_init(&workers[i].lock, NULL);
+    // jobs of workers that cannot be started are taken over by others
+    for (; code == 0 && started < threads; started++)
+      if (pthread_create(&handles[started], NULL, parse_jobs, &workers[started]) != 0)
+        break;
+    if (code == 0)
+      parse_jobs(&workers[0]);
+    for (size_t i=1; code == 0 && i < started; i++)
+      pthread_join(handles[i], NULL);
+    for (size_t i=0; code == 0 && i < threads; i++)
+      pthread_mutex_destroy(&workers[i].lock);
+    free(handles);
+#else
+    for (size_t index=0; index < count; index++)
+      finish_job(&workers[0], index, parse_job(&workers[0], index));
+#endif
+  }
+
+  // report the code of the first job that failed
+  const bool parsed = code == 0;
+  size_t failed = count;
+  for (size_t i=0; i < batch.worker_count; i++) {
+    if (parsed && workers[i].code && workers[i].failed < failed) {
+      code = workers[i].code;
+      failed = workers[i].failed;
+    }
+    free(workers[i].window.data);
+    free(workers[i].parser);
+  }
+  free(workers);
+  return code;
+}
@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/stat.h>
 #if !defined(HAVE_GETOPT)
 # include "getopt.h"
 #else
@@ -22,6 +24,17 @@
 #include "attributes.h"
 #include "diagnostic.h"
 
+#if HAVE_MINCORE
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/resource.h>
+# include <unistd.h>
+#endif
+
+#if !_WIN32
+# include <dirent.h>
+#endif
+
 #if _MSC_VER
 #define strcasecmp(s1, s2) _stricmp(s1, s2)
 #define strncasecmp(s1, s2, n) _strnicmp(s1, s2, n)
@@ -31,6 +44,11 @@
 
 typedef zone_parser_t parser_t;
 
+#if HAVE_ICELAKE
+extern int32_t zone_bench_icelake_lex(zone_parser_t *, size_t *);
+extern int32_t zone_icelake_parse(zone_parser_t *);
+#endif
+
 #if HAVE_HASWELL
 extern int32_t zone_bench_haswell_lex(zone_parser_t *, size_t *);
 extern int32_t zone_haswell_parse(zone_parser_t *);
@@ -41,6 +59,16 @@ extern int32_t zone_bench_westmere_lex(zone_parser_t *, size_t *);
 extern int32_t zone_westmere_parse(zone_parser_t *);
 #endif
 
+#if HAVE_NEON
+extern int32_t zone_bench_neon_lex(zone_parser_t *, size_t *);
+extern int32_t zone_neon_parse(zone_parser_t *);
+#endif
+
+#if HAVE_VECTOR
+extern int32_t zone_bench_vector_lex(zone_parser_t *, size_t *);
+extern int32_t zone_vector_parse(zone_parser_t *);
+#endif
+
 extern int32_t zone_bench_fallback_lex(zone_parser_t *, size_t *);
 extern int32_t zone_fallback_parse(zone_parser_t *);
 
@@ -53,25 +81,25 @@ struct kernel {
 };
 
 static const kernel_t kernels[] = {
+#if HAVE_ICELAKE
+  { "icelake", AVX512F|AVX512BW|AVX512VL|AVX512VBMI2,
+    &zone_bench_icelake_lex, &zone_icelake_parse },
+#endif
 #if HAVE_HASWELL
   { "haswell", AVX2, &zone_bench_haswell_lex, &zone_haswell_parse },
 #endif
 #if HAVE_WESTMERE
   { "westmere", SSE42|PCLMULQDQ, &zone_bench_westmere_lex, &zone_westmere_parse },
+#endif
+#if HAVE_NEON
+  { "neon", NEON, &zone_bench_neon_lex, &zone_neon_parse },
+#endif
+#if HAVE_VECTOR
+  { "vector", DEFAULT, &zone_bench_vector_lex, &zone_vector_parse },
 #endif
   { "fallback", DEFAULT, &zone_bench_fallback_lex, &zone_fallback_parse }
 };
 
-extern int32_t zone_open(
-  zone_parser_t *,
-  const zone_options_t *,
-  zone_buffers_t *,
-  const char *,
-  void *user_data);
-
-extern void zone_close(
-  zone_parser_t *);
-
 static int32_t bench_lex(zone_parser_t *parser, const kernel_t *kernel)
 {
   size_t tokens = 0;
@@ -117,6 +145,21 @@ static int32_t bench_parse(zone_parser_t *parser, const kernel_t *kernel)
   return result;
 }
 
+// pull records one at a time like zone_next to compare against callbacks
+static int32_t bench_next(zone_parser_t *parser, const kernel_t *kernel)
+{
+  size_t records = 0;
+  int32_t result;
+  zone_rr_t rr;
+
+  parser->rr = &rr;
+  while ((result = kernel->parse(parser)) > 0)
+    records++;
+
+  printf("Parsed %zu records\n", records);
+  return result;
+}
+
 diagnostic_push()
 msvc_diagnostic_ignored(4996)
 
@@ -150,26 +193,222 @@ static const kernel_t *select_kernel(const char *name)
 
 diagnostic_pop()
 
+// wall-clock time in seconds, cpu time alone does not show the scanner
+// running ahead of the parser on a separate thread
+static double wall_time(void)
+{
+#if defined(CLOCK_MONOTONIC)
+  struct timespec now;
+  if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+  return (double)time(NULL);
+}
+
+// cpu time of the calling thread in seconds, the parser runs on the calling
+// thread, with -p the scanner runs on a thread of its own
+static double thread_time(void)
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec now;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0)
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+  return -1.0;
+}
+
+// report cpu time per byte to verify pathological inputs, e.g. as generated
+// by scripts/bench-zone.sh, are processed in time linear to the input
+static void report_time(
+  const char *path, clock_t ticks, double parser, double elapsed)
+{
+  struct stat status;
+  const double seconds = (double)ticks / CLOCKS_PER_SEC;
+
+  printf("CPU time %.3f seconds\n", seconds);
+  // scanner time is whatever was not spent on the calling thread
+  if (parser >= 0.0) {
+    printf("Parser CPU time %.3f seconds\n", parser);
+    printf("Scanner CPU time %.3f seconds\n",
+      seconds > parser ? seconds - parser : 0.0);
+  }
+  printf("Wall time %.3f seconds\n", elapsed);
+  if (stat(path, &status) == 0 && status.st_size > 0)
+    printf("CPU time per byte %.2f ns (%lld bytes)\n",
+      (seconds * 1e9) / (double)status.st_size, (long long)status.st_size);
+}
+
+#if HAVE_MINCORE
+// report page cache and memory usage to compare the effect of dropping
+// zone files from the page cache
+static void report_memory(const char *path)
+{
+  struct rusage usage;
+  struct stat status;
+  int fd;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    printf("Maximum resident set size %ld kB\n", usage.ru_maxrss);
+  if ((fd = open(path, O_RDONLY)) == -1)
+    return;
+  if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size) {
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t length = (size_t)status.st_size;
+    const size_t pages = (length + page_size - 1) / page_size;
+    void *data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    unsigned char *vector = malloc(pages);
+    if (data != MAP_FAILED && vector && mincore(data, length, (void *)vector) == 0) {
+      size_t cached = 0;
+      for (size_t i=0; i < pages; i++)
+        cached += vector[i] & 1;
+      printf("Page cache holds %zu of %zu pages\n", cached, pages);
+    }
+    free(vector);
+    if (data != MAP_FAILED)
+      (void)munmap(data, length);
+  }
+  (void)close(fd);
+}
+#endif
+
 static void help(const char *program)
 {
   const char *format =
-    "Usage: %s [OPTION] <lex or parse> <zone file>\n"
+    "Usage: %s [OPTION] <lex, parse or next> <zone file>\n"
+    "       %s [OPTION] batch <directory>\n"
     "\n"
     "Options:\n"
     "  -h         Display available options.\n"
+    "  -j threads Number of threads to parse a batch of zones on.\n"
+    "  -p         Scan on a separate thread ahead of the parser, reports\n"
+    "             scanner and parser CPU time separately.\n"
     "  -t target  Select target (default:%s)\n"
+    "  -u         Drop zone file from page cache once read.\n"
     "\n"
     "Kernels:\n";
 
-  printf(format, program, kernels[0].name);
+  printf(format, program, program, kernels[0].name);
 
   for (size_t i=0, n=sizeof(kernels)/sizeof(kernels[0]); i < n; i++)
     printf("  %s\n", kernels[i].name);
 }
 
+#if !_WIN32
+typedef struct batch_counts batch_counts_t;
+struct batch_counts {
+  size_t threads;
+  size_t *records;
+};
+
+static int32_t bench_batch_accept(
+  parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  const zone_chunk_t *chunk = user_data;
+  (void)parser;
+  (void)owner;
+  (void)type;
+  (void)class;
+  (void)ttl;
+  (void)rdlength;
+  (void)rdata;
+  // counters are kept per thread, jobs share a pointer to all counters
+  ((batch_counts_t *)chunk->user_data)->records[chunk->thread]++;
+  return ZONE_SUCCESS;
+}
+
+// parse every regular file in a directory as a zone to measure the overhead
+// per zone when loading many small zones
+static int32_t bench_batch(
+  const char *directory, size_t threads, zone_options_t *options)
+{
+  DIR *dir;
+  struct dirent *entry;
+  zone_job_t *jobs = NULL;
+  size_t count = 0, size = 0, failed = 0;
+  batch_counts_t counts = { threads, NULL };
+  zone_name_buffer_t *owner = NULL;
+  zone_rdata_buffer_t *rdata = NULL;
+  int32_t result = ZONE_OUT_OF_MEMORY, *codes = NULL;
+
+  if (!(dir = opendir(directory))) {
+    fprintf(stderr, "Cannot open %s\n", directory);
+    return ZONE_NOT_A_FILE;
+  }
+
+  while ((entry = readdir(dir))) {
+    struct stat status;
+    char *path;
+    const size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+    if (entry->d_name[0] == '.' || !(path = malloc(length)))
+      continue;
+    snprintf(path, length, "%s/%s", directory, entry->d_name);
+    if (stat(path, &status) != 0 || !S_ISREG(status.st_mode)) {
+      free(path);
+      continue;
+    }
+    if (count == size) {
+      zone_job_t *resized;
+      size = size ? size * 2 : 1024;
+      if (!(resized = realloc(jobs, size * sizeof(*jobs)))) {
+        free(path);
+        goto cleanup;
+      }
+      jobs = resized;
+    }
+    memset(&jobs[count], 0, sizeof(jobs[count]));
+    jobs[count].path = path;
+    jobs[count].user_data = &counts;
+    count++;
+  }
+
+  owner = malloc(threads * sizeof(*owner));
+  rdata = malloc(threads * sizeof(*rdata));
+  counts.records = calloc(threads, sizeof(*counts.records));
+  codes = malloc((count ? count : 1) * sizeof(*codes));
+  if (owner && rdata && counts.records && codes) {
+    zone_buffers_t buffers = { threads, owner, rdata };
+    options->accept.callback = &bench_batch_accept;
+    const clock_t start = clock();
+    const double wall_start = wall_time();
+    result = zone_parse_batch(options, &buffers, jobs, count, threads, codes);
+    const double elapsed = wall_time() - wall_start;
+
+    size_t records = 0;
+    for (size_t i=0; i < threads; i++)
+      records += counts.records[i];
+    for (size_t i=0; i < count; i++)
+      failed += codes[i] != ZONE_SUCCESS;
+    printf("Parsed %zu zones (%zu failed), %zu records on %zu threads\n",
+      count, failed, records, threads);
+    printf("CPU time %.3f seconds\n", (double)(clock() - start) / CLOCKS_PER_SEC);
+    printf("Wall time %.3f seconds\n", elapsed);
+    if (elapsed > 0)
+      printf("Zones per second %.0f\n", (double)count / elapsed);
+  }
+
+cleanup:
+  free(owner);
+  free(rdata);
+  for (size_t i=0; i < count; i++)
+    free((char *)jobs[i].path);
+  free(jobs);
+  free(codes);
+  free(counts.records);
+  (void)closedir(dir);
+  return result;
+}
+#endif
+
 static void usage(const char *program)
 {
-  fprintf(stderr, "Usage: %s [OPTION] <lex or parse> <zone file>\n", program);
+  fprintf(stderr, "Usage: %s [OPTION] <lex, parse, next or batch> <zone file>\n", program);
   exit(EXIT_FAILURE);
 }
 
@@ -178,19 +417,32 @@ static uint8_t root[] = { 0 };
 int main(int argc, char *argv[])
 {
   const char *name = NULL, *program = argv[0];
+  bool no_page_cache = false, pipeline = false;
+  size_t threads = 1;
 
   for (const char *slash = argv[0]; *slash; slash++)
     if (*slash == '/' || *slash == '\\')
       program = slash + 1;
 
-  for (int option; (option = getopt(argc, argv, "ht:")) != -1;) {
+  for (int option; (option = getopt(argc, argv, "hj:pt:u")) != -1;) {
     switch (option) {
       case 'h':
         help(program);
         exit(EXIT_SUCCESS);
+      case 'j':
+        threads = (size_t)strtoul(optarg, NULL, 10);
+        if (!threads)
+          usage(program);
+        break;
+      case 'p':
+        pipeline = true;
+        break;
       case 't':
         name = optarg;
         break;
+      case 'u':
+        no_page_cache = true;
+        break;
       default:
         usage(program);
     }
@@ -200,10 +452,32 @@ int main(int argc, char *argv[])
     usage(program);
 
   int32_t (*bench)(zone_parser_t *, const kernel_t *) = 0;
-  if (strcasecmp(argv[optind], "lex") == 0)
+  if (strcasecmp(argv[optind], "batch") == 0) {
+#if !_WIN32
+    // kernel is selected by the library, once for the whole batch
+    if (name && setenv("ZONE_KERNEL", name, 1) != 0)
+      exit(EXIT_FAILURE);
+    zone_options_t options;
+    memset(&options, 0, sizeof(options));
+    options.pretty_ttls = true;
+    options.no_page_cache = no_page_cache;
+    options.origin.octets = root;
+    options.origin.length = 1;
+    options.default_ttl = 3600;
+    options.default_class = 1;
+    if (bench_batch(argv[argc-1], threads, &options) < 0)
+      exit(EXIT_FAILURE);
+    return EXIT_SUCCESS;
+#else
+    fprintf(stderr, "Batch mode is not supported on this platform\n");
+    exit(EXIT_FAILURE);
+#endif
+  } else if (strcasecmp(argv[optind], "lex") == 0)
     bench = &bench_lex;
   else if (strcasecmp(argv[optind], "parse") == 0)
     bench = &bench_parse;
+  else if (strcasecmp(argv[optind], "next") == 0)
+    bench = &bench_next;
   else
     usage(program);
 
@@ -216,6 +490,8 @@ int main(int argc, char *argv[])
   zone_options_t options;
   memset(&options, 0, sizeof(options));
   options.pretty_ttls = true;
+  options.no_page_cache = no_page_cache;
+  options.pipeline = pipeline;
   options.origin.octets = root;
   options.origin.length = 1;
   options.accept.callback = &bench_accept;
@@ -228,9 +504,22 @@ int main(int argc, char *argv[])
 
   if (zone_open(&parser, &options, &buffers, argv[argc-1], NULL) < 0)
     exit(EXIT_FAILURE);
-  if (bench(&parser, kernel) < 0)
-    exit(EXIT_FAILURE);
+  // report time for inputs that fail to parse, e.g. unterminated quotes
+  const clock_t start = clock();
+  const double wall_start = wall_time();
+  const double thread_start = pipeline ? thread_time() : -1.0;
+  const int32_t result = bench(&parser, kernel);
+  const double thread_end = pipeline ? thread_time() : -1.0;
+  const double parser_time =
+    thread_start >= 0.0 && thread_end >= 0.0 ? thread_end - thread_start : -1.0;
+  report_time(
+    argv[argc-1], clock() - start, parser_time, wall_time() - wall_start);
 
   zone_close(&parser);
+  if (result < 0)
+    exit(EXIT_FAILURE);
+#if HAVE_MINCORE
+  report_memory(argv[argc-1]);
+#endif
   return EXIT_SUCCESS;
 }
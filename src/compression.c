@@ -0,0 +1,546 @@
+/*
+ * compression.c -- read gzip and zstd compressed zone files
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include "config.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if HAVE_MMAP
+#  include <sys/mman.h>
+#endif
+#if HAVE_ZLIB
+#  include <zlib.h>
+#endif
+#if HAVE_ZSTD
+#  include <zstd.h>
+#endif
+#if HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+// frames of multi-frame zstd files are decompressed on worker threads
+#if HAVE_ZSTD && HAVE_PTHREAD && HAVE_MMAP
+#  define HAVE_ZSTD_THREADS 1
+#endif
+
+#include "zone.h"
+#include "attributes.h"
+#include "internal.h"
+
+#if HAVE_ZLIB || HAVE_ZSTD
+// compressed input is read in larger chunks than the window is refilled
+#define COMPRESSED_SIZE (4 * ZONE_WINDOW_SIZE)
+
+#define GZIP_FORMAT (1)
+#define ZSTD_FORMAT (2)
+
+#if HAVE_ZSTD_THREADS
+// frames are decompressed into slots, two per thread, so that workers
+// can decompress the next frame while the parser consumes the current one
+#define FRAME_SLOTS_PER_THREAD (2)
+
+typedef struct frame_slot frame_slot_t;
+struct frame_slot {
+  /** sequence number of the frame in the slot */
+  size_t sequence;
+  bool ready, failed;
+  size_t index, length, size;
+  char *data;
+};
+
+typedef struct frame_pool frame_pool_t;
+struct frame_pool {
+  pthread_mutex_t lock;
+  /** signaled if a frame is decompressed */
+  pthread_cond_t ready;
+  /** signaled if a slot is released */
+  pthread_cond_t released;
+  /** compressed file mapped into memory */
+  const char *input;
+  size_t size;
+  /** offset of the next frame */
+  size_t offset;
+  /** sequence number of the next frame to decompress and to consume */
+  size_t next, consumed;
+  bool stop;
+  size_t slot_count, thread_count;
+  frame_slot_t *slots;
+  pthread_t *threads;
+};
+#endif
+
+struct zone_decompressor {
+  int format;
+  /** all compressed input read, the stream may continue */
+  bool end_of_input;
+  /** all data decompressed */
+  bool end_of_stream;
+#if HAVE_ZLIB
+  z_stream gzip;
+#endif
+#if HAVE_ZSTD
+  ZSTD_DCtx *zstd;
+  /** zero at the end of each frame, truncated input otherwise */
+  size_t pending;
+#endif
+#if HAVE_ZSTD_THREADS
+  frame_pool_t *pool;
+#endif
+  struct { size_t index, length; char data[COMPRESSED_SIZE]; } input;
+};
+
+#if HAVE_ZSTD_THREADS
+// decompress a single frame into the slot, grow the slot if the frame does
+// not fit. frames are not limited in size, concatenated files may consist of
+// arbitrarily large frames. returns zero on success, -1 otherwise
+nonnull_all
+static int decompress_frame(
+  ZSTD_DCtx *context, frame_slot_t *slot, const char *data, size_t size)
+{
+  const unsigned long long content = ZSTD_getFrameContentSize(data, size);
+  size_t capacity = 16 * size;
+  // content size is not trusted beyond a reasonable compression ratio
+  if (content != ZSTD_CONTENTSIZE_UNKNOWN &&
+      content != ZSTD_CONTENTSIZE_ERROR && content < capacity)
+    capacity = (size_t)content;
+  if (capacity < ZONE_WINDOW_SIZE)
+    capacity = ZONE_WINDOW_SIZE;
+
+  if (slot->size < capacity) {
+    char *buffer;
+    if (!(buffer = realloc(slot->data, capacity)))
+      return -1;
+    slot->data = buffer;
+    slot->size = capacity;
+  }
+
+  ZSTD_inBuffer input = { data, size, 0 };
+  ZSTD_outBuffer output = { slot->data, slot->size, 0 };
+  (void)ZSTD_DCtx_reset(context, ZSTD_reset_session_only);
+  for (;;) {
+    const size_t result = ZSTD_decompressStream(context, &output, &input);
+    if (ZSTD_isError(result))
+      return -1;
+    if (result == 0)
+      break;
+    if (output.pos < output.size) {
+      // frame is truncated
+      if (input.pos == input.size)
+        return -1;
+      continue;
+    }
+    if (slot->size > SIZE_MAX / 2)
+      return -1;
+    char *buffer;
+    if (!(buffer = realloc(slot->data, slot->size * 2)))
+      return -1;
+    slot->data = buffer;
+    slot->size *= 2;
+    output.dst = buffer;
+    output.size = slot->size;
+  }
+
+  slot->index = 0;
+  slot->length = output.pos;
+  return 0;
+}
+
+static void *decompress_frames(void *argument)
+{
+  frame_pool_t *pool = argument;
+  ZSTD_DCtx *context = ZSTD_createDCtx();
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    // wait for a free slot
+    while (!pool->stop && pool->offset < pool->size &&
+           pool->next >= pool->consumed + pool->slot_count)
+      pthread_cond_wait(&pool->released, &pool->lock);
+    if (pool->stop || pool->offset >= pool->size)
+      break;
+
+    const size_t sequence = pool->next++;
+    frame_slot_t *slot = &pool->slots[sequence % pool->slot_count];
+    const char *data = pool->input + pool->offset;
+    const size_t size =
+      ZSTD_findFrameCompressedSize(data, pool->size - pool->offset);
+    bool failed = !context || ZSTD_isError(size);
+    // frames are claimed in order, stop claiming frames on error
+    pool->offset = failed ? pool->size : pool->offset + size;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!failed)
+      failed = decompress_frame(context, slot, data, size) != 0;
+
+    pthread_mutex_lock(&pool->lock);
+    slot->sequence = sequence;
+    slot->failed = failed;
+    slot->ready = true;
+    pthread_cond_broadcast(&pool->ready);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  ZSTD_freeDCtx(context);
+  return NULL;
+}
+
+nonnull_all
+static void close_frame_pool(struct zone_decompressor *decompressor)
+{
+  frame_pool_t *pool = decompressor->pool;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->released);
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t i=0; i < pool->thread_count; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  for (size_t i=0; i < pool->slot_count; i++)
+    free(pool->slots[i].data);
+  free(pool->slots);
+  free(pool->threads);
+  (void)munmap((void *)pool->input, pool->size);
+  pthread_cond_destroy(&pool->released);
+  pthread_cond_destroy(&pool->ready);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+  decompressor->pool = NULL;
+}
+
+// frames of multi-frame files are independent and are decompressed on
+// worker threads ahead of the parser. the file is mapped into memory to
+// find frame boundaries. zero is returned if the file is not a regular
+// file or consists of a single frame, the file is then decompressed on
+// the calling thread
+nonnull_all
+static int32_t open_frame_pool(
+  parser_t *parser, file_t *file, struct zone_decompressor *decompressor)
+{
+  struct stat status;
+  frame_pool_t *pool;
+  void *input;
+  const int fd = fileno(file->handle);
+  const size_t threads = parser->options.decompress_threads;
+
+  if (threads < 2)
+    return 0;
+  if (fd == -1 || fstat(fd, &status) == -1 || !S_ISREG(status.st_mode))
+    return 0;
+  if (status.st_size <= 0 || (uint64_t)status.st_size > SIZE_MAX)
+    return 0;
+
+  const size_t size = (size_t)status.st_size;
+  input = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (input == MAP_FAILED)
+    return 0;
+  const size_t first = ZSTD_findFrameCompressedSize(input, size);
+  if (ZSTD_isError(first) || first >= size)
+    return (void)munmap(input, size), 0;
+#if defined MADV_SEQUENTIAL
+  (void)madvise(input, size, MADV_SEQUENTIAL);
+#endif
+
+  if (!(pool = calloc(1, sizeof(*pool))))
+    return (void)munmap(input, size), ZONE_OUT_OF_MEMORY;
+  pool->input = input;
+  pool->size = size;
+  pool->slot_count = threads * FRAME_SLOTS_PER_THREAD;
+  pool->slots = calloc(pool->slot_count, sizeof(*pool->slots));
+  pool->threads = calloc(threads, sizeof(*pool->threads));
+  if (!pool->slots || !pool->threads) {
+    free(pool->slots);
+    free(pool->threads);
+    free(pool);
+    (void)munmap(input, size);
+    return ZONE_OUT_OF_MEMORY;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->ready, NULL);
+  pthread_cond_init(&pool->released, NULL);
+  decompressor->pool = pool;
+  for (; pool->thread_count < threads; pool->thread_count++) {
+    if (pthread_create(&pool->threads[pool->thread_count], NULL,
+                       decompress_frames, pool) != 0)
+      break;
+  }
+
+  // decompress on the calling thread if no worker could be started
+  if (!pool->thread_count)
+    return close_frame_pool(decompressor), 0;
+  return 1;
+}
+
+nonnull_all
+static int32_t read_frames(
+  struct zone_decompressor *decompressor, char *data, size_t size, size_t *count)
+{
+  frame_pool_t *pool = decompressor->pool;
+  size_t length = 0;
+  int32_t code = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  while (length < size) {
+    frame_slot_t *slot = &pool->slots[pool->consumed % pool->slot_count];
+    while (!(slot->ready && slot->sequence == pool->consumed) &&
+           !(pool->offset >= pool->size && pool->consumed == pool->next))
+      pthread_cond_wait(&pool->ready, &pool->lock);
+    if (!slot->ready || slot->sequence != pool->consumed) {
+      decompressor->end_of_stream = true;
+      break;
+    }
+    if (slot->failed) {
+      code = ZONE_READ_ERROR;
+      break;
+    }
+
+    // slot is not touched by workers until released
+    pthread_mutex_unlock(&pool->lock);
+    size_t chunk = slot->length - slot->index;
+    if (chunk > size - length)
+      chunk = size - length;
+    memcpy(data + length, slot->data + slot->index, chunk);
+    slot->index += chunk;
+    length += chunk;
+    pthread_mutex_lock(&pool->lock);
+
+    if (slot->index == slot->length) {
+      slot->ready = false;
+      pool->consumed++;
+      pthread_cond_broadcast(&pool->released);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  *count = length;
+  return code;
+}
+#endif
+
+nonnull_all
+void zone_close_decompressor(file_t *file)
+{
+  struct zone_decompressor *decompressor = file->decompressor;
+
+#if HAVE_ZSTD_THREADS
+  if (decompressor->pool)
+    close_frame_pool(decompressor);
+#endif
+#if HAVE_ZLIB
+  if (decompressor->format == GZIP_FORMAT)
+    (void)inflateEnd(&decompressor->gzip);
+#endif
+#if HAVE_ZSTD
+  if (decompressor->format == ZSTD_FORMAT)
+    ZSTD_freeDCtx(decompressor->zstd);
+#endif
+  free(decompressor);
+  file->decompressor = NULL;
+}
+
+// compressed files are detected by magic bytes and decompressed into the
+// window. bytes read to detect the format are put back, or copied to magic
+// if the stream is not seekable, in which case the number of bytes that
+// must be prepended to the input is returned
+nonnull_all
+int32_t zone_open_decompressor(
+  parser_t *parser, file_t *file, char magic[4], size_t *length)
+{
+  static const char gzip[2] = { '\x1f', '\x8b' };
+  static const char zstd[4] = { '\x28', '\xb5', '\x2f', '\xfd' };
+  struct zone_decompressor *decompressor;
+  int format = 0;
+
+  *length = fread(magic, 1, 4, file->handle);
+  if (*length < 4 && ferror(file->handle))
+    return ZONE_READ_ERROR;
+#if HAVE_ZLIB
+  if (*length >= sizeof(gzip) && memcmp(magic, gzip, sizeof(gzip)) == 0)
+    format = GZIP_FORMAT;
+#endif
+#if HAVE_ZSTD
+  if (*length >= sizeof(zstd) && memcmp(magic, zstd, sizeof(zstd)) == 0)
+    format = ZSTD_FORMAT;
+#endif
+  (void)gzip;
+  (void)zstd;
+
+  // regular files are rewound, other streams are not seekable
+  if (fseek(file->handle, 0, SEEK_SET) == 0)
+    *length = 0;
+  else
+    clearerr(file->handle);
+  if (!format)
+    return 0;
+
+  if (!(decompressor = calloc(1, sizeof(*decompressor))))
+    return ZONE_OUT_OF_MEMORY;
+  decompressor->format = format;
+  memcpy(decompressor->input.data, magic, *length);
+  decompressor->input.length = *length;
+  *length = 0;
+
+#if HAVE_ZLIB
+  if (format == GZIP_FORMAT) {
+    // accept gzip format only, add 16 to window bits
+    if (inflateInit2(&decompressor->gzip, 16 + MAX_WBITS) != Z_OK)
+      return free(decompressor), ZONE_OUT_OF_MEMORY;
+    decompressor->gzip.next_in = (Bytef *)decompressor->input.data;
+    decompressor->gzip.avail_in = (uInt)decompressor->input.length;
+  }
+#endif
+#if HAVE_ZSTD
+  if (format == ZSTD_FORMAT) {
+    if (!(decompressor->zstd = ZSTD_createDCtx()))
+      return free(decompressor), ZONE_OUT_OF_MEMORY;
+    decompressor->pending = 1;
+  }
+#endif
+
+  file->decompressor = decompressor;
+#if HAVE_ZSTD_THREADS
+  int32_t code;
+  if (format == ZSTD_FORMAT &&
+      (code = open_frame_pool(parser, file, decompressor)) < 0)
+    return zone_close_decompressor(file), code;
+#else
+  (void)parser;
+#endif
+  return 0;
+}
+
+// refill compressed input, all data must have been consumed
+nonnull_all
+static int32_t read_compressed(
+  parser_t *parser, file_t *file, struct zone_decompressor *decompressor)
+{
+  int32_t code;
+  size_t count;
+
+  if ((code = zone_read_handle(parser, file, decompressor->input.data,
+                               sizeof(decompressor->input.data), &count)) < 0)
+    return code;
+  decompressor->input.index = 0;
+  decompressor->input.length = count;
+  decompressor->end_of_input = file->end_of_file != 0;
+  return 0;
+}
+
+#if HAVE_ZLIB
+nonnull_all
+static int32_t inflate_file(
+  parser_t *parser, file_t *file, char *data, size_t size, size_t *count)
+{
+  struct zone_decompressor *decompressor = file->decompressor;
+  z_stream *stream = &decompressor->gzip;
+  int32_t code;
+
+  stream->next_out = (Bytef *)data;
+  stream->avail_out = (uInt)size;
+  while (stream->avail_out && !decompressor->end_of_stream) {
+    if (!stream->avail_in) {
+      // input ended before the end of the stream
+      if (decompressor->end_of_input)
+        return ZONE_READ_ERROR;
+      if ((code = read_compressed(parser, file, decompressor)) < 0)
+        return code;
+      stream->next_in = (Bytef *)decompressor->input.data;
+      stream->avail_in = (uInt)decompressor->input.length;
+      continue;
+    }
+
+    const int result = inflate(stream, Z_NO_FLUSH);
+    if (result == Z_STREAM_END) {
+      // gzip files may consist of multiple members
+      if (!stream->avail_in && !decompressor->end_of_input) {
+        if ((code = read_compressed(parser, file, decompressor)) < 0)
+          return code;
+        stream->next_in = (Bytef *)decompressor->input.data;
+        stream->avail_in = (uInt)decompressor->input.length;
+      }
+      if (!stream->avail_in && decompressor->end_of_input)
+        decompressor->end_of_stream = true;
+      else if (inflateReset(stream) != Z_OK)
+        return ZONE_READ_ERROR;
+    } else if (result != Z_OK && result != Z_BUF_ERROR) {
+      return ZONE_READ_ERROR;
+    }
+  }
+
+  *count = size - stream->avail_out;
+  return 0;
+}
+#endif
+
+#if HAVE_ZSTD
+nonnull_all
+static int32_t unzstd_file(
+  parser_t *parser, file_t *file, char *data, size_t size, size_t *count)
+{
+  struct zone_decompressor *decompressor = file->decompressor;
+  ZSTD_outBuffer output = { data, size, 0 };
+  int32_t code;
+
+#if HAVE_ZSTD_THREADS
+  if (decompressor->pool)
+    return read_frames(decompressor, data, size, count);
+#endif
+
+  while (output.pos < output.size && !decompressor->end_of_stream) {
+    if (decompressor->input.index == decompressor->input.length) {
+      if (decompressor->end_of_input) {
+        // input ended before the end of the frame
+        if (decompressor->pending)
+          return ZONE_READ_ERROR;
+        decompressor->end_of_stream = true;
+      } else if ((code = read_compressed(parser, file, decompressor)) < 0) {
+        return code;
+      }
+      continue;
+    }
+
+    ZSTD_inBuffer input = {
+      decompressor->input.data,
+      decompressor->input.length,
+      decompressor->input.index };
+    const size_t result =
+      ZSTD_decompressStream(decompressor->zstd, &output, &input);
+    if (ZSTD_isError(result))
+      return ZONE_READ_ERROR;
+    decompressor->input.index = input.pos;
+    decompressor->pending = result;
+  }
+
+  *count = output.pos;
+  return 0;
+}
+#endif
+
+nonnull_all
+int32_t zone_decompress(
+  parser_t *parser, file_t *file, char *data, size_t size, size_t *count)
+{
+  int32_t code = ZONE_READ_ERROR;
+
+  *count = 0;
+#if HAVE_ZLIB
+  if (file->decompressor->format == GZIP_FORMAT)
+    code = inflate_file(parser, file, data, size, count);
+#endif
+#if HAVE_ZSTD
+  if (file->decompressor->format == ZSTD_FORMAT)
+    code = unzstd_file(parser, file, data, size, count);
+#endif
+  file->end_of_file = file->decompressor->end_of_stream;
+  return code;
+}
+#endif
@@ -9,8 +9,12 @@
 #include "zone.h"
 #include "attributes.h"
 #include "diagnostic.h"
+#include "generic/endian.h"
+#include "fallback/simd.h"
+#include "fallback/bits.h"
 #include "generic/parser.h"
-#include "fallback/scanner.h"
+#include "generic/scanner.h"
+#include "generic/indexer.h"
 
 diagnostic_push()
 clang_diagnostic_ignored(missing-prototypes)
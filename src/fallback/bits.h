@@ -9,6 +9,50 @@
 #ifndef BITS_H
 #define BITS_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+static really_inline bool add_overflow(
+  uint64_t value1, uint64_t value2, uint64_t *result)
+{
+#if has_builtin(__builtin_uaddll_overflow)
+  return __builtin_uaddll_overflow(value1, value2, (unsigned long long *)result);
+#else
+  *result = value1 + value2;
+  return *result < value1;
+#endif
+}
+
+static really_inline uint64_t count_ones(uint64_t bits)
+{
+#if (defined __POPCNT__ || defined __aarch64__ || defined __riscv_zbb || \
+     defined _ARCH_PWR7) && has_builtin(__builtin_popcountll)
+  return (uint64_t)__builtin_popcountll(bits);
+#else
+  bits = bits - ((bits >> 1) & 0x5555555555555555llu);
+  bits = (bits & 0x3333333333333333llu) + ((bits >> 2) & 0x3333333333333333llu);
+  bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0fllu;
+  return (bits * 0x0101010101010101llu) >> 56;
+#endif
+}
+
+// result might be undefined when bits is zero
+static really_inline uint64_t clear_lowest_bit(uint64_t bits)
+{
+  return bits & (bits - 1);
+}
+
+static really_inline uint64_t prefix_xor(uint64_t bitmask)
+{
+  bitmask ^= bitmask << 1;
+  bitmask ^= bitmask << 2;
+  bitmask ^= bitmask << 4;
+  bitmask ^= bitmask << 8;
+  bitmask ^= bitmask << 16;
+  bitmask ^= bitmask << 32;
+  return bitmask;
+}
+
 #if _MSC_VER
 #include <intrin.h>
 
@@ -32,6 +76,7 @@ static really_inline uint64_t leading_zeroes(uint64_t mask)
 
 #else
 
+no_sanitize_undefined
 static really_inline uint64_t trailing_zeroes(uint64_t mask)
 {
 #if has_builtin(__builtin_ctzll)
@@ -55,6 +100,7 @@ static really_inline uint64_t trailing_zeroes(uint64_t mask)
 #endif
 }
 
+no_sanitize_undefined
 static really_inline uint64_t leading_zeroes(uint64_t mask)
 {
 #if has_builtin(__builtin_clzll)
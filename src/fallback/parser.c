@@ -10,16 +10,18 @@
 #include "attributes.h"
 #include "diagnostic.h"
 #include "generic/endian.h"
+#include "fallback/simd.h"
 #include "fallback/bits.h"
 #include "generic/parser.h"
-#include "fallback/scanner.h"
+#include "generic/scanner.h"
+#include "generic/indexer.h"
 #include "generic/number.h"
 #include "generic/ttl.h"
 #include "generic/time.h"
-#include "fallback/text.h"
-#include "fallback/name.h"
 #include "generic/ip4.h"
 #include "generic/ip6.h"
+#include "generic/text.h"
+#include "generic/name.h"
 #include "generic/base16.h"
 #include "generic/base32.h"
 #include "generic/base64.h"
@@ -0,0 +1,167 @@
+/*
+ * simd.h -- SIMD abstractions using SWAR (SIMD within a register)
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define SIMD_8X_SIZE (16)
+
+typedef uint8_t simd_table_t[SIMD_8X_SIZE];
+
+#define SIMD_TABLE(v00, v01, v02, v03, v04, v05, v06, v07, \
+                   v08, v09, v0a, v0b, v0c, v0d, v0e, v0f) \
+  {                                                        \
+    v00, v01, v02, v03, v04, v05, v06, v07,                \
+    v08, v09, v0a, v0b, v0c, v0d, v0e, v0f                 \
+  }
+
+// operate on 8 bytes at a time in general purpose registers. words hold the
+// input as is, conversion to little endian is done when searching so that
+// the least significant byte always corresponds to the first character
+typedef struct { uint64_t chunks[2]; } simd_8x_t;
+
+typedef simd_8x_t simd_8x16_t;
+
+typedef struct { uint64_t chunks[4]; } simd_8x32_t;
+
+typedef struct { uint64_t chunks[8]; } simd_8x64_t;
+
+#define SIMD_ONES (0x0101010101010101llu)
+#define SIMD_LOW7 (0x7f7f7f7f7f7f7f7fllu)
+
+// most significant bit of each byte is cleared if the byte is zero. unlike
+// the well-known haszero trick there are no false positives caused by
+// borrows, which is required to compute exact masks
+static really_inline uint64_t simd_nonzero_8x8(uint64_t word)
+{
+  return ((word & SIMD_LOW7) + SIMD_LOW7) | word;
+}
+
+// gather the most significant bit of each byte into the lower 8 bits. bit
+// 8i+7 is moved to bit 56+i by the multiplication, products do not overlap
+static really_inline uint64_t simd_movemask_8x8(uint64_t word)
+{
+  return ((word & ~SIMD_LOW7) * 0x0002040810204081llu) >> 56;
+}
+
+static really_inline uint64_t simd_match_8x8(uint64_t word, uint8_t key)
+{
+  return ~simd_nonzero_8x8(le64toh(word) ^ (SIMD_ONES * key));
+}
+
+// byte v is matched by table if v == table[v & 0x0f] (pshufb semantics),
+// which is true only for entries whose lower nibble equals their index.
+// tables are constant, the compiler reduces the comparisons to the entries
+// that match. loops are not necessarily unrolled, hence the macro
+#define SIMD_MATCH(r, v, table, i) \
+  if ((table[i] & 0x8f) == i) \
+    r &= simd_nonzero_8x8(v ^ (SIMD_ONES * table[i]));
+
+static really_inline uint64_t simd_match_any_8x8(
+  uint64_t word, const simd_table_t table)
+{
+  const uint64_t v = le64toh(word);
+  uint64_t r = ~0llu;
+  SIMD_MATCH(r, v, table, 0x0) SIMD_MATCH(r, v, table, 0x1)
+  SIMD_MATCH(r, v, table, 0x2) SIMD_MATCH(r, v, table, 0x3)
+  SIMD_MATCH(r, v, table, 0x4) SIMD_MATCH(r, v, table, 0x5)
+  SIMD_MATCH(r, v, table, 0x6) SIMD_MATCH(r, v, table, 0x7)
+  SIMD_MATCH(r, v, table, 0x8) SIMD_MATCH(r, v, table, 0x9)
+  SIMD_MATCH(r, v, table, 0xa) SIMD_MATCH(r, v, table, 0xb)
+  SIMD_MATCH(r, v, table, 0xc) SIMD_MATCH(r, v, table, 0xd)
+  SIMD_MATCH(r, v, table, 0xe) SIMD_MATCH(r, v, table, 0xf)
+  return ~r;
+}
+
+#undef SIMD_MATCH
+
+nonnull_all
+static really_inline void simd_loadu_8x(simd_8x_t *simd, const uint8_t *address)
+{
+  memcpy(simd->chunks, address, 16);
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x(uint8_t *address, const simd_8x_t *simd)
+{
+  memcpy(address, simd->chunks, 16);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x(const simd_8x_t *simd, char key)
+{
+  const uint64_t m0 = simd_movemask_8x8(simd_match_8x8(simd->chunks[0], (uint8_t)key));
+  const uint64_t m1 = simd_movemask_8x8(simd_match_8x8(simd->chunks[1], (uint8_t)key));
+  return m0 | (m1 << 8);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_any_8x(
+  const simd_8x_t *simd, const simd_table_t table)
+{
+  const uint64_t m0 = simd_movemask_8x8(simd_match_any_8x8(simd->chunks[0], table));
+  const uint64_t m1 = simd_movemask_8x8(simd_match_any_8x8(simd->chunks[1], table));
+  return m0 | (m1 << 8);
+}
+
+#define simd_loadu_8x16(simd, address) simd_loadu_8x(simd, address)
+#define simd_find_8x16(simd, key) simd_find_8x(simd, key)
+
+nonnull_all
+static really_inline void simd_loadu_8x32(simd_8x32_t *simd, const char *address)
+{
+  memcpy(simd->chunks, address, 32);
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x32(uint8_t *address, const simd_8x32_t *simd)
+{
+  memcpy(address, simd->chunks, 32);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x32(const simd_8x32_t *simd, char key)
+{
+  uint64_t r = 0;
+  for (uint64_t i=0; i < 4; i++)
+    r |= simd_movemask_8x8(simd_match_8x8(simd->chunks[i], (uint8_t)key)) << (i*8);
+  return r;
+}
+
+nonnull_all
+static really_inline void simd_loadu_8x64(simd_8x64_t *simd, const uint8_t *address)
+{
+  memcpy(simd->chunks, address, 64);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x64(const simd_8x64_t *simd, char key)
+{
+  uint64_t r = 0;
+  for (uint64_t i=0; i < 8; i++)
+    r |= simd_movemask_8x8(simd_match_8x8(simd->chunks[i], (uint8_t)key)) << (i*8);
+  return r;
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_any_8x64(
+  const simd_8x64_t *simd, const simd_table_t table)
+{
+  uint64_t r = 0;
+  for (uint64_t i=0; i < 8; i++)
+    r |= simd_movemask_8x8(simd_match_any_8x8(simd->chunks[i], table)) << (i*8);
+  return r;
+}
+
+#undef SIMD_LOW7
+#undef SIMD_ONES
+
+#endif // SIMD_H
@@ -182,6 +182,11 @@ static really_inline int base16_stream_decode(
 #endif
     {
     case 0:
+#if defined BASE16_DEC_LOOP
+      // kernels may supply a vectorized loop that decodes the bulk of the
+      // input and stops at the first character that is not a digit
+      BASE16_DEC_LOOP(&s, &slen, &o, &olen);
+#endif
       base16_dec_loop_generic_32(&s, &slen, &o, &olen);
       if (slen-- == 0) {
         ret = 1;
@@ -584,6 +584,11 @@ static really_inline int base64_stream_decode(
 #endif
     {
     case 0:
+#if defined BASE64_DEC_LOOP
+      // kernels may supply a vectorized loop that decodes the bulk of the
+      // input and stops at the first character not in the alphabet
+      BASE64_DEC_LOOP(&s, &slen, &o, &olen);
+#endif
       dec_loop_generic_32(&s, &slen, &o, &olen);
       if (slen-- == 0) {
         ret = 1;
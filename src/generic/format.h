@@ -313,6 +313,9 @@ static really_inline int32_t parse_dollar_include(
   }
 
   adjust_line_count(parser->file);
+  // files included from the top-level file may be parsed on other threads
+  if (unlikely(parser->includes) && parser->file == &parser->first)
+    return zone_defer_include(parser, file);
   parser->file = file;
   return 0;
 }
@@ -362,7 +365,73 @@ static really_inline int32_t parse_dollar_ttl(
   return 0;
 }
 
-static inline int32_t parse(parser_t *parser)
+// input pushed by the application may end in the middle of a record. the
+// start of each record is marked so that the parser can be rewound and the
+// record is parsed again once more input is fed
+nonnull_all
+static never_inline int32_t mark_record(parser_t *parser)
+{
+  int32_t code;
+  token_t token;
+  file_t *file = parser->file;
+
+  file->stream.restart = NULL;
+  file->stream.fields = NULL;
+  for (;;) {
+    const int32_t kind = (int32_t)classify[ (uint8_t)**file->fields.head ];
+    if (kind == END_OF_FILE) {
+      if (file->end_of_file == NO_MORE_DATA)
+        return 0;
+      if ((code = advance(parser)) < 0)
+        return code;
+    } else if (kind == LINE_FEED) {
+      take(parser, &token);
+      adjust_line_count(file);
+    } else {
+      break;
+    }
+  }
+
+  file->stream.restart = *file->fields.head;
+  file->stream.fields = file->fields.head;
+  file->stream.delimiters = file->delimiters.head;
+  file->stream.newlines = file->newlines.head;
+  file->stream.line = file->line;
+  file->stream.span = file->span;
+  file->stream.start_of_line = file->start_of_line;
+  return 0;
+}
+
+nonnull_all
+static void rewind_record(parser_t *parser)
+{
+  file_t *file = parser->file;
+
+  if (!file->stream.restart)
+    return;
+  if (file->stream.fields) {
+    // tokens of the record are kept, scanning resumes where it left off
+    file->fields.head = file->stream.fields;
+    file->delimiters.head = file->stream.delimiters;
+    file->newlines.head = file->stream.newlines;
+  } else {
+    // scanning resumes at the start of the record
+    file->buffer.index = (size_t)(file->stream.restart - file->buffer.data);
+    memset(&file->state, 0, sizeof(file->state));
+    file->fields.tape[0] = file->fields.tape[1] = end_of_file;
+    file->fields.head = file->fields.tail = file->fields.tape;
+    file->delimiters.head = file->delimiters.tail = file->delimiters.tape;
+    file->newlines.tape[0] = 0;
+    file->newlines.head = file->newlines.tail = file->newlines.tape;
+  }
+  file->line = file->stream.line;
+  file->span = file->stream.span;
+  file->start_of_line = file->stream.start_of_line;
+  file->grouped = false;
+  file->stream.restart = NULL;
+}
+
+static inline int32_t parse_records(parser_t *parser)
 {
   static const rdata_info_t fields[] = { FIELD("OWNER") };
   static const type_info_t rr = ENTRY("RR", FIELDS(fields));
@@ -371,9 +440,18 @@ static inline int32_t parse(parser_t *parser)
   token_t token;
 
   while (code >= 0) {
+    if (unlikely(parser->file->stream.open) &&
+        (code = mark_record(parser)) < 0)
+      break;
     take(parser, &token);
     if (likely(is_contiguous(&token))) {
       if (likely(parser->file->start_of_line)) {
+        // chunk ends at the first entry at or past the limit
+        if (unlikely(parser->file->chunk.limit) &&
+            token.data >= parser->file->chunk.limit) {
+          parser->file->chunk.end = token.data;
+          return 0;
+        }
         // control entry
         if (unlikely(token.data[0] == '$')) {
           if (token.length == 4 && memcmp(token.data, "$TTL", 4) == 0)
@@ -396,9 +474,14 @@ static inline int32_t parse(parser_t *parser)
       }
 
       code = parse_rr(parser, &token);
+      // accept callbacks may return positive numbers too
+      if (unlikely(code > 0) && parser->rr)
+        break;
     } else if (is_end_of_file(&token)) {
       if (parser->file->end_of_file == NO_MORE_DATA) {
-        if (!parser->file->includer)
+        // included files parsed on other threads are the first file of
+        // that parser, the includer belongs to the parser that deferred it
+        if (parser->file == &parser->first)
           break;
         file_t *file = parser->file;
         parser->file = parser->file->includer;
@@ -416,4 +499,13 @@ static inline int32_t parse(parser_t *parser)
   return code;
 }
 
+static inline int32_t parse(parser_t *parser)
+{
+  int32_t code = parse_records(parser);
+  if (code != NEED_MORE_INPUT)
+    return code;
+  rewind_record(parser);
+  return 0;
+}
+
 #endif // FORMAT_H
@@ -0,0 +1,171 @@
+/*
+ * indexer.h -- write field and delimiter indexes for classified blocks
+ *
+ * Copyright (c) 2022, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INDEXER_H
+#define INDEXER_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+static really_inline void write_indexes(parser_t *parser, const block_t *block, uint64_t clear)
+{
+  uint64_t fields = (block->contiguous & ~block->follows_contiguous) |
+                    (block->quoted & block->in_quoted) |
+                    (block->special);
+
+  // delimiters are only important for contigouos and quoted character strings
+  // (all other tokens automatically have a length 1). write out both in
+  // separate vectors and base logic solely on field vector, order is
+  // automatically correct
+  uint64_t delimiters = (~block->contiguous & block->follows_contiguous) |
+                        (block->quoted & ~block->in_quoted);
+
+  fields &= ~clear;
+  delimiters &= ~clear;
+
+  const char *base = parser->file->buffer.data + parser->file->buffer.index;
+  uint64_t field_count = count_ones(fields);
+  uint64_t delimiter_count = count_ones(delimiters);
+  // bulk of the data are contiguous and quoted character strings. field and
+  // delimiter counts are therefore (mostly) equal. select the greater number
+  // and write out indexes in a single loop leveraging superscalar properties
+  // of modern CPUs
+  uint64_t count = field_count;
+  if (delimiter_count > field_count)
+    count = delimiter_count;
+
+  // take slow path if (escaped) newlines appear in contiguous or quoted
+  // character strings. edge case, but must be supported and handled in the
+  // scanner for ease of use and to accommodate for parallel processing in the
+  // parser. escaped newlines may have been present in the last block
+  uint64_t newlines = block->newline & (block->contiguous | block->in_quoted);
+
+  // non-delimiting tokens may contain (escaped) newlines. tracking newlines
+  // within tokens by taping them makes the lex operation more complex, resulting
+  // in a significantly larger binary and slower operation, and may introduce an
+  // infinite loop if the tape may not be sufficiently large enough. tokens
+  // containing newlines is very much an edge case, therefore the scanner
+  // implements an unlikely slow path that tracks the number of escaped newlines
+  // during tokenization and registers them with each consecutive newline token.
+  // this mode of operation nicely isolates location tracking in the scanner and
+  // accommodates parallel processing should that ever be desired
+  if (unlikely(*parser->file->newlines.tail || newlines)) {
+    for (uint64_t i=0; i < count; i++) {
+      const uint64_t field = fields & -fields;
+      const uint64_t delimiter = delimiters & -delimiters;
+      if (field & block->newline) {
+        *parser->file->newlines.tail += count_ones(newlines & (field - 1));
+        if (*parser->file->newlines.tail) {
+          const char *line = base + trailing_zeroes(field) + 1;
+          parser->file->fields.tail[i] =
+            classify[ (uint8_t)*line ] == BLANK ? blank_line_feed : line_feed;
+          parser->file->newlines.tail++;
+          // tape is reused after advance, clear stale count
+          *parser->file->newlines.tail = 0;
+        } else {
+          parser->file->fields.tail[i] = base + trailing_zeroes(field);
+        }
+        newlines &= -field;
+      } else {
+        parser->file->fields.tail[i] = base + trailing_zeroes(field);
+      }
+      parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiter);
+      fields &= ~field;
+      delimiters &= ~delimiter;
+    }
+
+    *parser->file->newlines.tail += count_ones(newlines);
+    parser->file->fields.tail += field_count;
+    parser->file->delimiters.tail += delimiter_count;
+  } else {
+    for (uint64_t i=0; i < 6; i++) {
+      parser->file->fields.tail[i] = base + trailing_zeroes(fields);
+      parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiters);
+      fields = clear_lowest_bit(fields);
+      delimiters = clear_lowest_bit(delimiters);
+    }
+
+    if (unlikely(count > 6)) {
+      for (uint64_t i=6; i < 12; i++) {
+        parser->file->fields.tail[i] = base + trailing_zeroes(fields);
+        parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiters);
+        fields = clear_lowest_bit(fields);
+        delimiters = clear_lowest_bit(delimiters);
+      }
+
+      if (unlikely(count > 12)) {
+        for (uint64_t i=12; i < count; i++) {
+          parser->file->fields.tail[i] = base + trailing_zeroes(fields);
+          parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiters);
+          fields = clear_lowest_bit(fields);
+          delimiters = clear_lowest_bit(delimiters);
+        }
+      }
+    }
+
+    parser->file->fields.tail += field_count;
+    parser->file->delimiters.tail += delimiter_count;
+  }
+}
+
+nonnull_all
+warn_unused_result
+static really_inline int32_t reindex(parser_t *parser)
+{
+  block_t block = { 0 };
+
+  assert(parser->file->buffer.index <= parser->file->buffer.length);
+  size_t left = parser->file->buffer.length - parser->file->buffer.index;
+  const char *data = parser->file->buffer.data + parser->file->buffer.index;
+  const char **tape = parser->file->fields.tail;
+  const char **tape_limit = parser->file->fields.tape + ZONE_TAPE_SIZE;
+
+  // a single block never requires more than ZONE_BLOCK_SIZE entries
+  if (left >= ZONE_BLOCK_SIZE) {
+    const char *data_limit = parser->file->buffer.data +
+                            (parser->file->buffer.length - ZONE_BLOCK_SIZE);
+    while (data <= data_limit && (size_t)(tape_limit - tape) >= ZONE_BLOCK_SIZE) {
+      simd_loadu_8x64(&block.input, (const uint8_t *)data);
+      scan(parser, &block);
+      write_indexes(parser, &block, 0);
+      parser->file->buffer.index += ZONE_BLOCK_SIZE;
+      data += ZONE_BLOCK_SIZE;
+      tape = parser->file->fields.tail;
+    }
+
+    assert(parser->file->buffer.index <= parser->file->buffer.length);
+    left = parser->file->buffer.length - parser->file->buffer.index;
+  }
+
+  // only scan partial blocks after reading all data and indexing all full
+  // blocks, the tape may fill up before the input is fully indexed
+  if (parser->file->end_of_file && left < ZONE_BLOCK_SIZE) {
+    if (!left) {
+      // input ends with the last full block, a contiguous token at the end
+      // of the block is terminated by the end of input
+      block.contiguous = 0;
+      parser->file->end_of_file = NO_MORE_DATA;
+    } else if ((size_t)(tape_limit - tape) >= left) {
+      // input is required to be padded, but may contain garbage
+      uint8_t buffer[ZONE_BLOCK_SIZE] = { 0 };
+      memcpy(buffer, data, left);
+      const uint64_t clear = ~((1llu << left) - 1);
+      simd_loadu_8x64(&block.input, buffer);
+      scan(parser, &block);
+      block.contiguous &= ~clear;
+      write_indexes(parser, &block, clear);
+      parser->file->end_of_file = NO_MORE_DATA;
+      parser->file->buffer.index += left;
+    }
+  }
+
+  return (uint64_t)((int64_t)(block.contiguous | block.in_quoted) >> 63) != 0;
+}
+
+#endif // INDEXER_H
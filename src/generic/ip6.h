@@ -88,7 +88,7 @@ inet_pton4(const char *src, uint8_t *dst)
  *  length if `src' is a valid [RFC1884 2.2] address, else 0.
  * notice:
  *  (1) does not touch `dst' unless it's returning !0.
- *  (2) :: in a full address is silently ignored.
+ *  (2) :: in a full address and a single trailing colon are rejected.
  * credit:
  *  inspired by Mark Andrews.
  * author:
@@ -154,6 +154,9 @@ inet_pton6(const char *src, uint8_t *dst)
     }
     break;
   }
+  /* A trailing colon must be part of "::". */
+  if (src > start && src[-1] == ':' && colonp != tp)
+    return (0);
   if (saw_xdigit) {
     if (tp + NS_INT16SZ > endp)
       return (0);
@@ -168,6 +171,9 @@ inet_pton6(const char *src, uint8_t *dst)
     const int n = (int)(tp - colonp);
     int i;
 
+    /* "::" must replace at least one group. */
+    if (tp == endp)
+      return (0);
     for (i = 1; i <= n; i++) {
       endp[- i] = colonp[n - i];
       colonp[n - i] = 0;
@@ -183,6 +189,13 @@ inet_pton6(const char *src, uint8_t *dst)
 nonnull_all
 static really_inline int32_t scan_ip6(const char *text, uint8_t *wire)
 {
+#if defined SCAN_IP6
+  // kernels may supply a vectorized parser that handles well-formed
+  // addresses and returns zero for anything it cannot handle
+  int32_t length;
+  if ((length = SCAN_IP6(text, wire)) > 0)
+    return length;
+#endif
   return inet_pton6(text, wire);
 }
 
@@ -194,7 +207,7 @@ static really_inline int32_t parse_ip6(
   rdata_t *rdata,
   const token_t *token)
 {
-  if ((size_t)inet_pton6(token->data, rdata->octets) != token->length)
+  if ((size_t)scan_ip6(token->data, rdata->octets) != token->length)
     SYNTAX_ERROR(parser, "Invalid %s in %s", NAME(item), NAME(type));
   rdata->octets += 16;
   return 0;
@@ -47,6 +47,10 @@ static really_inline int32_t scan_name(
 
   uint64_t count = 32, length = 0, base = 0, left = tlength;
   uint64_t carry = 0;
+#if defined UNESCAPE_BLOCK
+  uint64_t consumed, dots;
+  int32_t produced;
+#endif
   if (tlength < 32)
     count = tlength;
   uint64_t mask = (1llu << count) - 1u;
@@ -100,18 +104,35 @@ static really_inline int32_t scan_name(
     // check for escape sequences
     if (unlikely(block.backslashes & mask)) {
 escaped:
-      block.backslashes &= -block.backslashes;
-      mask = block.backslashes - 1;
-      block.dots &= mask;
-      count = count_ones(mask);
-      const uint32_t octet = unescape(text+count, wire+count);
-      if (!octet)
+#if defined UNESCAPE_BLOCK
+      // kernels may supply a vectorized decoder that handles all escape
+      // sequences in a window, fall back if the first is cut short
+      produced = UNESCAPE_BLOCK(text, left, wire, &consumed, &dots);
+      if (produced < 0)
         return -1;
-      text += count + octet;
-      wire += count + 1;
-      length += count + 1;
-      left -= count + octet;
-      count += 1; // for correct carry
+      if (produced > 0) {
+        block.dots = dots;
+        count = (uint64_t)produced;
+        text += consumed;
+        wire += count;
+        length += count;
+        left -= consumed;
+      } else
+#endif
+      {
+        block.backslashes &= -block.backslashes;
+        mask = block.backslashes - 1;
+        block.dots &= mask;
+        count = count_ones(mask);
+        const uint32_t octet = unescape(text+count, wire+count);
+        if (!octet)
+          return -1;
+        text += count + octet;
+        wire += count + 1;
+        length += count + 1;
+        left -= count + octet;
+        count += 1; // for correct carry
+      }
     } else {
       block.dots &= mask;
       text += count;
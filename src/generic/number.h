@@ -13,6 +13,15 @@ nonnull((1,3))
 static really_inline int32_t scan_int8(
   const char *data, size_t length, uint8_t *number)
 {
+#if defined SCAN_DIGITS
+  uint64_t sum;
+
+  if (!length || length > 3 || !SCAN_DIGITS(data, length, &sum))
+    return 0;
+
+  *number = (uint8_t)sum;
+  return sum <= 255u;
+#else
   uint32_t sum = (uint8_t)data[0] - '0';
 
   if (sum > 9 || !length || length > 3)
@@ -27,12 +36,22 @@ static really_inline int32_t scan_int8(
 
   *number = (uint8_t)sum;
   return sum <= 255u;
+#endif
 }
 
 nonnull((1,3))
 static really_inline int32_t scan_int16(
   const char *data, size_t length, uint16_t *number)
 {
+#if defined SCAN_DIGITS
+  uint64_t sum;
+
+  if (!length || length > 5 || !SCAN_DIGITS(data, length, &sum))
+    return 0;
+
+  *number = (uint16_t)sum;
+  return sum <= 65535u;
+#else
   uint32_t sum = (uint8_t)data[0] - '0';
 
   if (sum > 9 || !length || length > 5)
@@ -47,12 +66,22 @@ static really_inline int32_t scan_int16(
 
   *number = (uint16_t)sum;
   return sum <= 65535u;
+#endif
 }
 
 nonnull((1,3))
 static really_inline int32_t scan_int32(
   const char *data, size_t length, uint32_t *number)
 {
+#if defined SCAN_DIGITS
+  uint64_t sum;
+
+  if (!length || length > 10 || !SCAN_DIGITS(data, length, &sum))
+    return 0;
+
+  *number = (uint32_t)sum;
+  return sum <= 4294967295u;
+#else
   uint64_t sum = (uint8_t)data[0] - '0';
 
   if (sum > 9 || !length || length > 10)
@@ -67,6 +96,7 @@ static really_inline int32_t scan_int32(
 
   *number = (uint32_t)sum;
   return sum <= 4294967295u;
+#endif
 }
 
 nonnull((1,3))
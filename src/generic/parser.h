@@ -174,10 +174,18 @@ static const uint8_t classify[256] = {
 
 
 
-// special constant to mark line feeds with additional line count. i.e. CRLF
+// special constants to mark line feeds with additional line count. i.e. CRLF
 // within text. line feeds have no special meaning other than terminating the
-// record and require no further processing
+// record and require no further processing. start of line is derived from the
+// character that follows a line feed, blank_line_feed marks line feeds that
+// are followed by a blank
 static const char line_feed[ZONE_BLOCK_SIZE] = { '\n', '\0' };
+static const char blank_line_feed[ZONE_BLOCK_SIZE] = { '\n', ' ' };
+
+static really_inline bool has_line_count(const char *data)
+{
+  return data == line_feed || data == blank_line_feed;
+}
 
 // special constant used as data on errors
 static const char end_of_file[ZONE_BLOCK_SIZE] = { '\0' };
@@ -186,14 +194,41 @@ static const char end_of_file[ZONE_BLOCK_SIZE] = { '\0' };
 #define NO_MORE_DATA (2)
 #define MISSING_QUOTE (3)
 
+// input pushed by the application is exhausted. internal, the parser is
+// rewound to the start of the record and returns to have more input fed
+#define NEED_MORE_INPUT (-1)
+
+// record is returned by zone_next rather than passed to the accept callback.
+// internal, the parse loop returns to resume on the next invocation
+#define RECORD_RETURNED (1)
+
 extern int32_t zone_open_file(
   parser_t *, const char *path, size_t length, zone_file_t **);
 
 extern void zone_close_file(
   parser_t *, zone_file_t *);
 
+extern int32_t zone_resize_window(
+  zone_file_t *, size_t size);
+
+extern int32_t zone_read_file(
+  parser_t *, zone_file_t *, char *data, size_t size, size_t *count);
+
 extern void zone_vlog(parser_t *, uint32_t, const char *, va_list);
 
+// files scanned ahead of the parser, see zone_open_pipeline
+extern void zone_open_pipeline(
+  parser_t *, zone_file_t *, int32_t (*scan)(parser_t *));
+
+extern zone_file_t *zone_acquire_tapes(parser_t *);
+
+extern void zone_publish_tapes(parser_t *);
+
+extern const zone_file_t *zone_take_tapes(zone_file_t *);
+
+// files included from the top-level file, see zone_parse_includes
+extern int32_t zone_defer_include(parser_t *, zone_file_t *);
+
 nonnull((1))
 static really_inline void defer_error(token_t *token, int32_t code)
 {
@@ -262,6 +297,25 @@ static really_inline int32_t reindex(parser_t *parser);
 // cover longest key and ancillary characters) bytes.
 #define MAXIMUM_WINDOW_SIZE (65535u * 4u * 4u + 64u)
 
+// number of refills without large tokens after which the window shrinks
+#define SHRINK_WINDOW_REFILLS (8u)
+
+// tokens kept for the record to resume from (see keep_tapes) precede the
+// head of the tape and move with the data
+nonnull_all
+static really_inline void rebase_tapes(
+  file_t *file, const char *from, const char *to)
+{
+  if (from == to)
+    return;
+  for (const char **field = file->fields.tape; field < file->fields.head; field++)
+    if (!has_line_count(*field))
+      *field = to + (*field - from);
+  for (const char **delimiter = file->delimiters.tape;
+                    delimiter < file->delimiters.tail; delimiter++)
+    *delimiter = to + (*delimiter - from);
+}
+
 nonnull_all
 warn_unused_result
 static int32_t refill(parser_t *parser)
@@ -269,16 +323,26 @@ static int32_t refill(parser_t *parser)
   // refill if possible (i.e. not if string or if file is empty)
   if (parser->file->end_of_file)
     return 0;
+  // input handed over by the application is scanned in place until the
+  // unpadded tail is reached
+  if (parser->file->borrowed &&
+      parser->file->buffer.index < parser->file->buffer.length)
+    return 0;
 
-  assert(parser->file->handle);
+  assert(parser->file->handle || parser->file->reader || parser->file->stream.open);
 
   // move unread data to start of buffer
   char *data = parser->file->buffer.data + parser->file->buffer.index;
   // account for non-terminated character-strings
   if (*parser->file->fields.head[0] != '\0')
     data = (char *)parser->file->fields.head[0];
+  // account for record to resume from if input is pushed
+  size_t offset = 0;
+  if (parser->file->stream.restart && parser->file->stream.restart < data) {
+    offset = (size_t)(data - parser->file->stream.restart);
+    data = (char *)parser->file->stream.restart;
+  }
 
-  *parser->file->fields.head = parser->file->buffer.data;
   // account for unread data left in buffer
   size_t length = (size_t)
     ((parser->file->buffer.data + parser->file->buffer.length) - data);
@@ -286,38 +350,81 @@ static int32_t refill(parser_t *parser)
   assert((parser->file->buffer.data + parser->file->buffer.index) >= data);
   size_t index = (size_t)
     ((parser->file->buffer.data + parser->file->buffer.index) - data);
-  memmove(parser->file->buffer.data, data, length);
+  const char *from = data;
+  if (parser->file->ring.data) {
+    // window is mapped twice back-to-back, start of buffer is moved instead
+    if (data >= parser->file->ring.data + parser->file->ring.size)
+      data -= parser->file->ring.size;
+    parser->file->buffer.data = data;
+  } else if (parser->file->borrowed) {
+    // input is read-only, unread data is copied to a window below
+    parser->file->buffer.data = data;
+  } else {
+    memmove(parser->file->buffer.data, data, length);
+  }
+  if (parser->file->stream.fields)
+    rebase_tapes(parser->file, from, parser->file->buffer.data);
+  *parser->file->fields.head = parser->file->buffer.data + offset;
+  if (parser->file->stream.restart)
+    parser->file->stream.restart = parser->file->buffer.data;
   parser->file->buffer.length = length;
   parser->file->buffer.index = index;
-  parser->file->buffer.data[length] = '\0';
-
-  // allocate extra space if required
-  if (parser->file->buffer.length == parser->file->buffer.size) {
-    size_t size = parser->file->buffer.size;
-    if (parser->file->buffer.size >= MAXIMUM_WINDOW_SIZE)
+  if (!parser->file->borrowed)
+    parser->file->buffer.data[length] = '\0';
+
+  // grow window geometrically if a token does not fit so that large tokens
+  // are copied a constant number of times. shrink back once oversized
+  // tokens no longer occur, not after each one to avoid resizing for every
+  // record in zones where large records are common
+  size_t size = parser->file->buffer.size, limit = size;
+  const size_t minimum = parser->file->buffer.minimum;
+  if (parser->file->borrowed) {
+    // partial token may not fit the smallest window
+    limit = size = minimum;
+    while (size <= length && size < MAXIMUM_WINDOW_SIZE)
+      limit = size = size < MAXIMUM_WINDOW_SIZE / 2 ? size * 2 : MAXIMUM_WINDOW_SIZE;
+    if (size <= length)
       SYNTAX_ERROR(parser, "Impossibly large input, exceeds %zu bytes", size);
-    size += ZONE_WINDOW_SIZE;
-    if (!(data = realloc(parser->file->buffer.data, size + 1 + ZONE_BLOCK_SIZE)))
+  } else if (length == size) {
+    if (size >= MAXIMUM_WINDOW_SIZE)
+      SYNTAX_ERROR(parser, "Impossibly large input, exceeds %zu bytes", size);
+    limit = size = size < MAXIMUM_WINDOW_SIZE / 2 ? size * 2 : MAXIMUM_WINDOW_SIZE;
+  } else if (size > minimum) {
+    // index is the length of the partial token, if any
+    if (index > minimum / 2)
+      parser->file->buffer.oversized = 0;
+    else if (++parser->file->buffer.oversized < SHRINK_WINDOW_REFILLS)
+      limit = size;
+    else if (length <= minimum / 2)
+      limit = size = minimum;
+    else // do not read more data until unread data fits
+      limit = length;
+  }
+
+  if (size != parser->file->buffer.size || parser->file->borrowed) {
+    from = parser->file->buffer.data;
+    if (zone_resize_window(parser->file, size) < 0)
       OUT_OF_MEMORY(parser, "Not enough memory to allocate buffer of %zu", size);
-    parser->file->buffer.size = size;
-    parser->file->buffer.data = data;
+    if (parser->file->stream.fields)
+      rebase_tapes(parser->file, from, parser->file->buffer.data);
     // update reference to partial token
-    parser->file->fields.head[0] = data;
+    parser->file->fields.head[0] = parser->file->buffer.data + offset;
+    if (parser->file->stream.restart)
+      parser->file->stream.restart = parser->file->buffer.data;
   }
 
-  size_t count = fread(
-    parser->file->buffer.data + parser->file->buffer.length,
-    sizeof(parser->file->buffer.data[0]),
-    parser->file->buffer.size - parser->file->buffer.length,
-    parser->file->handle);
-
-  if (!count && ferror(parser->file->handle))
+  size_t count = 0;
+  if (limit > length && zone_read_file(
+        parser,
+        parser->file,
+        parser->file->buffer.data + parser->file->buffer.length,
+        limit - parser->file->buffer.length,
+        &count) < 0)
     READ_ERROR(parser, "Cannot refill buffer");
 
   // always null-terminate for terminating token
   parser->file->buffer.length += (size_t)count;
   parser->file->buffer.data[parser->file->buffer.length] = '\0';
-  parser->file->end_of_file = feof(parser->file->handle) != 0;
 
   /* After the file, there is padding, that is used by vector instructions,
    * initialise those bytes. */
@@ -326,33 +433,82 @@ static int32_t refill(parser_t *parser)
   return 0;
 }
 
-// do not invoke directly
+// reset tapes, the non-terminated token and embedded line count of the last
+// tape are carried over. last is file itself unless the file is scanned ahead
 nonnull_all
-warn_unused_result
-static really_inline int32_t advance(parser_t *parser)
+static really_inline void reset_tapes(file_t *file, const file_t *last)
 {
-  int32_t code;
-
   // save embedded line count (quoted or escaped newlines)
-  parser->file->newlines.tape[0] = parser->file->newlines.tail[0];
-  parser->file->newlines.head = parser->file->newlines.tape;
-  parser->file->newlines.tail = parser->file->newlines.tape;
+  file->newlines.tape[0] = last->newlines.tail[0];
+  file->newlines.head = file->newlines.tape;
+  file->newlines.tail = file->newlines.tape;
   // restore non-terminated token (partial quoted or contiguous)
-  parser->file->fields.tape[0] = parser->file->fields.tail[1];
-  parser->file->fields.head = parser->file->fields.tape;
-  parser->file->fields.tail =
-    parser->file->fields.tape + (*parser->file->fields.tape[0] != '\0');
+  file->fields.tape[0] = last->fields.tail[1];
+  file->fields.head = file->fields.tape;
+  file->fields.tail = file->fields.tape + (*file->fields.tape[0] != '\0');
   // reset delimiters
-  parser->file->delimiters.head = parser->file->delimiters.tape;
-  parser->file->delimiters.tail = parser->file->delimiters.tape;
+  file->delimiters.head = file->delimiters.tape;
+  file->delimiters.tail = file->delimiters.tape;
+}
 
-  // delayed syntax error
-  if (parser->file->end_of_file == MISSING_QUOTE)
-    SYNTAX_ERROR(parser, "Missing closing quote");
-  if ((code = refill(parser)) < 0)
-    return code;
+// reset tapes, but keep the tokens of the record to resume from if input is
+// pushed by the application so that the record need not be scanned again if
+// the parser is rewound. returns false, and keeps nothing, if the record
+// takes up too much of the tape
+nonnull_all
+static really_inline bool keep_tapes(file_t *file)
+{
+  const char *partial = file->fields.tail[1];
+  const size_t fields = (size_t)(file->fields.tail - file->stream.fields);
+  const size_t delimiters =
+    (size_t)(file->delimiters.tail - file->stream.delimiters);
+  const size_t newlines = (size_t)(file->newlines.tail - file->stream.newlines);
+
+  if (fields > ZONE_TAPE_SIZE / 2) {
+    file->stream.fields = NULL;
+    return false;
+  }
+
+  file->fields.head = file->fields.tape + (file->fields.head - file->stream.fields);
+  memmove(file->fields.tape, file->stream.fields, fields * sizeof(*file->fields.tape));
+  // restore non-terminated token (partial quoted or contiguous)
+  file->fields.tape[fields] = partial;
+  file->fields.tail = file->fields.tape + fields + (*partial != '\0');
+  file->delimiters.head =
+    file->delimiters.tape + (file->delimiters.head - file->stream.delimiters);
+  memmove(file->delimiters.tape, file->stream.delimiters,
+          delimiters * sizeof(*file->delimiters.tape));
+  file->delimiters.tail = file->delimiters.tape + delimiters;
+  // embedded line count (quoted or escaped newlines) is kept too
+  file->newlines.head =
+    file->newlines.tape + (file->newlines.head - file->stream.newlines);
+  memmove(file->newlines.tape, file->stream.newlines,
+          (newlines + 1) * sizeof(*file->newlines.tape));
+  file->newlines.tail = file->newlines.tape + newlines;
+  file->stream.fields = file->fields.tape;
+  file->stream.delimiters = file->delimiters.tape;
+  file->stream.newlines = file->newlines.tape;
+  return true;
+}
 
-  if (reindex(parser)) {
+// index input from where scanning left off and terminate tapes. returns true
+// if the first field is preceded by blanks, i.e. not at the start of a line
+nonnull_all
+static really_inline bool fill_tapes(parser_t *parser)
+{
+  // scanning resumes at index, which is not the start of the buffer if the
+  // tape filled up before the buffer was fully indexed
+  const char *start = parser->file->buffer.data + parser->file->buffer.index;
+
+  // partial blocks are not scanned until more input is pushed or the input
+  // is finished, a non-terminated token must remain non-terminated then. a
+  // quoted token carried over is never terminated if input ends with the
+  // last full block, the missing quote is reported
+  if (reindex(parser) || (
+        parser->file->buffer.data + parser->file->buffer.index == start &&
+        parser->file->fields.tail != parser->file->fields.head &&
+        (parser->file->end_of_file != NO_MORE_DATA ||
+         *parser->file->fields.tail[-1] == '"'))) {
     // save non-terminated token
     parser->file->fields.tail[0] = parser->file->fields.tail[-1];
     parser->file->fields.tail--;
@@ -366,13 +522,108 @@ static really_inline int32_t advance(parser_t *parser)
 
   // FIXME: if tail is still equal to tape, refill immediately?!
 
-  // terminate (end of buffer is null-terminated)
-  parser->file->fields.tail[0] =
-    parser->file->buffer.data + parser->file->buffer.length;
-  parser->file->delimiters.tail[0] =
-    parser->file->buffer.data + parser->file->buffer.length;
-  // start-of-line must be false if start of tape is not start of buffer
-  if (*parser->file->fields.head != parser->file->buffer.data)
+  // terminate (end of buffer is null-terminated, input handed over by the
+  // application is not until the tail is copied to a window)
+  const char *limit = parser->file->buffer.data + parser->file->buffer.length;
+  const char *end = limit;
+  if (parser->file->borrowed && !parser->file->end_of_file)
+    end = end_of_file;
+  parser->file->fields.tail[0] = end;
+  parser->file->delimiters.tail[0] = end;
+  // start-of-line must be false if start of tape is not where scanning
+  // resumed, i.e. the first field is preceded by blanks. the first field
+  // may be non-terminated and a partial block may be left to be scanned
+  // once more input is pushed
+  const char *first = *parser->file->fields.head;
+  if (first == end && *parser->file->fields.tail[1] != '\0')
+    first = parser->file->fields.tail[1];
+  else if (first == end)
+    first = parser->file->buffer.data + parser->file->buffer.index;
+  return first > start;
+}
+
+// scan mapped file on a separate thread ahead of the parser. the scanner
+// fills the tapes of one slot at a time, scanner state and input are carried
+// over from the last slot, see zone_open_pipeline
+nonnull_all
+static int32_t scan_ahead(parser_t *scanner)
+{
+  file_t *file;
+
+  while ((file = zone_acquire_tapes(scanner))) {
+    const file_t *last = scanner->file;
+    file->state = last->state;
+    file->buffer = last->buffer;
+    file->borrowed = last->borrowed;
+    file->end_of_file = last->end_of_file;
+    reset_tapes(file, last);
+    scanner->file = file;
+    file->start_of_line = !fill_tapes(scanner);
+    zone_publish_tapes(scanner);
+    if (file->end_of_file != READ_ALL_DATA)
+      break;
+  }
+
+  return 0;
+}
+
+// tapes of files scanned ahead are taken from the scanner
+nonnull_all
+warn_unused_result
+static int32_t take_tapes(parser_t *parser)
+{
+  const file_t *tapes;
+
+  // delayed syntax error
+  if (parser->file->end_of_file == MISSING_QUOTE)
+    SYNTAX_ERROR(parser, "Missing closing quote");
+  if (!(tapes = zone_take_tapes(parser->file)))
+    READ_ERROR(parser, "Cannot scan ahead");
+
+  parser->file->fields.head = tapes->fields.head;
+  parser->file->fields.tail = tapes->fields.tail;
+  parser->file->delimiters.head = tapes->delimiters.head;
+  parser->file->delimiters.tail = tapes->delimiters.tail;
+  parser->file->newlines.head = tapes->newlines.head;
+  parser->file->newlines.tail = tapes->newlines.tail;
+  parser->file->end_of_file = tapes->end_of_file;
+  if (!tapes->start_of_line)
+    parser->file->start_of_line = false;
+  return 0;
+}
+
+// do not invoke directly
+nonnull_all
+warn_unused_result
+static really_inline int32_t advance(parser_t *parser)
+{
+  int32_t code;
+
+  // mapped files are scanned on a separate thread if requested, the scanner
+  // starts where the parser is, i.e. at the start of the file
+  if (unlikely(parser->options.pipeline) && !parser->file->pipeline &&
+      parser->file->mapped && !parser->file->buffer.index)
+    zone_open_pipeline(parser, parser->file, scan_ahead);
+  if (unlikely(parser->file->pipeline))
+    return take_tapes(parser);
+
+  // input pushed by the application is exhausted, return before the tape
+  // is reset so that the parser can be rewound
+  if (unlikely(parser->file->stream.open) &&
+      !parser->file->stream.length && !parser->file->stream.finished &&
+      parser->file->buffer.length - parser->file->buffer.index < ZONE_BLOCK_SIZE)
+    return NEED_MORE_INPUT;
+
+  if (likely(!parser->file->stream.fields) || !keep_tapes(parser->file))
+    reset_tapes(parser->file, parser->file);
+
+  // delayed syntax error
+  if (parser->file->end_of_file == MISSING_QUOTE)
+    SYNTAX_ERROR(parser, "Missing closing quote");
+  if ((code = refill(parser)) < 0)
+    return code;
+
+  if (fill_tapes(parser))
     parser->file->start_of_line = false;
   return 0;
 }
@@ -449,7 +700,7 @@ static never_inline void maybe_take(parser_t *parser, token_t *token)
       parser->file->delimiters.head++;
       return;
     } else if (token->code == LINE_FEED) {
-      if (unlikely(token->data == line_feed))
+      if (unlikely(has_line_count(token->data)))
         parser->file->span += *parser->file->newlines.head++;
       parser->file->span++;
       parser->file->fields.head++;
@@ -506,7 +757,7 @@ static really_inline void take(parser_t *parser, token_t *token)
       parser->file->delimiters.head++;
       return;
     } else if (token->code == LINE_FEED) {
-      if (unlikely(token->data == line_feed))
+      if (unlikely(has_line_count(token->data)))
         parser->file->span += *parser->file->newlines.head++;
       parser->file->span++;
       parser->file->fields.head++;
@@ -619,7 +870,7 @@ static never_inline int32_t maybe_take_contiguous(
       parser->file->grouped = false;
       parser->file->fields.head++;
     } else if (token->code == LINE_FEED) {
-      if (token->data == line_feed)
+      if (has_line_count(token->data))
         parser->file->span += *parser->file->newlines.head++;
       parser->file->span++;
       if (!parser->file->grouped)
@@ -720,7 +971,7 @@ static never_inline int32_t maybe_take_quoted(
       parser->file->grouped = false;
       parser->file->fields.head++;
     } else if (token->code == LINE_FEED) {
-      if (token->data == line_feed)
+      if (has_line_count(token->data))
         parser->file->span += *parser->file->newlines.head++;
       parser->file->span++;
       if (!parser->file->grouped)
@@ -825,7 +1076,7 @@ static never_inline int32_t maybe_take_contiguous_or_quoted(
       parser->file->grouped = false;
       parser->file->fields.head++;
     } else if (token->code == LINE_FEED) {
-      if (token->data == line_feed)
+      if (has_line_count(token->data))
         parser->file->span += *parser->file->newlines.head++;
       parser->file->span++;
       if (!parser->file->grouped)
@@ -918,7 +1169,7 @@ static never_inline int32_t maybe_take_delimiter(
 
   for (;;) {
     if (likely(token->code == LINE_FEED)) {
-      if (unlikely(token->data == line_feed))
+      if (unlikely(has_line_count(token->data)))
         parser->file->span += *parser->file->newlines.head++;
       if (unlikely(parser->file->grouped)) {
         parser->file->span++;
@@ -968,7 +1219,7 @@ static really_inline int32_t take_delimiter(
   token->data = *parser->file->fields.head;
   token->code = (int32_t)classify[ (uint8_t)**parser->file->fields.head ];
   if (likely(token->code == LINE_FEED)) {
-    if (unlikely(parser->file->grouped || token->data == line_feed))
+    if (unlikely(parser->file->grouped || has_line_count(token->data)))
       return maybe_take_delimiter(parser, type, token);
     token->length = 1;
     parser->file->span++;
@@ -40,7 +40,7 @@ static really_inline uint64_t find_escaped(
 // includes a semicolon (or newline for that matter) and/or a comment region
 // includes one (or more) quote characters. also, for comments, only newlines
 // directly following a non-escaped, non-quoted semicolon must be included
-static really_inline void find_delimiters(
+static really_inline void resolve_delimiters(
   uint64_t quotes,
   uint64_t semicolons,
   uint64_t newlines,
@@ -52,8 +52,6 @@ static really_inline void find_delimiters(
   uint64_t delimiters, starts = quotes | semicolons;
   uint64_t end;
 
-  assert(!(quotes & semicolons));
-
   // carry over state from previous block
   end = (newlines & in_comment) | (quotes & in_quoted);
   end &= -end;
@@ -79,6 +77,52 @@ static really_inline void find_delimiters(
   *comment = delimiters & ~quotes;
 }
 
+// (*) quote characters in comments are rare though. assume every quote
+//     outside a comment carried over from the previous block delimits a
+//     quoted region, in which case comments can be identified without
+//     branching. the first non-quoted semicolon on each line starts a
+//     comment, which ends at the next newline. the assumption holds if no
+//     quote is part of a comment, the exact (iterative) algorithm is used
+//     otherwise
+static really_inline void find_delimiters(
+  uint64_t quotes,
+  uint64_t semicolons,
+  uint64_t newlines,
+  uint64_t in_quoted,
+  uint64_t in_comment,
+  uint64_t *quoted_,
+  uint64_t *comment)
+{
+  assert(!(quotes & semicolons));
+
+  // comment carried over from previous block ends at the first newline
+  const uint64_t newline = newlines & -newlines;
+  const uint64_t head = in_comment & (newline - 1);
+  const uint64_t quoted = quotes & ~head;
+  const uint64_t semicolon =
+    semicolons & ~(head | (in_quoted ^ prefix_xor(quoted)));
+
+  // lines start a new segment. add segments to the mask of non-delimiting
+  // characters, carries ripple up to the first semicolon in each segment
+  // (the segment starts a comment), or up to the newline if there is none
+  const uint64_t lines = (newlines << 1) | (~in_comment & 1u);
+  const uint64_t starts =
+    (~(semicolon | newlines) + lines) & semicolon;
+  // carries ripple from each start up to the newline that ends the comment
+  const uint64_t ends =
+    ((~newlines + starts) & newlines) | (in_comment & newline);
+
+  // fix up if a quote is part of a comment
+  if (unlikely(quoted & (in_comment ^ prefix_xor(starts | ends)))) {
+    resolve_delimiters(
+      quotes, semicolons, newlines, in_quoted, in_comment, quoted_, comment);
+    return;
+  }
+
+  *quoted_ = quoted;
+  *comment = starts | ends;
+}
+
 static inline uint64_t follows(const uint64_t match, uint64_t *overflow)
 {
   const uint64_t result = match << 1 | (*overflow);
@@ -188,151 +232,4 @@ static really_inline void scan(parser_t *parser, block_t *block)
     follows(block->contiguous, &parser->file->state.follows_contiguous);
 }
 
-static really_inline void write_indexes(parser_t *parser, const block_t *block, uint64_t clear)
-{
-  uint64_t fields = (block->contiguous & ~block->follows_contiguous) |
-                    (block->quoted & block->in_quoted) |
-                    (block->special);
-
-  // delimiters are only important for contigouos and quoted character strings
-  // (all other tokens automatically have a length 1). write out both in
-  // separate vectors and base logic solely on field vector, order is
-  // automatically correct
-  uint64_t delimiters = (~block->contiguous & block->follows_contiguous) |
-                        (block->quoted & ~block->in_quoted);
-
-  fields &= ~clear;
-  delimiters &= ~clear;
-
-  const char *base = parser->file->buffer.data + parser->file->buffer.index;
-  uint64_t field_count = count_ones(fields);
-  uint64_t delimiter_count = count_ones(delimiters);
-  // bulk of the data are contiguous and quoted character strings. field and
-  // delimiter counts are therefore (mostly) equal. select the greater number
-  // and write out indexes in a single loop leveraging superscalar properties
-  // of modern CPUs
-  uint64_t count = field_count;
-  if (delimiter_count > field_count)
-    count = delimiter_count;
-
-  // take slow path if (escaped) newlines appear in contiguous or quoted
-  // character strings. edge case, but must be supported and handled in the
-  // scanner for ease of use and to accommodate for parallel processing in the
-  // parser. escaped newlines may have been present in the last block
-  uint64_t newlines = block->newline & (block->contiguous | block->in_quoted);
-
-  // non-delimiting tokens may contain (escaped) newlines. tracking newlines
-  // within tokens by taping them makes the lex operation more complex, resulting
-  // in a significantly larger binary and slower operation, and may introduce an
-  // infinite loop if the tape may not be sufficiently large enough. tokens
-  // containing newlines is very much an edge case, therefore the scanner
-  // implements an unlikely slow path that tracks the number of escaped newlines
-  // during tokenization and registers them with each consecutive newline token.
-  // this mode of operation nicely isolates location tracking in the scanner and
-  // accommodates parallel processing should that ever be desired
-  if (unlikely(*parser->file->newlines.tail || newlines)) {
-    for (uint64_t i=0; i < count; i++) {
-      const uint64_t field = fields & -fields;
-      const uint64_t delimiter = delimiters & -delimiters;
-      if (field & block->newline) {
-        *parser->file->newlines.tail += count_ones(newlines & (field - 1));
-        if (*parser->file->newlines.tail) {
-          parser->file->fields.tail[i] = line_feed;
-          parser->file->newlines.tail++;
-        } else {
-          parser->file->fields.tail[i] = base + trailing_zeroes(field);
-        }
-        newlines &= -field;
-      } else {
-        parser->file->fields.tail[i] = base + trailing_zeroes(field);
-      }
-      parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiter);
-      fields &= ~field;
-      delimiters &= ~delimiter;
-    }
-
-    *parser->file->newlines.tail += count_ones(newlines);
-    parser->file->fields.tail += field_count;
-    parser->file->delimiters.tail += delimiter_count;
-  } else {
-    for (uint64_t i=0; i < 6; i++) {
-      parser->file->fields.tail[i] = base + trailing_zeroes(fields);
-      parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiters);
-      fields = clear_lowest_bit(fields);
-      delimiters = clear_lowest_bit(delimiters);
-    }
-
-    if (unlikely(count > 6)) {
-      for (uint64_t i=6; i < 12; i++) {
-        parser->file->fields.tail[i] = base + trailing_zeroes(fields);
-        parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiters);
-        fields = clear_lowest_bit(fields);
-        delimiters = clear_lowest_bit(delimiters);
-      }
-
-      if (unlikely(count > 12)) {
-        for (uint64_t i=12; i < count; i++) {
-          parser->file->fields.tail[i] = base + trailing_zeroes(fields);
-          parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiters);
-          fields = clear_lowest_bit(fields);
-          delimiters = clear_lowest_bit(delimiters);
-        }
-      }
-    }
-
-    parser->file->fields.tail += field_count;
-    parser->file->delimiters.tail += delimiter_count;
-  }
-}
-
-nonnull_all
-warn_unused_result
-static really_inline int32_t reindex(parser_t *parser)
-{
-  block_t block = { 0 };
-
-  assert(parser->file->buffer.index <= parser->file->buffer.length);
-  size_t left = parser->file->buffer.length - parser->file->buffer.index;
-  const char *data = parser->file->buffer.data + parser->file->buffer.index;
-  const char **tape = parser->file->fields.tail;
-  const char **tape_limit = parser->file->fields.tape + ZONE_TAPE_SIZE;
-
-  if (left >= ZONE_BLOCK_SIZE) {
-    const char *data_limit = parser->file->buffer.data +
-                            (parser->file->buffer.length - ZONE_BLOCK_SIZE);
-    while (data <= data_limit && ((uintptr_t)tape_limit - (uintptr_t)tape) >= ZONE_BLOCK_SIZE) {
-      simd_loadu_8x64(&block.input, (const uint8_t *)data);
-      scan(parser, &block);
-      write_indexes(parser, &block, 0);
-      parser->file->buffer.index += ZONE_BLOCK_SIZE;
-      data += ZONE_BLOCK_SIZE;
-      tape = parser->file->fields.tail;
-    }
-
-    assert(parser->file->buffer.index <= parser->file->buffer.length);
-    left = parser->file->buffer.length - parser->file->buffer.index;
-  }
-
-  // only scan partial blocks after reading all data
-  if (parser->file->end_of_file) {
-    assert(left < ZONE_BLOCK_SIZE);
-    if (!left) {
-      parser->file->end_of_file = NO_MORE_DATA;
-    } else if (((uintptr_t)tape_limit - (uintptr_t)tape) >= left) {
-      // input is required to be padded, but may contain garbage
-      uint8_t buffer[ZONE_BLOCK_SIZE] = { 0 };
-      memcpy(buffer, data, left);
-      const uint64_t clear = ~((1llu << left) - 1);
-      simd_loadu_8x64(&block.input, buffer);
-      scan(parser, &block);
-      block.contiguous &= ~clear;
-      write_indexes(parser, &block, clear);
-      parser->file->end_of_file = NO_MORE_DATA;
-      parser->file->buffer.index += left;
-    }
-  }
-
-  return (uint64_t)((int64_t)(block.contiguous | block.in_quoted) >> 63) != 0;
-}
-
 #endif // SCANNER_H
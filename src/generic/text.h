@@ -82,6 +82,23 @@ static really_inline int32_t scan_string(
     // check for escape sequences
     if (unlikely(block.backslashes & mask)) {
 escaped:
+#if defined UNESCAPE_BLOCK
+      {
+        // kernels may supply a vectorized decoder that handles all escape
+        // sequences in a window, fall back if the first is cut short
+        uint64_t consumed, dots;
+        const int32_t produced =
+          UNESCAPE_BLOCK(text, length, wire, &consumed, &dots);
+        if (produced < 0)
+          return -1;
+        if (produced > 0) {
+          text += consumed;
+          wire += (uint64_t)produced;
+          length -= consumed;
+          continue;
+        }
+      }
+#endif
       block.backslashes &= -block.backslashes;
       mask = block.backslashes - 1;
       count = count_ones(mask);
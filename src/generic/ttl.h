@@ -37,6 +37,10 @@ static really_inline int32_t scan_ttl(
     return 1;
   if (!allow_units)
     return 0;
+#if defined SCAN_TTL
+  if (SCAN_TTL(data, length, ttl))
+    return 1;
+#endif
 
   uint64_t sum = 0, number = (uint8_t)data[0] - '0';
   // ttls must start with a number. e.g. 1h not h1
@@ -60,7 +64,7 @@ static really_inline int32_t scan_ttl(
       } else if (unit == last_unit) {
         return 0;
       // greater units must precede smaller units. e.g. 1m1s, not 1s1m
-      } else if (unit < last_unit) {
+      } else if (last_unit && unit > last_unit) {
         return 0;
       } else {
         if (UINT32_MAX / unit < number)
@@ -213,6 +213,19 @@ static really_inline int32_t accept_rr(
 
   assert(length <= UINT16_MAX);
   assert(parser->owner->length <= UINT8_MAX);
+  // record is returned by zone_next, parsing resumes on the next invocation
+  if (unlikely(parser->rr != NULL)) {
+    parser->rr->owner.length = (uint8_t)parser->owner->length;
+    parser->rr->owner.octets = parser->owner->octets;
+    parser->rr->type = parser->file->last_type;
+    parser->rr->rrclass = parser->file->last_class;
+    parser->rr->ttl = *parser->file->ttl;
+    parser->rr->rdlength = (uint16_t)length;
+    parser->rr->rdata = parser->rdata->octets;
+    adjust_line_count(parser->file);
+    return RECORD_RETURNED;
+  }
+
   int32_t code = parser->options.accept.callback(
     parser,
     &(zone_name_t){ (uint8_t)parser->owner->length, parser->owner->octets },
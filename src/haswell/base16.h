@@ -0,0 +1,60 @@
+/*
+ * base16.h -- Fast Base16 stream decoder (AVX2)
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef BASE16_AVX2_H
+#define BASE16_AVX2_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+// decode 32 characters at a time, see base16_dec_loop_sse for details
+static really_inline void base16_dec_loop_avx2(
+  const uint8_t **s, size_t *slen, uint8_t **o, size_t *olen)
+{
+  while (*slen >= 2) {
+    const __m256i input = _mm256_loadu_si256((const __m256i *)*s);
+    // digits map to 0-9, letters (either case) map to 0-5
+    const __m256i digits = _mm256_sub_epi8(input, _mm256_set1_epi8('0'));
+    const __m256i letters = _mm256_sub_epi8(
+      _mm256_or_si256(input, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i is_digit = _mm256_cmpeq_epi8(
+      _mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+    const __m256i is_letter = _mm256_cmpeq_epi8(
+      _mm256_min_epu8(letters, _mm256_set1_epi8(5)), letters);
+    const uint64_t invalid = (uint32_t)~_mm256_movemask_epi8(
+      _mm256_or_si256(is_digit, is_letter));
+
+    size_t length = *slen < 32 ? *slen : 32;
+    if (invalid && trailing_zeroes(invalid) < length)
+      length = trailing_zeroes(invalid);
+    length &= ~(size_t)1;
+    if (!length)
+      break;
+
+    const __m256i nibbles = _mm256_blendv_epi8(
+      _mm256_add_epi8(letters, _mm256_set1_epi8(10)), digits, is_digit);
+    // merge nibbles into octets, most significant nibble comes first
+    const __m256i octets =
+      _mm256_maddubs_epi16(nibbles, _mm256_set1_epi16(0x0110));
+    // pack octets within 128-bit lanes, then lanes together
+    const __m256i packed = _mm256_permute4x64_epi64(
+      _mm256_packus_epi16(octets, octets), 0x08);
+    _mm_storeu_si128((__m128i *)*o, _mm256_castsi256_si128(packed));
+
+    *s += length;
+    *slen -= length;
+    *o += length / 2;
+    *olen += length / 2;
+    if (length != 32)
+      break;
+  }
+}
+
+#define BASE16_DEC_LOOP base16_dec_loop_avx2
+
+#endif // BASE16_AVX2_H
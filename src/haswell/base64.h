@@ -0,0 +1,103 @@
+/*
+ * base64.h -- Fast Base64 stream decoder (AVX2)
+ *
+ * Copyright (c) 2015-2018, Wojciech Muła.
+ * Copyright (c) 2013-2022, Alfred Klomp.
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ */
+#ifndef BASE64_AVX2_H
+#define BASE64_AVX2_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+//////////////////////////
+/// Modified version of the AVX2 codec in https://github.com/aklomp/base64
+/// Source: Wojciech Muła, Daniel Lemire, Faster Base64 Encoding and Decoding Using AVX2 Instructions,
+///         ACM Transactions on the Web 12 (3), 2018
+///         https://arxiv.org/abs/1704.00605
+//////////////////////////
+
+static really_inline __m256i dec_reshuffle_avx2(const __m256i input)
+{
+  // in, bits, upper case are most significant bits, lower case are least
+  // significant bits:
+  // 00llllll 00kkkkLL 00jjKKKK 00JJJJJJ
+  const __m256i merge_ab_and_bc =
+    _mm256_maddubs_epi16(input, _mm256_set1_epi32(0x01400140));
+  // 0000kkkk LLllllll 0000JJJJ JJjjKKKK
+  const __m256i output =
+    _mm256_madd_epi16(merge_ab_and_bc, _mm256_set1_epi32(0x00011000));
+  // 00000000 JJJJJJjj KKKKkkkk LLllllll
+  // pack bytes together within 128-bit lanes, then lanes together
+  const __m256i packed = _mm256_shuffle_epi8(output, _mm256_setr_epi8(
+     2,  1,  0,  6,  5,  4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1,
+     2,  1,  0,  6,  5,  4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1));
+  return _mm256_permutevar8x32_epi32(
+    packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+}
+
+// decode 32 characters at a time straight into the output buffer, stop at
+// the first character that is not in the alphabet (including padding) and
+// leave the remainder to the generic loop. input and output buffers are
+// padded, reading or writing past the end is safe. partial blocks at the
+// end of a token are decoded too, sequences split over multiple tokens are
+// therefore decoded using vector instructions but for the (up to three)
+// characters completing a quantum
+static really_inline void dec_loop_avx2(
+  const uint8_t **s, size_t *slen, uint8_t **o, size_t *olen)
+{
+  const __m256i lut_lo = _mm256_setr_epi8(
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lut_hi = _mm256_setr_epi8(
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+
+  while (*slen >= 4) {
+    __m256i input = _mm256_loadu_si256((const __m256i *)*s);
+    const __m256i hi_nibbles =
+      _mm256_and_si256(_mm256_srli_epi32(input, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(input, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    // characters not in the alphabet have overlapping bits
+    const uint64_t invalid = (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+      _mm256_and_si256(lo, hi), _mm256_setzero_si256()));
+
+    size_t length = *slen < 32 ? *slen : 32;
+    if (invalid && trailing_zeroes(invalid) < length)
+      length = trailing_zeroes(invalid);
+    length &= ~(size_t)3;
+    if (!length)
+      break;
+
+    const __m256i eq_2f = _mm256_cmpeq_epi8(input, mask_2f);
+    const __m256i roll =
+      _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    input = dec_reshuffle_avx2(_mm256_add_epi8(input, roll));
+    _mm256_storeu_si256((__m256i *)*o, input);
+
+    *s += length;
+    *slen -= length;
+    *o += (length / 4) * 3;
+    *olen += (length / 4) * 3;
+    if (length != 32)
+      break;
+  }
+}
+
+#define BASE64_DEC_LOOP dec_loop_avx2
+
+#endif // BASE64_AVX2_H
@@ -13,6 +13,7 @@
 #include "haswell/bits.h"
 #include "generic/parser.h"
 #include "generic/scanner.h"
+#include "generic/indexer.h"
 
 diagnostic_push()
 clang_diagnostic_ignored(missing-prototypes)
@@ -0,0 +1,89 @@
+/*
+ * base64.h -- Fast Base64 stream decoder (AVX-512)
+ *
+ * Copyright (c) 2015-2018, Wojciech Muła.
+ * Copyright (c) 2013-2022, Alfred Klomp.
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ */
+#ifndef BASE64_AVX512_H
+#define BASE64_AVX512_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+//////////////////////////
+/// 512-bit version of the decoder in haswell/base64.h, requires AVX512BW.
+/// Source: Wojciech Muła, Daniel Lemire, Faster Base64 Encoding and Decoding Using AVX2 Instructions,
+///         ACM Transactions on the Web 12 (3), 2018
+///         https://arxiv.org/abs/1704.00605
+//////////////////////////
+
+static really_inline __m512i dec_reshuffle_avx512(const __m512i input)
+{
+  const __m512i merge_ab_and_bc =
+    _mm512_maddubs_epi16(input, _mm512_set1_epi32(0x01400140));
+  const __m512i output =
+    _mm512_madd_epi16(merge_ab_and_bc, _mm512_set1_epi32(0x00011000));
+  // pack bytes together within 128-bit lanes, then lanes together
+  const __m512i packed = _mm512_shuffle_epi8(output, _mm512_set_epi8(
+    -1, -1, -1, -1, 12, 13, 14,  8,  9, 10,  4,  5,  6,  0,  1,  2,
+    -1, -1, -1, -1, 12, 13, 14,  8,  9, 10,  4,  5,  6,  0,  1,  2,
+    -1, -1, -1, -1, 12, 13, 14,  8,  9, 10,  4,  5,  6,  0,  1,  2,
+    -1, -1, -1, -1, 12, 13, 14,  8,  9, 10,  4,  5,  6,  0,  1,  2));
+  return _mm512_permutexvar_epi32(_mm512_set_epi32(
+    15, 15, 15, 15, 14, 13, 12, 10, 9, 8, 6, 5, 4, 2, 1, 0), packed);
+}
+
+// decode 64 characters at a time, see dec_loop_avx2 for details
+static really_inline void dec_loop_avx512(
+  const uint8_t **s, size_t *slen, uint8_t **o, size_t *olen)
+{
+  const __m512i lut_lo = _mm512_broadcast_i32x4(_mm_setr_epi8(
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a));
+  const __m512i lut_hi = _mm512_broadcast_i32x4(_mm_setr_epi8(
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+  const __m512i lut_roll = _mm512_broadcast_i32x4(_mm_setr_epi8(
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+  const __m512i mask_2f = _mm512_set1_epi8(0x2f);
+
+  while (*slen >= 4) {
+    __m512i input = _mm512_loadu_si512((const void *)*s);
+    const __m512i hi_nibbles =
+      _mm512_and_si512(_mm512_srli_epi32(input, 4), mask_2f);
+    const __m512i lo_nibbles = _mm512_and_si512(input, mask_2f);
+    const __m512i hi = _mm512_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m512i lo = _mm512_shuffle_epi8(lut_lo, lo_nibbles);
+    // characters not in the alphabet have overlapping bits
+    const uint64_t invalid = _mm512_test_epi8_mask(lo, hi);
+
+    size_t length = *slen < 64 ? *slen : 64;
+    if (invalid && trailing_zeroes(invalid) < length)
+      length = trailing_zeroes(invalid);
+    length &= ~(size_t)3;
+    if (!length)
+      break;
+
+    const __m512i eq_2f =
+      _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(input, mask_2f));
+    const __m512i roll =
+      _mm512_shuffle_epi8(lut_roll, _mm512_add_epi8(eq_2f, hi_nibbles));
+    input = dec_reshuffle_avx512(_mm512_add_epi8(input, roll));
+    _mm512_storeu_si512((void *)*o, input);
+
+    *s += length;
+    *slen -= length;
+    *o += (length / 4) * 3;
+    *olen += (length / 4) * 3;
+    if (length != 64)
+      break;
+  }
+}
+
+#define BASE64_DEC_LOOP dec_loop_avx512
+
+#endif // BASE64_AVX512_H
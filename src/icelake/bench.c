@@ -0,0 +1,35 @@
+/*
+ * bench.c -- AVX-512 compilation target for benchmark function(s)
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include "zone.h"
+#include "attributes.h"
+#include "diagnostic.h"
+#include "icelake/simd.h"
+#include "icelake/bits.h"
+#include "generic/parser.h"
+#include "generic/scanner.h"
+#include "icelake/indexer.h"
+
+diagnostic_push()
+clang_diagnostic_ignored(missing-prototypes)
+
+int32_t zone_bench_icelake_lex(zone_parser_t *parser, size_t *tokens)
+{
+  token_t token;
+
+  (*tokens) = 0;
+  take(parser, &token);
+  while (token.code > 0) {
+    (*tokens)++;
+    take(parser, &token);
+  }
+
+  return token.code ? -1 : 0;
+}
+
+diagnostic_pop()
@@ -0,0 +1,166 @@
+/*
+ * indexer.h -- AVX-512 (VBMI2) specific index writer
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INDEXER_H
+#define INDEXER_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+static const uint8_t block_offsets[ZONE_BLOCK_SIZE] = {
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+  16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+  32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+  48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63
+};
+
+// vpcompressb packs the offsets of all set bits into the lower bytes of a
+// vector. offsets are then widened and added to the base address eight at a
+// time, which removes the data dependency on the trailing zero count of the
+// previous iteration. up to seven indexes beyond count may be written, tapes
+// must therefore have room for at least count rounded up to a multiple of 8
+nonnull_all
+static really_inline void compress_indexes(
+  const char **tape, const char *base, uint64_t bits, uint64_t count)
+{
+  const __m512i offsets = _mm512_loadu_si512(block_offsets);
+  const __m512i address = _mm512_set1_epi64((long long)(uintptr_t)base);
+  const __m512i indexes = _mm512_maskz_compress_epi8((__mmask64)bits, offsets);
+
+  // bulk of the blocks contain no more than eight fields
+  _mm512_storeu_si512(tape, _mm512_add_epi64(
+    address, _mm512_cvtepu8_epi64(_mm512_castsi512_si128(indexes))));
+
+  if (unlikely(count > 8)) {
+    uint8_t buffer[ZONE_BLOCK_SIZE];
+    _mm512_storeu_si512(buffer, indexes);
+    for (uint64_t i=8; i < count; i += 8) {
+      const __m128i octets = _mm_loadl_epi64((const __m128i *)&buffer[i]);
+      _mm512_storeu_si512(&tape[i], _mm512_add_epi64(
+        address, _mm512_cvtepu8_epi64(octets)));
+    }
+  }
+}
+
+static really_inline void write_indexes(parser_t *parser, const block_t *block, uint64_t clear)
+{
+  uint64_t fields = (block->contiguous & ~block->follows_contiguous) |
+                    (block->quoted & block->in_quoted) |
+                    (block->special);
+
+  // see generic/indexer.h for details
+  uint64_t delimiters = (~block->contiguous & block->follows_contiguous) |
+                        (block->quoted & ~block->in_quoted);
+
+  fields &= ~clear;
+  delimiters &= ~clear;
+
+  const char *base = parser->file->buffer.data + parser->file->buffer.index;
+  uint64_t field_count = count_ones(fields);
+  uint64_t delimiter_count = count_ones(delimiters);
+
+  uint64_t newlines = block->newline & (block->contiguous | block->in_quoted);
+
+  // take slow path if (escaped) newlines appear in contiguous or quoted
+  // character strings. see generic/indexer.h for details
+  if (unlikely(*parser->file->newlines.tail || newlines)) {
+    uint64_t count = field_count;
+    if (delimiter_count > field_count)
+      count = delimiter_count;
+
+    for (uint64_t i=0; i < count; i++) {
+      const uint64_t field = fields & -fields;
+      const uint64_t delimiter = delimiters & -delimiters;
+      if (field & block->newline) {
+        *parser->file->newlines.tail += count_ones(newlines & (field - 1));
+        if (*parser->file->newlines.tail) {
+          const char *line = base + trailing_zeroes(field) + 1;
+          parser->file->fields.tail[i] =
+            classify[ (uint8_t)*line ] == BLANK ? blank_line_feed : line_feed;
+          parser->file->newlines.tail++;
+          // tape is reused after advance, clear stale count
+          *parser->file->newlines.tail = 0;
+        } else {
+          parser->file->fields.tail[i] = base + trailing_zeroes(field);
+        }
+        newlines &= -field;
+      } else {
+        parser->file->fields.tail[i] = base + trailing_zeroes(field);
+      }
+      parser->file->delimiters.tail[i] = base + trailing_zeroes(delimiter);
+      fields &= ~field;
+      delimiters &= ~delimiter;
+    }
+
+    *parser->file->newlines.tail += count_ones(newlines);
+  } else {
+    compress_indexes(parser->file->fields.tail, base, fields, field_count);
+    compress_indexes(parser->file->delimiters.tail, base, delimiters, delimiter_count);
+  }
+
+  parser->file->fields.tail += field_count;
+  parser->file->delimiters.tail += delimiter_count;
+}
+
+nonnull_all
+warn_unused_result
+static really_inline int32_t reindex(parser_t *parser)
+{
+  block_t block = { 0 };
+
+  assert(parser->file->buffer.index <= parser->file->buffer.length);
+  size_t left = parser->file->buffer.length - parser->file->buffer.index;
+  const char *data = parser->file->buffer.data + parser->file->buffer.index;
+  const char **tape = parser->file->fields.tail;
+  const char **tape_limit = parser->file->fields.tape + ZONE_TAPE_SIZE;
+
+  // compress_indexes writes indexes in multiples of eight, a single block
+  // never requires more than ZONE_BLOCK_SIZE entries
+  if (left >= ZONE_BLOCK_SIZE) {
+    const char *data_limit = parser->file->buffer.data +
+                            (parser->file->buffer.length - ZONE_BLOCK_SIZE);
+    while (data <= data_limit && (size_t)(tape_limit - tape) >= ZONE_BLOCK_SIZE) {
+      simd_loadu_8x64(&block.input, (const uint8_t *)data);
+      scan(parser, &block);
+      write_indexes(parser, &block, 0);
+      parser->file->buffer.index += ZONE_BLOCK_SIZE;
+      data += ZONE_BLOCK_SIZE;
+      tape = parser->file->fields.tail;
+    }
+
+    assert(parser->file->buffer.index <= parser->file->buffer.length);
+    left = parser->file->buffer.length - parser->file->buffer.index;
+  }
+
+  // only scan partial blocks after reading all data and indexing all full
+  // blocks, the tape may fill up before the input is fully indexed
+  if (parser->file->end_of_file && left < ZONE_BLOCK_SIZE) {
+    if (!left) {
+      // input ends with the last full block, a contiguous token at the end
+      // of the block is terminated by the end of input
+      block.contiguous = 0;
+      parser->file->end_of_file = NO_MORE_DATA;
+    } else if ((size_t)(tape_limit - tape) >= ZONE_BLOCK_SIZE) {
+      // masked load, bytes beyond the end of the input are not accessed and
+      // read as zero, no need to copy the block to the stack first
+      const uint64_t clear = ~((1llu << left) - 1);
+      simd_maskz_loadu_8x64(&block.input, (const uint8_t *)data, ~clear);
+      scan(parser, &block);
+      block.contiguous &= ~clear;
+      write_indexes(parser, &block, clear);
+      parser->file->end_of_file = NO_MORE_DATA;
+      parser->file->buffer.index += left;
+    }
+  }
+
+  return (uint64_t)((int64_t)(block.contiguous | block.in_quoted) >> 63) != 0;
+}
+
+#endif // INDEXER_H
@@ -0,0 +1,112 @@
+/*
+ * simd.h -- SIMD abstractions targeting AVX-512 (Ice Lake)
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#define SIMD_8X_SIZE (64)
+
+// tables are looked up with vpshufb, which operates on 128-bit lanes.
+// broadcast the table to all lanes on load
+typedef uint8_t simd_table_t[16];
+
+#define SIMD_TABLE(v00, v01, v02, v03, v04, v05, v06, v07, \
+                   v08, v09, v0a, v0b, v0c, v0d, v0e, v0f) \
+  {                                                        \
+    v00, v01, v02, v03, v04, v05, v06, v07,                \
+    v08, v09, v0a, v0b, v0c, v0d, v0e, v0f                 \
+  }
+
+typedef struct { __m512i chunks[1]; } simd_8x_t;
+
+typedef struct { __m128i chunks[1]; } simd_8x16_t;
+
+typedef struct { __m256i chunks[1]; } simd_8x32_t;
+
+typedef simd_8x_t simd_8x64_t;
+
+nonnull_all
+static really_inline void simd_loadu_8x(simd_8x_t *simd, const void *address)
+{
+  simd->chunks[0] = _mm512_loadu_si512(address);
+}
+
+// bytes not selected by mask are zeroed. masked out bytes are not accessed
+// and therefore cannot fault, which allows reading the last (partial) block
+// of the input without copying it first
+nonnull_all
+static really_inline void simd_maskz_loadu_8x(
+  simd_8x_t *simd, const void *address, uint64_t mask)
+{
+  simd->chunks[0] = _mm512_maskz_loadu_epi8((__mmask64)mask, address);
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x(void *address, const simd_8x_t *simd)
+{
+  _mm512_storeu_si512(address, simd->chunks[0]);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x(const simd_8x_t *simd, char key)
+{
+  const __m512i k = _mm512_set1_epi8(key);
+  return (uint64_t)_mm512_cmpeq_epi8_mask(simd->chunks[0], k);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_any_8x(
+  const simd_8x_t *simd, const simd_table_t table)
+{
+  const __m512i t = _mm512_broadcast_i32x4(
+    _mm_loadu_si128((const __m128i *)table));
+  return (uint64_t)_mm512_cmpeq_epi8_mask(
+    _mm512_shuffle_epi8(t, simd->chunks[0]), simd->chunks[0]);
+}
+
+nonnull_all
+static really_inline void simd_loadu_8x16(simd_8x16_t *simd, const uint8_t *address)
+{
+  simd->chunks[0] = _mm_loadu_si128((const __m128i *)address);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x16(const simd_8x16_t *simd, char key)
+{
+  const __m128i k = _mm_set1_epi8(key);
+  return (uint64_t)_mm_cmpeq_epi8_mask(simd->chunks[0], k);
+}
+
+nonnull_all
+static really_inline void simd_loadu_8x32(simd_8x32_t *simd, const void *address)
+{
+  simd->chunks[0] = _mm256_loadu_si256((const __m256i *)address);
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x32(void *address, const simd_8x32_t *simd)
+{
+  _mm256_storeu_si256((__m256i *)address, simd->chunks[0]);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x32(const simd_8x32_t *simd, char key)
+{
+  const __m256i k = _mm256_set1_epi8(key);
+  return (uint64_t)_mm256_cmpeq_epi8_mask(simd->chunks[0], k);
+}
+
+#define simd_loadu_8x64(simd, address) simd_loadu_8x(simd, address)
+#define simd_maskz_loadu_8x64(simd, address, mask) \
+  simd_maskz_loadu_8x(simd, address, mask)
+#define simd_find_8x64(simd, key) simd_find_8x(simd, key)
+#define simd_find_any_8x64(simd, table) simd_find_any_8x(simd, table)
+
+#endif // SIMD_H
@@ -0,0 +1,449 @@
+/*
+ * includes.c -- parse included files on multiple threads
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include "config.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include "zone.h"
+#include "attributes.h"
+#include "diagnostic.h"
+#include "internal.h"
+
+#if HAVE_PTHREAD
+// whether held records may be delivered is checked every so many octets
+#define HOLD_CHECK_SIZE (64u * 1024u)
+// whether parts that deliver records directly are cancelled is checked every
+// so many records
+#define LIVE_CHECK_COUNT (256u)
+
+// the top-level file is split into parts at $INCLUDE entries, every file
+// included from the top-level file is a part of its own. parts are
+// numbered in the order of the entries
+typedef struct part part_t;
+struct part {
+  /** included file, NULL once claimed or for records in the top-level file */
+  file_t *file;
+  /** owner in effect at the $INCLUDE entry */
+  zone_name_buffer_t owner;
+  /** records held until preceding parts are delivered */
+  records_t records;
+  bool done;
+};
+
+typedef struct include_worker include_worker_t;
+struct include_worker {
+  /** passed to callbacks, first member so that the worker can be found */
+  zone_chunk_t chunk;
+  struct zone_include_pool *pool;
+  parser_t parser;
+  records_t records;
+  /** number of octets held when it was last checked if records are due */
+  size_t checked;
+  /** number of records delivered directly */
+  size_t accepted;
+  /** preceding parts are delivered, records are no longer held */
+  bool live;
+};
+
+typedef struct zone_include_pool include_pool_t;
+struct zone_include_pool {
+  pthread_mutex_t lock;
+  /** signaled if a file is included or the top-level file is done */
+  pthread_cond_t included;
+  int32_t (*parse)(parser_t *);
+  zone_accept_t accept;
+  bool ordered;
+  size_t count, size;
+  part_t *parts;
+  /** next part to consider for claiming and number of parts delivered */
+  size_t next, delivered;
+  /** held records are delivered by one thread at a time */
+  bool delivering;
+  /** top-level file is done, no more parts are added */
+  bool finished;
+  /** error code and sequence number of the first part that failed, parts
+      that precede it are parsed and delivered, parts that follow are not */
+  int32_t code;
+  size_t failed;
+  bool stop;
+};
+
+static inline bool is_cancelled(const include_pool_t *pool, size_t sequence)
+{
+  return pool->stop && sequence > pool->failed;
+}
+
+static void fail_part(include_pool_t *pool, size_t sequence, int32_t code)
+{
+  if (!pool->code || sequence < pool->failed) {
+    pool->code = code;
+    pool->failed = sequence;
+  }
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->included);
+}
+
+// deliver records of parts that are done, in order. invoked with the lock
+// held, which is released while records are delivered
+nonnull_all
+static void deliver_parts(include_pool_t *pool, include_worker_t *worker)
+{
+  if (pool->delivering)
+    return;
+  pool->delivering = true;
+  while (!is_cancelled(pool, pool->delivered) &&
+         pool->delivered < pool->count &&
+         pool->parts[pool->delivered].done)
+  {
+    const size_t sequence = pool->delivered;
+    // parts may be reallocated while the lock is released
+    const records_t records = pool->parts[sequence].records;
+    if (records.length) {
+      zone_chunk_t chunk =
+        { worker->chunk.thread, sequence, worker->chunk.user_data };
+      pthread_mutex_unlock(&pool->lock);
+      // TTLs of included files are final, none are inherited
+      const int32_t code = zone_deliver_held_records(
+        &records, pool->accept, &worker->parser, 0, 0, &chunk);
+      pthread_mutex_lock(&pool->lock);
+      free(records.data);
+      memset(&pool->parts[sequence].records, 0, sizeof(records));
+      if (code < 0) {
+        fail_part(pool, sequence, code);
+        break;
+      }
+    }
+    pool->delivered++;
+  }
+  pool->delivering = false;
+}
+
+// invoked with the lock held
+nonnull_all
+static void finish_part(
+  include_pool_t *pool, include_worker_t *worker, int32_t code)
+{
+  const size_t sequence = worker->chunk.sequence;
+
+  pool->parts[sequence].done = true;
+  if (code < 0)
+    fail_part(pool, sequence, code);
+  if (!pool->ordered)
+    return;
+  if (!worker->live) {
+    pool->parts[sequence].records = worker->records;
+    memset(&worker->records, 0, sizeof(worker->records));
+  }
+  deliver_parts(pool, worker);
+}
+
+// records are held until preceding parts are delivered if records are to
+// be delivered in order. parts are cancelled if a preceding part failed,
+// regardless of whether records are delivered in order
+static int32_t hold_or_accept(
+  parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  include_worker_t *worker = user_data;
+  include_pool_t *pool = worker->pool;
+  int32_t code;
+
+  if (worker->live) {
+    if (++worker->accepted % LIVE_CHECK_COUNT == 0) {
+      pthread_mutex_lock(&pool->lock);
+      code = is_cancelled(pool, worker->chunk.sequence) ? pool->code : 0;
+      pthread_mutex_unlock(&pool->lock);
+      if (code < 0)
+        return code;
+    }
+    return pool->accept(
+      parser, owner, type, class, ttl, rdlength, rdata, user_data);
+  }
+
+  code = zone_hold_record(
+    &worker->records, owner, type, class, ttl, rdlength, rdata);
+  if (code < 0 || worker->records.length - worker->checked < HOLD_CHECK_SIZE)
+    return code;
+
+  worker->checked = worker->records.length;
+  pthread_mutex_lock(&pool->lock);
+  worker->live = pool->delivered == worker->chunk.sequence;
+  code = is_cancelled(pool, worker->chunk.sequence) ? pool->code : 0;
+  pthread_mutex_unlock(&pool->lock);
+  if (code < 0 || !worker->live)
+    return code;
+
+  code = zone_deliver_held_records(
+    &worker->records, pool->accept, parser, 0, 0, user_data);
+  worker->records.length = worker->checked = 0;
+  return code;
+}
+
+// included file is taken over as the first file so that the parser stops
+// at the end of it. the includer remains with the top-level parser, which
+// outlives the workers, and is used to detect circular includes
+nonnull_all
+static int32_t parse_part(
+  include_pool_t *pool,
+  include_worker_t *worker,
+  file_t *file,
+  const zone_name_buffer_t *owner)
+{
+  parser_t *parser = &worker->parser;
+  file_t *first = &parser->first;
+  int32_t code;
+
+  memcpy(first, file, sizeof(*first));
+  first->fields.head = first->fields.tape + (file->fields.head - file->fields.tape);
+  first->fields.tail = first->fields.tape + (file->fields.tail - file->fields.tape);
+  first->delimiters.head =
+    first->delimiters.tape + (file->delimiters.head - file->delimiters.tape);
+  first->delimiters.tail =
+    first->delimiters.tape + (file->delimiters.tail - file->delimiters.tape);
+  first->newlines.head =
+    first->newlines.tape + (file->newlines.head - file->newlines.tape);
+  first->newlines.tail =
+    first->newlines.tape + (file->newlines.tail - file->newlines.tape);
+  if (first->ttl == &file->last_ttl)
+    first->ttl = first->default_ttl = &first->last_ttl;
+  else
+    first->ttl = first->default_ttl = &first->dollar_ttl;
+  free(file);
+
+  parser->file = first;
+  parser->owner = &parser->buffers.owner.blocks[0];
+  parser->rdata = &parser->buffers.rdata.blocks[0];
+  *parser->owner = *owner;
+  worker->records.length = worker->checked = 0;
+  code = pool->parse(parser);
+  zone_close(parser);
+  return code;
+}
+
+static void *parse_parts(void *argument)
+{
+  include_worker_t *worker = argument;
+  include_pool_t *pool = worker->pool;
+  zone_name_buffer_t owner;
+  file_t *file;
+  int32_t code;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->next < pool->count && !pool->parts[pool->next].file)
+      pool->next++;
+    if (is_cancelled(pool, pool->next))
+      break;
+    if (pool->next == pool->count) {
+      if (pool->finished)
+        break;
+      pthread_cond_wait(&pool->included, &pool->lock);
+      continue;
+    }
+
+    const size_t sequence = pool->next++;
+    file = pool->parts[sequence].file;
+    owner = pool->parts[sequence].owner;
+    pool->parts[sequence].file = NULL;
+    worker->chunk.sequence = sequence;
+    worker->live = !pool->ordered || pool->delivered == sequence;
+    pthread_mutex_unlock(&pool->lock);
+
+    code = parse_part(pool, worker, file, &owner);
+
+    pthread_mutex_lock(&pool->lock);
+    finish_part(pool, worker, code);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+nonnull_all
+static int32_t parse_includes(
+  parser_t *parser,
+  zone_buffers_t *buffers,
+  size_t threads,
+  bool ordered,
+  void *user_data)
+{
+  int32_t code;
+  include_pool_t pool;
+  include_worker_t *workers;
+  pthread_t *handles;
+  zone_options_t options = parser->options;
+
+  memset(&pool, 0, sizeof(pool));
+  pool.parse = zone_select_kernel()->parse;
+  pool.accept = options.accept.callback;
+  pool.ordered = ordered;
+  pool.size = 64;
+  options.accept.callback = hold_or_accept;
+
+  pool.parts = calloc(pool.size, sizeof(*pool.parts));
+  workers = calloc(threads, sizeof(*workers));
+  handles = calloc(threads, sizeof(*handles));
+  if (!pool.parts || !workers || !handles) {
+    free(pool.parts);
+    free(workers);
+    free(handles);
+    return ZONE_OUT_OF_MEMORY;
+  }
+
+  for (size_t i=0; i < threads; i++) {
+    zone_buffers_t scratch = { 1, &buffers->owner[i], &buffers->rdata[i] };
+    (void)zone_setup_parser(
+      &workers[i].parser, &options, &scratch, &workers[i].chunk);
+    workers[i].pool = &pool;
+    workers[i].chunk.thread = i;
+    workers[i].chunk.user_data = user_data;
+  }
+
+  // top-level file is parsed on the calling thread, records of the first
+  // part are never held
+  pool.count = 1;
+  workers[0].live = true;
+  parser->options = options;
+  parser->user_data = &workers[0].chunk;
+  parser->includes = &pool;
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.included, NULL);
+
+  size_t count = 1;
+  for (; count < threads; count++)
+    if (pthread_create(&handles[count], NULL, parse_parts, &workers[count]) != 0)
+      break;
+
+  code = pool.parse(parser);
+
+  pthread_mutex_lock(&pool.lock);
+  finish_part(&pool, &workers[0], code);
+  pool.finished = true;
+  pthread_cond_broadcast(&pool.included);
+  pthread_mutex_unlock(&pool.lock);
+
+  // calling thread parses included files too once the top-level file is done
+  parse_parts(&workers[0]);
+  for (size_t i=1; i < count; i++)
+    pthread_join(handles[i], NULL);
+
+  pthread_cond_destroy(&pool.included);
+  pthread_mutex_destroy(&pool.lock);
+  parser->includes = NULL;
+
+  for (size_t i=0; i < pool.count; i++) {
+    zone_close_file(parser, pool.parts[i].file);
+    free(pool.parts[i].records.data);
+  }
+  for (size_t i=0; i < threads; i++)
+    free(workers[i].records.data);
+  free(pool.parts);
+  free(workers);
+  free(handles);
+  return pool.code;
+}
+#endif
+
+diagnostic_push()
+clang_diagnostic_ignored(missing-prototypes)
+
+// hand over file included from the top-level file to the include pool. the
+// part of the top-level file that precedes the $INCLUDE entry ends
+nonnull_all
+int32_t zone_defer_include(parser_t *parser, zone_file_t *file)
+{
+#if HAVE_PTHREAD
+  include_pool_t *pool = parser->includes;
+  include_worker_t *worker = parser->user_data;
+  int32_t code = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  if (is_cancelled(pool, worker->chunk.sequence)) {
+    code = pool->code;
+  } else if (pool->size - pool->count < 2) {
+    part_t *parts;
+    if ((parts = realloc(pool->parts, 2 * pool->size * sizeof(*parts)))) {
+      memset(parts + pool->size, 0, pool->size * sizeof(*parts));
+      pool->parts = parts;
+      pool->size *= 2;
+    } else {
+      code = ZONE_OUT_OF_MEMORY;
+    }
+  }
+
+  if (code == 0) {
+    pool->parts[pool->count].file = file;
+    pool->parts[pool->count].owner = *parser->owner;
+    finish_part(pool, worker, 0);
+    // records that follow the $INCLUDE entry are a part of their own
+    worker->chunk.sequence = pool->count + 1;
+    worker->live = !pool->ordered;
+    worker->checked = 0;
+    pool->count += 2;
+    pthread_cond_broadcast(&pool->included);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  if (code < 0)
+    zone_close_file(parser, file);
+  return code;
+#else
+  (void)parser;
+  zone_close_file(parser, file);
+  return ZONE_NOT_IMPLEMENTED;
+#endif
+}
+
+diagnostic_pop()
+
+int32_t zone_parse_includes(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  size_t threads,
+  bool ordered,
+  void *user_data)
+{
+  int32_t code;
+  zone_chunk_t chunk = { 0, 0, user_data };
+
+  if (threads > buffers->size)
+    threads = buffers->size;
+  if ((code = zone_initialize_parser(parser, options, buffers, &chunk)) < 0)
+    return code;
+  if ((code = zone_open_first(parser, path)) < 0)
+    return code;
+
+#if HAVE_PTHREAD
+  if (threads > 1 && !options->no_includes) {
+    code = parse_includes(parser, buffers, threads, ordered, user_data);
+    zone_close(parser);
+    return code;
+  }
+#else
+  (void)ordered;
+#endif
+
+  code = zone_parse_file(parser, &chunk);
+  zone_close(parser);
+  return code;
+}
@@ -0,0 +1,351 @@
+/*
+ * index.c -- checkpoint index to parse ranges of a zone file
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_MMAP
+#  include <sys/mman.h>
+#endif
+
+#include "zone.h"
+#include "attributes.h"
+#include "diagnostic.h"
+#include "internal.h"
+
+#if HAVE_MMAP
+// parts of a file are parsed from the mapping, which is taken over from the
+// parser so that the parser can be reinitialized for each part
+nonnull_all
+static void detach_source(parser_t *parser, source_t *source)
+{
+  zone_initialize_source(parser, source);
+  parser->first.mapped = false;
+  parser->first.buffer.data = NULL;
+  parser->first.name = NULL;
+  parser->first.path = NULL;
+  zone_close(parser);
+}
+
+nonnull_all
+static void release_source(source_t *source)
+{
+  (void)munmap((void *)source->data, zone_mapped_size(source->length));
+  free((char *)source->name);
+  free((char *)source->path);
+}
+
+// checkpoints must be at the start of a line in a file of the same length
+nonnull_all
+static bool is_indexed(
+  const source_t *source, const zone_index_t *index, size_t checkpoint)
+{
+  if (index->length != source->length)
+    return false;
+  if (checkpoint == index->count)
+    return true;
+  const size_t offset = index->checkpoints[checkpoint].offset;
+  if (offset == 0)
+    return true;
+  return offset < source->length && source->data[offset - 1] == '\n';
+}
+
+static int32_t discard_record(
+  parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  (void)parser;
+  (void)owner;
+  (void)type;
+  (void)class;
+  (void)ttl;
+  (void)rdlength;
+  (void)rdata;
+  (void)user_data;
+  return 0;
+}
+
+nonnull_all
+static int32_t add_checkpoint(zone_index_t *index, const context_t *context)
+{
+  if (index->count == index->size) {
+    const size_t size = index->size ? index->size * 2 : 16;
+    zone_checkpoint_t *checkpoints;
+    if (!(checkpoints = realloc(index->checkpoints, size * sizeof(*checkpoints))))
+      return ZONE_OUT_OF_MEMORY;
+    index->checkpoints = checkpoints;
+    index->size = size;
+  }
+  index->checkpoints[index->count++] = *context;
+  return 0;
+}
+
+nonnull_all
+static int32_t build_index(
+  parser_t *parser, size_t interval, zone_index_t *index)
+{
+  int32_t code;
+  source_t source;
+  context_t start, context;
+
+  detach_source(parser, &source);
+  index->length = source.length;
+  index->interval = interval;
+  zone_initial_context(&parser->options, &start);
+  if ((code = add_checkpoint(index, &start)) < 0)
+    goto cleanup;
+
+  // parts end at the first entry at or past the interval, which is where
+  // the next checkpoint is placed
+  while (start.offset < source.length) {
+    size_t limit = source.length;
+    if (interval < source.length - start.offset)
+      limit = start.offset + interval;
+    if ((code = zone_parse_chunk(&source, parser, &start, limit, &context)) < 0)
+      goto cleanup;
+    if (context.offset < source.length &&
+        (code = add_checkpoint(index, &context)) < 0)
+      goto cleanup;
+    start = context;
+  }
+
+cleanup:
+  release_source(&source);
+  return code;
+}
+#endif
+
+int32_t zone_build_index(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  size_t interval,
+  zone_index_t *index,
+  void *user_data)
+{
+  int32_t code;
+  zone_options_t build = *options;
+
+  memset(index, 0, sizeof(*index));
+  if (!interval)
+    return ZONE_BAD_PARAMETER;
+  // records are passed to the application if it is interested
+  if (!build.accept.callback)
+    build.accept.callback = discard_record;
+  if ((code = zone_initialize_parser(parser, &build, buffers, user_data)) < 0)
+    return code;
+  if ((code = zone_open_first(parser, path)) < 0)
+    return code;
+
+#if HAVE_MMAP
+  if (parser->first.mapped) {
+    if ((code = build_index(parser, interval, index)) < 0)
+      zone_free_index(index);
+    return code;
+  }
+#endif
+
+  zone_close(parser);
+  return ZONE_NOT_IMPLEMENTED;
+}
+
+int32_t zone_parse_range(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  const zone_index_t *index,
+  size_t from,
+  size_t to,
+  void *user_data)
+{
+  int32_t code;
+
+  if (from >= to || to > index->count)
+    return ZONE_BAD_PARAMETER;
+  if ((code = zone_initialize_parser(parser, options, buffers, user_data)) < 0)
+    return code;
+  if ((code = zone_open_first(parser, path)) < 0)
+    return code;
+
+#if HAVE_MMAP
+  if (parser->first.mapped) {
+    source_t source;
+    context_t context;
+    detach_source(parser, &source);
+    if (!is_indexed(&source, index, from) || !is_indexed(&source, index, to)) {
+      code = ZONE_BAD_PARAMETER;
+    } else {
+      const size_t limit = to < index->count
+        ? index->checkpoints[to].offset : source.length;
+      code = zone_parse_chunk(
+        &source, parser, &index->checkpoints[from], limit, &context);
+    }
+    release_source(&source);
+    return code;
+  }
+#endif
+
+  zone_close(parser);
+  return ZONE_NOT_IMPLEMENTED;
+}
+
+// index files start with a magic and version, integers are stored in
+// little endian order and names are prefixed by their length
+static const char index_magic[8] = { 'Z', 'O', 'N', 'E', 'I', 'D', 'X', 1 };
+#define INDEX_HEADER_SIZE (sizeof(index_magic) + 3 * 8)
+#define CHECKPOINT_SIZE (8 + 8 + 4 + 4 + 2 + 1 + 1 + 1)
+
+static inline void store_le(uint8_t *data, uint64_t value, size_t size)
+{
+  for (size_t i=0; i < size; i++)
+    data[i] = (uint8_t)(value >> (i * 8));
+}
+
+static inline uint64_t load_le(const uint8_t *data, size_t size)
+{
+  uint64_t value = 0;
+  for (size_t i=0; i < size; i++)
+    value |= (uint64_t)data[i] << (i * 8);
+  return value;
+}
+
+static int32_t open_code(void)
+{
+  switch (errno) {
+    case ENOMEM: return ZONE_OUT_OF_MEMORY;
+    case EACCES: return ZONE_NOT_PERMITTED;
+    default:     return ZONE_NOT_A_FILE;
+  }
+}
+
+diagnostic_push()
+msvc_diagnostic_ignored(4996)
+
+int32_t zone_write_index(const zone_index_t *index, const char *path)
+{
+  FILE *handle;
+  uint8_t data[CHECKPOINT_SIZE + 2 * 255];
+  size_t length;
+
+  if (!(handle = fopen(path, "wb")))
+    return open_code();
+
+  memcpy(data, index_magic, sizeof(index_magic));
+  store_le(data + sizeof(index_magic), index->length, 8);
+  store_le(data + sizeof(index_magic) + 8, index->interval, 8);
+  store_le(data + sizeof(index_magic) + 16, index->count, 8);
+  if (fwrite(data, 1, INDEX_HEADER_SIZE, handle) != INDEX_HEADER_SIZE)
+    goto error;
+
+  for (size_t i=0; i < index->count; i++) {
+    const zone_checkpoint_t *checkpoint = &index->checkpoints[i];
+    const size_t origin = checkpoint->origin.length;
+    const size_t owner = checkpoint->owner.length;
+    assert(origin <= 255 && owner <= 255);
+    store_le(data, checkpoint->offset, 8);
+    store_le(data + 8, checkpoint->line, 8);
+    store_le(data + 16, checkpoint->last_ttl, 4);
+    store_le(data + 20, checkpoint->dollar_ttl, 4);
+    store_le(data + 24, checkpoint->last_class, 2);
+    data[26] = checkpoint->use_dollar_ttl;
+    data[27] = (uint8_t)origin;
+    data[28] = (uint8_t)owner;
+    memcpy(data + CHECKPOINT_SIZE, checkpoint->origin.octets, origin);
+    memcpy(data + CHECKPOINT_SIZE + origin, checkpoint->owner.octets, owner);
+    length = CHECKPOINT_SIZE + origin + owner;
+    if (fwrite(data, 1, length, handle) != length)
+      goto error;
+  }
+
+  if (fclose(handle) != 0)
+    return ZONE_WRITE_ERROR;
+  return 0;
+error:
+  (void)fclose(handle);
+  return ZONE_WRITE_ERROR;
+}
+
+int32_t zone_read_index(zone_index_t *index, const char *path)
+{
+  int32_t code = ZONE_BAD_PARAMETER;
+  FILE *handle;
+  uint8_t data[INDEX_HEADER_SIZE];
+  uint64_t length, interval, count;
+
+  memset(index, 0, sizeof(*index));
+  if (!(handle = fopen(path, "rb")))
+    return open_code();
+
+  if (fread(data, 1, INDEX_HEADER_SIZE, handle) != INDEX_HEADER_SIZE ||
+      memcmp(data, index_magic, sizeof(index_magic)) != 0)
+    goto error;
+  length = load_le(data + sizeof(index_magic), 8);
+  interval = load_le(data + sizeof(index_magic) + 8, 8);
+  count = load_le(data + sizeof(index_magic) + 16, 8);
+  // checkpoints are at least interval octets apart
+  if (length > SIZE_MAX || !interval || !count || count - 1 > length / interval)
+    goto error;
+  if (!(index->checkpoints = calloc((size_t)count, sizeof(*index->checkpoints)))) {
+    code = ZONE_OUT_OF_MEMORY;
+    goto error;
+  }
+  index->length = (size_t)length;
+  index->interval = (size_t)interval;
+  index->size = (size_t)count;
+
+  for (; index->count < count; index->count++) {
+    zone_checkpoint_t *checkpoint = &index->checkpoints[index->count];
+    if (fread(data, 1, CHECKPOINT_SIZE, handle) != CHECKPOINT_SIZE)
+      goto error;
+    const uint64_t offset = load_le(data, 8);
+    // offsets are in order, the first checkpoint is at the top of the file
+    if (index->count ? offset <= checkpoint[-1].offset : offset != 0)
+      goto error;
+    if (offset >= length || data[26] > 1 || !data[27])
+      goto error;
+    checkpoint->offset = (size_t)offset;
+    checkpoint->line = (size_t)load_le(data + 8, 8);
+    checkpoint->last_ttl = (uint32_t)load_le(data + 16, 4);
+    checkpoint->dollar_ttl = (uint32_t)load_le(data + 20, 4);
+    checkpoint->last_class = (uint16_t)load_le(data + 24, 2);
+    checkpoint->use_dollar_ttl = data[26] != 0;
+    checkpoint->origin.length = data[27];
+    checkpoint->owner.length = data[28];
+    if (fread(checkpoint->origin.octets, 1, data[27], handle) != data[27] ||
+        fread(checkpoint->owner.octets, 1, data[28], handle) != data[28])
+      goto error;
+  }
+
+  (void)fclose(handle);
+  return 0;
+error:
+  (void)fclose(handle);
+  zone_free_index(index);
+  return code;
+}
+
+diagnostic_pop()
+
+void zone_free_index(zone_index_t *index)
+{
+  free(index->checkpoints);
+  memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,155 @@
+/*
+ * internal.h -- interfaces shared by the translation units of the library
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INTERNAL_H
+#define INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "zone.h"
+#include "attributes.h"
+
+typedef zone_parser_t parser_t; // convenience
+typedef zone_file_t file_t;
+
+// see zone.c
+
+typedef struct kernel kernel_t;
+struct kernel {
+  const char *name;
+  uint32_t instruction_set;
+  int32_t (*parse)(parser_t *);
+};
+
+// kernel preferred through the ZONE_KERNEL environment variable if set and
+// supported, the most capable kernel supported by the host otherwise
+const kernel_t *zone_select_kernel(void);
+
+// parse opened file with the selected kernel
+nonnull((1))
+int32_t zone_parse_file(parser_t *parser, void *user_data);
+
+// options are validated, no accept callback is required
+nonnull((1,2,3))
+int32_t zone_setup_parser(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  void *user_data);
+
+nonnull((1,2,3))
+int32_t zone_initialize_parser(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  void *user_data);
+
+nonnull_all
+void zone_initialize_file(parser_t *parser, file_t *file);
+
+// absolute path of file, used to detect circular includes
+nonnull_all
+int32_t zone_resolve_path(const char *include, char **path);
+
+// close and release included file, file may be NULL
+nonnull((1))
+void zone_close_file(parser_t *parser, file_t *file);
+
+// open the top-level file, failure is reported
+nonnull_all
+int32_t zone_open_first(parser_t *parser, const char *path);
+
+#if HAVE_MMAP
+// size of the mapping of a file of length octets, including padding
+size_t zone_mapped_size(size_t length);
+#endif
+
+// read into data from the file handle, i.e. without decompressing
+nonnull_all
+int32_t zone_read_handle(
+  parser_t *parser, file_t *file, char *data, size_t size, size_t *count);
+
+// see compression.c
+
+#if HAVE_ZLIB || HAVE_ZSTD
+// open decompressor if the file is compressed. bytes read to detect the
+// format are returned in magic if the stream is not seekable
+nonnull_all
+int32_t zone_open_decompressor(
+  parser_t *parser, file_t *file, char magic[4], size_t *length);
+
+nonnull_all
+void zone_close_decompressor(file_t *file);
+
+nonnull_all
+int32_t zone_decompress(
+  parser_t *parser, file_t *file, char *data, size_t size, size_t *count);
+#endif
+
+// see parallel.c
+
+#if HAVE_MMAP
+// files are parsed in parts by scanning the mapping in place from the start
+// of an entry, i.e. a point where the scanner state is empty, up to the
+// first entry at or past a limit
+typedef zone_checkpoint_t context_t;
+
+typedef struct source source_t;
+struct source {
+  int32_t (*parse)(parser_t *);
+  /** file mapped into memory */
+  const char *data;
+  size_t length;
+  const char *name, *path;
+};
+
+nonnull_all
+void zone_initialize_source(const parser_t *parser, source_t *source);
+
+nonnull_all
+void zone_initial_context(const zone_options_t *options, context_t *context);
+
+nonnull_all
+int32_t zone_parse_chunk(
+  const source_t *source,
+  parser_t *parser,
+  const context_t *start,
+  size_t limit,
+  context_t *context);
+#endif
+
+#if HAVE_PTHREAD
+// records are held in a buffer if they cannot be delivered yet, e.g. if the
+// preceding chunk is not done, and are delivered from the buffer later
+typedef struct records records_t;
+struct records {
+  size_t length, size;
+  char *data;
+};
+
+int32_t zone_hold_record(
+  records_t *records,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata);
+
+nonnull_all
+int32_t zone_deliver_held_records(
+  const records_t *records,
+  zone_accept_t accept,
+  parser_t *parser,
+  uint32_t inherited_ttl,
+  uint32_t last_ttl,
+  void *user_data);
+#endif
+
+#endif // INTERNAL_H
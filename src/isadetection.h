@@ -249,7 +249,9 @@ static inline uint32_t detect_supported_architectures(void)
   //    CPUID.1:ECX bit 28 = 1.
   // 3. Issue XGETBV, and verify that the feature-enabled mask at bits 1 and 2
   //    are 11b (XMM state and YMM state enabled by the operating system).
-
+  // 4. For AVX-512, additionally verify the feature-enabled mask at bits 5,
+  //    6 and 7 are 111b (opmask state, upper 256 bits of ZMM0-ZMM15 and
+  //    ZMM16-ZMM31 state enabled by the operating system).
 
   // Determine if the CPU supports AVX
   have_avx = (ecx & cpuid_have_avx_bit) != 0;
@@ -258,8 +260,13 @@ static inline uint32_t detect_supported_architectures(void)
 
   if (have_avx && have_xgetbv) {
     uint64_t xcr0 = xgetbv(0x0);
-    if ((xcr0 & 0x6) == 0x6)
+    const uint32_t avx512_isa = AVX512F | AVX512DQ | AVX512IFMA | AVX512PF |
+                                AVX512ER | AVX512CD | AVX512BW | AVX512VL |
+                                AVX512VBMI2;
+    if ((xcr0 & 0xe6) == 0xe6)
       host_isa |= host_avx_isa;
+    else if ((xcr0 & 0x6) == 0x6)
+      host_isa |= host_avx_isa & ~avx512_isa;
   }
 
   return host_isa;
@@ -0,0 +1,98 @@
+/*
+ * base32.h -- Fast Base32 decoder (ARM NEON)
+ *
+ * Copyright (c) 2023, Daniel Lemire and @aqrit.
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef BASE32_H
+#define BASE32_H
+
+#include <stdint.h>
+
+//////////////////////////
+/// Port of the AVX2 decoder in haswell/base32.h. vpmaddubsw/vpmaddwd have
+/// no direct equivalent, quintets are merged using shift-and-insert instead.
+/// Source: Wojciech Muła, Daniel Lemire, Faster Base64 Encoding and Decoding Using AVX2 Instructions,
+///         ACM Transactions on the Web 12 (3), 2018
+///         https://arxiv.org/abs/1704.00605
+//////////////////////////
+
+static size_t base32hex_neon(uint8_t *dst, const uint8_t *src) {
+  static const int8_t delta_check_table[16] = {
+    -16, -32, -48, 70, -65, 41, -97, 9, 0, 0, 0, 0, 0, 0, 0, 0 };
+  static const int8_t delta_rebase_table[16] = {
+    0, 0, 0, -48, -55, -55, -87, -87, 0, 0, 0, 0, 0, 0, 0, 0 };
+  // select bytes 4, 3, 2, 1 and 0 of each 40-bit group (big endian)
+  static const uint8_t shuffle_table[16] = {
+    4, 3, 2, 1, 0, 12, 11, 10, 9, 8, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  static const uint8_t offsets_table[16] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+  bool valid = true;
+  const int8x16_t delta_check = vld1q_s8(delta_check_table);
+  const int8x16_t delta_rebase = vld1q_s8(delta_rebase_table);
+  const uint8x16_t shuffle = vld1q_u8(shuffle_table);
+  const uint8x16_t offsets = vld1q_u8(offsets_table);
+  const uint8_t *srcinit = src;
+  do {
+    uint8x16_t v = vld1q_u8(src);
+
+    const uint8x16_t hash_key = vshrq_n_u8(v, 4);
+    const int8x16_t check = vaddq_s8(
+      vqtbl1q_s8(delta_check, hash_key), vreinterpretq_s8_u8(v));
+    v = vreinterpretq_u8_s8(vaddq_s8(
+      vreinterpretq_s8_u8(v), vqtbl1q_s8(delta_rebase, hash_key)));
+    const uint64_t m = simd_movemask_8x16(vcltzq_s8(check));
+
+    if (m) {
+      const uint64_t length = trailing_zeroes(m);
+      if (length == 0) {
+        break;
+      }
+      src += length;
+      v = vandq_u8(v, vcltq_u8(offsets, vdupq_n_u8((uint8_t)length)));
+      valid = false;
+    } else { // common case
+      src += 16;
+    }
+    // merge quintets into 10-bit, 20-bit and finally 40-bit groups
+    const uint16x8_t v16 = vreinterpretq_u16_u8(v);
+    const uint16x8_t p16 = vorrq_u16(
+      vshlq_n_u16(vandq_u16(v16, vdupq_n_u16(0xff)), 5), vshrq_n_u16(v16, 8));
+    const uint32x4_t v32 = vreinterpretq_u32_u16(p16);
+    const uint32x4_t p32 = vorrq_u32(
+      vshlq_n_u32(vandq_u32(v32, vdupq_n_u32(0xffff)), 10), vshrq_n_u32(v32, 16));
+    const uint64x2_t v64 = vreinterpretq_u64_u32(p32);
+    const uint64x2_t p64 = vorrq_u64(
+      vshlq_n_u64(vandq_u64(v64, vdupq_n_u64(0xffffffff)), 20), vshrq_n_u64(v64, 32));
+    // store bytes
+    vst1q_u8(dst, vqtbl1q_u8(vreinterpretq_u8_u64(p64), shuffle));
+    dst += 10;
+  } while (valid);
+
+  return (size_t)(src - srcinit);
+}
+
+nonnull_all
+static really_inline int32_t parse_base32(
+  parser_t *parser,
+  const type_info_t *type,
+  const rdata_info_t *field,
+  rdata_t *rdata,
+  const token_t *token)
+{
+  size_t length = (token->length * 5) / 8;
+  if (length > 255 || (uintptr_t)rdata->limit - (uintptr_t)rdata->octets < (length + 1))
+    SYNTAX_ERROR(parser, "Invalid %s in %s", NAME(field), NAME(type));
+
+  size_t decoded = base32hex_neon(rdata->octets+1, (const uint8_t*)token->data);
+  if (decoded != token->length)
+    SYNTAX_ERROR(parser, "Invalid %s in %s", NAME(field), NAME(type));
+  *rdata->octets = (uint8_t)length;
+  rdata->octets += 1 + length;
+  return 0;
+}
+
+#endif // BASE32_H
@@ -0,0 +1,61 @@
+/*
+ * bits.h -- ARM NEON (AArch64) specific implementation of bit manipulation
+ *           instructions
+ *
+ * Copyright (c) 2018-2023 The simdjson authors
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef BITS_H
+#define BITS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <arm_neon.h>
+
+static inline bool add_overflow(uint64_t value1, uint64_t value2, uint64_t *result) {
+#if has_builtin(__builtin_uaddll_overflow)
+  return __builtin_uaddll_overflow(value1, value2, (unsigned long long *)result);
+#else
+  *result = value1 + value2;
+  return *result < value1;
+#endif
+}
+
+static inline uint64_t count_ones(uint64_t bits) {
+  return vaddv_u8(vcnt_u8(vcreate_u8(bits)));
+}
+
+no_sanitize_undefined
+static inline uint64_t trailing_zeroes(uint64_t bits) {
+  return (uint64_t)__builtin_ctzll(bits);
+}
+
+// result might be undefined when bits is zero
+static inline uint64_t clear_lowest_bit(uint64_t bits) {
+  return bits & (bits - 1);
+}
+
+no_sanitize_undefined
+static inline uint64_t leading_zeroes(uint64_t bits) {
+  return (uint64_t)__builtin_clzll(bits);
+}
+
+static inline uint64_t prefix_xor(uint64_t bitmask) {
+#if defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO)
+  // carry-less multiplication requires the cryptographic extension, which is
+  // optional in ARMv8-A (not available on e.g. the Raspberry Pi 4)
+  return (uint64_t)vmull_p64((poly64_t)bitmask, (poly64_t)~0ull);
+#else
+  bitmask ^= bitmask << 1;
+  bitmask ^= bitmask << 2;
+  bitmask ^= bitmask << 4;
+  bitmask ^= bitmask << 8;
+  bitmask ^= bitmask << 16;
+  bitmask ^= bitmask << 32;
+  return bitmask;
+#endif
+}
+
+#endif // BITS_H
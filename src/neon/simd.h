@@ -0,0 +1,173 @@
+/*
+ * simd.h -- SIMD abstractions targeting ARM NEON (AArch64)
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include <arm_neon.h>
+
+#define SIMD_8X_SIZE (16)
+
+typedef uint8_t simd_table_t[SIMD_8X_SIZE];
+
+#define SIMD_TABLE(v00, v01, v02, v03, v04, v05, v06, v07, \
+                   v08, v09, v0a, v0b, v0c, v0d, v0e, v0f) \
+  {                                                        \
+    v00, v01, v02, v03, v04, v05, v06, v07,                \
+    v08, v09, v0a, v0b, v0c, v0d, v0e, v0f                 \
+  }
+
+typedef struct { uint8x16_t chunks[1]; } simd_8x_t;
+
+typedef simd_8x_t simd_8x16_t;
+
+typedef struct { uint8x16_t chunks[2]; } simd_8x32_t;
+
+typedef struct { uint8x16_t chunks[4]; } simd_8x64_t;
+
+// NEON has no equivalent of movemask. isolate a unique bit per byte and
+// reduce using pairwise additions (approach taken from simdjson)
+static const uint8_t simd_bits[16] = {
+  0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+  0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
+};
+
+static really_inline uint64_t simd_movemask_8x16(uint8x16_t r)
+{
+  const uint8x16_t b = vld1q_u8(simd_bits);
+  uint8x16_t s = vandq_u8(r, b);
+  s = vpaddq_u8(s, s);
+  s = vpaddq_u8(s, s);
+  s = vpaddq_u8(s, s);
+  return vgetq_lane_u16(vreinterpretq_u16_u8(s), 0);
+}
+
+static really_inline uint64_t simd_movemask_8x32(uint8x16_t r0, uint8x16_t r1)
+{
+  const uint8x16_t b = vld1q_u8(simd_bits);
+  uint8x16_t s = vpaddq_u8(vandq_u8(r0, b), vandq_u8(r1, b));
+  s = vpaddq_u8(s, s);
+  s = vpaddq_u8(s, s);
+  return vgetq_lane_u32(vreinterpretq_u32_u8(s), 0);
+}
+
+static really_inline uint64_t simd_movemask_8x64(
+  uint8x16_t r0, uint8x16_t r1, uint8x16_t r2, uint8x16_t r3)
+{
+  const uint8x16_t b = vld1q_u8(simd_bits);
+  uint8x16_t s0 = vpaddq_u8(vandq_u8(r0, b), vandq_u8(r1, b));
+  uint8x16_t s1 = vpaddq_u8(vandq_u8(r2, b), vandq_u8(r3, b));
+  s0 = vpaddq_u8(s0, s1);
+  s0 = vpaddq_u8(s0, s0);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+
+// vqtbl1q_u8 yields zero for indexes outside the table, whereas pshufb uses
+// the lower nibble if the most significant bit is not set. mask the index to
+// mimic pshufb so that tables are shared with the x86_64 kernels
+static really_inline uint8x16_t simd_lookup_8x16(uint8x16_t t, uint8x16_t v)
+{
+  return vqtbl1q_u8(t, vandq_u8(v, vdupq_n_u8(0x8f)));
+}
+
+nonnull_all
+static really_inline void simd_loadu_8x(simd_8x_t *simd, const uint8_t *address)
+{
+  simd->chunks[0] = vld1q_u8(address);
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x(uint8_t *address, const simd_8x_t *simd)
+{
+  vst1q_u8(address, simd->chunks[0]);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x(const simd_8x_t *simd, char key)
+{
+  const uint8x16_t k = vdupq_n_u8((uint8_t)key);
+  return simd_movemask_8x16(vceqq_u8(simd->chunks[0], k));
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_any_8x(
+  const simd_8x_t *simd, const simd_table_t table)
+{
+  const uint8x16_t t = vld1q_u8(table);
+  const uint8x16_t r = vceqq_u8(
+    simd_lookup_8x16(t, simd->chunks[0]), simd->chunks[0]);
+  return simd_movemask_8x16(r);
+}
+
+#define simd_loadu_8x16(simd, address) simd_loadu_8x(simd, address)
+#define simd_find_8x16(simd, key) simd_find_8x(simd, key)
+
+nonnull_all
+static really_inline void simd_loadu_8x32(simd_8x32_t *simd, const char *address)
+{
+  simd->chunks[0] = vld1q_u8((const uint8_t *)(address));
+  simd->chunks[1] = vld1q_u8((const uint8_t *)(address+16));
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x32(uint8_t *address, const simd_8x32_t *simd)
+{
+  vst1q_u8(address, simd->chunks[0]);
+  vst1q_u8(address+16, simd->chunks[1]);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x32(const simd_8x32_t *simd, char key)
+{
+  const uint8x16_t k = vdupq_n_u8((uint8_t)key);
+  const uint8x16_t r0 = vceqq_u8(simd->chunks[0], k);
+  const uint8x16_t r1 = vceqq_u8(simd->chunks[1], k);
+  return simd_movemask_8x32(r0, r1);
+}
+
+nonnull_all
+static really_inline void simd_loadu_8x64(simd_8x64_t *simd, const uint8_t *address)
+{
+  simd->chunks[0] = vld1q_u8(address);
+  simd->chunks[1] = vld1q_u8(address+16);
+  simd->chunks[2] = vld1q_u8(address+32);
+  simd->chunks[3] = vld1q_u8(address+48);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x64(const simd_8x64_t *simd, char key)
+{
+  const uint8x16_t k = vdupq_n_u8((uint8_t)key);
+
+  const uint8x16_t r0 = vceqq_u8(simd->chunks[0], k);
+  const uint8x16_t r1 = vceqq_u8(simd->chunks[1], k);
+  const uint8x16_t r2 = vceqq_u8(simd->chunks[2], k);
+  const uint8x16_t r3 = vceqq_u8(simd->chunks[3], k);
+
+  return simd_movemask_8x64(r0, r1, r2, r3);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_any_8x64(
+  const simd_8x64_t *simd, const simd_table_t table)
+{
+  const uint8x16_t t = vld1q_u8(table);
+
+  const uint8x16_t r0 = vceqq_u8(
+    simd_lookup_8x16(t, simd->chunks[0]), simd->chunks[0]);
+  const uint8x16_t r1 = vceqq_u8(
+    simd_lookup_8x16(t, simd->chunks[1]), simd->chunks[1]);
+  const uint8x16_t r2 = vceqq_u8(
+    simd_lookup_8x16(t, simd->chunks[2]), simd->chunks[2]);
+  const uint8x16_t r3 = vceqq_u8(
+    simd_lookup_8x16(t, simd->chunks[3]), simd->chunks[3]);
+
+  return simd_movemask_8x64(r0, r1, r2, r3);
+}
+
+#endif // SIMD_H
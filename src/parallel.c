@@ -0,0 +1,571 @@
+/*
+ * parallel.c -- parse large zone files on multiple threads
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include "config.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include "zone.h"
+#include "attributes.h"
+#include "internal.h"
+
+#if HAVE_MMAP
+nonnull_all
+static void open_chunk(
+  const source_t *source,
+  parser_t *parser,
+  const context_t *context,
+  size_t limit)
+{
+  file_t *file = &parser->first;
+
+  parser->file = file;
+  parser->owner = &parser->buffers.owner.blocks[0];
+  parser->rdata = &parser->buffers.rdata.blocks[0];
+  zone_initialize_file(parser, file);
+
+  // chunks are scanned in place, the mapping provides the padding
+  file->name = (char *)source->name;
+  file->path = (char *)source->path;
+  file->borrowed = true;
+  file->buffer.data = (char *)source->data + context->offset;
+  file->buffer.size = source->length - context->offset;
+  file->buffer.length = source->length - context->offset;
+  file->fields.tape[0] = &source->data[source->length];
+  file->fields.tape[1] = &source->data[source->length];
+  if (limit < source->length)
+    file->chunk.limit = &source->data[limit];
+
+  file->line = context->line;
+  file->origin = context->origin;
+  *parser->owner = context->owner;
+  file->last_ttl = context->last_ttl;
+  file->dollar_ttl = context->dollar_ttl;
+  file->last_class = context->last_class;
+  if (context->use_dollar_ttl)
+    file->ttl = file->default_ttl = &file->dollar_ttl;
+  else
+    file->ttl = file->default_ttl = &file->last_ttl;
+}
+
+nonnull_all
+static void close_chunk(
+  const source_t *source, parser_t *parser, context_t *context)
+{
+  const file_t *file = &parser->first;
+
+  if (file->chunk.end)
+    context->offset = (size_t)(file->chunk.end - source->data);
+  else
+    context->offset = source->length;
+  context->line = file->line;
+  context->origin = file->origin;
+  context->owner = *parser->owner;
+  context->last_ttl = file->last_ttl;
+  context->dollar_ttl = file->dollar_ttl;
+  context->use_dollar_ttl = file->default_ttl == &file->dollar_ttl;
+  context->last_class = file->last_class;
+
+  // name and path are shared by all chunks
+  parser->first.name = NULL;
+  parser->first.path = NULL;
+  zone_close(parser);
+}
+
+// parse chunk from where the preceding chunk ends, records are delivered
+// as they are parsed
+nonnull_all
+int32_t zone_parse_chunk(
+  const source_t *source,
+  parser_t *parser,
+  const context_t *start,
+  size_t limit,
+  context_t *context)
+{
+  int32_t code;
+
+  // entries that straddle the limit belong to the preceding chunk
+  *context = *start;
+  if (start->offset >= limit)
+    return 0;
+  open_chunk(source, parser, start, limit);
+  code = source->parse(parser);
+  close_chunk(source, parser, context);
+  return code;
+}
+
+nonnull_all
+void zone_initial_context(const zone_options_t *options, context_t *context)
+{
+  memset(context, 0, sizeof(*context));
+  context->line = 1;
+  context->origin.length = options->origin.length;
+  memcpy(context->origin.octets,
+         options->origin.octets,
+         options->origin.length);
+  context->last_ttl = context->dollar_ttl = options->default_ttl;
+  context->last_class = options->default_class;
+}
+
+nonnull_all
+void zone_initialize_source(const parser_t *parser, source_t *source)
+{
+  source->parse = zone_select_kernel()->parse;
+  source->data = parser->first.buffer.data;
+  source->length = parser->first.buffer.length;
+  source->name = parser->first.name;
+  source->path = parser->first.path;
+}
+#endif
+
+#if HAVE_PTHREAD
+// held records are stored back-to-back, owner and RDATA follow the header
+typedef struct record record_t;
+struct record {
+  uint32_t ttl;
+  uint16_t type, class, rdlength;
+  uint8_t owner_length;
+};
+
+int32_t zone_hold_record(
+  records_t *records,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata)
+{
+  const record_t record = { ttl, type, class, rdlength, owner->length };
+  const size_t size = sizeof(record) + owner->length + rdlength;
+
+  if (records->size - records->length < size) {
+    size_t capacity = records->size ? records->size : 65536;
+    while (capacity - records->length < size)
+      capacity *= 2;
+    char *data;
+    if (!(data = realloc(records->data, capacity)))
+      return ZONE_OUT_OF_MEMORY;
+    records->data = data;
+    records->size = capacity;
+  }
+
+  char *record_data = records->data + records->length;
+  memcpy(record_data, &record, sizeof(record));
+  memcpy(record_data + sizeof(record), owner->octets, owner->length);
+  memcpy(record_data + sizeof(record) + owner->length, rdata, rdlength);
+  records->length += size;
+  return 0;
+}
+
+// records held with a TTL of inherited_ttl are delivered with last_ttl
+nonnull_all
+int32_t zone_deliver_held_records(
+  const records_t *records,
+  zone_accept_t accept,
+  parser_t *parser,
+  uint32_t inherited_ttl,
+  uint32_t last_ttl,
+  void *user_data)
+{
+  int32_t code;
+  record_t record;
+
+  for (size_t index = 0; index < records->length; ) {
+    const char *data = records->data + index;
+    memcpy(&record, data, sizeof(record));
+    const zone_name_t owner =
+      { record.owner_length, (const uint8_t *)data + sizeof(record) };
+    const uint8_t *rdata = owner.octets + owner.length;
+    if (record.ttl == inherited_ttl)
+      record.ttl = last_ttl;
+    code = accept(parser, &owner, record.type, record.class, record.ttl,
+                  record.rdlength, rdata, user_data);
+    if (code < 0)
+      return code;
+    index += sizeof(record) + owner.length + record.rdlength;
+  }
+
+  return 0;
+}
+#endif
+
+#if HAVE_PTHREAD && HAVE_MMAP
+// chunks are sized so that every thread parses a couple of chunks, which
+// evens out differences in parse time, within bounds as records of a chunk
+// are held until the preceding chunk is done
+#define CHUNKS_PER_THREAD (4)
+#define MINIMUM_CHUNK_SIZE (1u * 1024u * 1024u)
+#define MAXIMUM_CHUNK_SIZE (16u * 1024u * 1024u)
+// the first chunk is parsed before other threads start so that the origin,
+// TTL and class stated at the top of the file are used to guess the context
+// of the chunks that follow
+#define FIRST_CHUNK_SIZE (64u * 1024u)
+// the last stated TTL is not guessed. TTLs with the MSB set are rejected,
+// records that use the last stated TTL of the preceding chunk are patched
+// once it is known
+#define INHERITED_TTL (UINT32_MAX)
+
+typedef struct chunk chunk_t;
+struct chunk {
+  /** offset of the line that likely starts an entry */
+  size_t start;
+  /** state at the end of the chunk, valid once the chunk is done */
+  context_t context;
+};
+
+typedef struct worker worker_t;
+struct worker {
+  struct chunk_pool *pool;
+  parser_t parser;
+  zone_chunk_t chunk;
+  /** records parsed speculatively, delivered if the guess was right */
+  records_t records;
+  /** guess was wrong or speculation was aborted, e.g. on $INCLUDE */
+  bool failed;
+};
+
+typedef struct chunk_pool chunk_pool_t;
+struct chunk_pool {
+  pthread_mutex_t lock;
+  /** signaled if a chunk is done */
+  pthread_cond_t done;
+  source_t source;
+  const zone_options_t *options;
+  size_t chunk_count;
+  chunk_t *chunks;
+  /** number of chunks claimed and done, chunks are done in order */
+  size_t next, finished;
+  /** error code and sequence number of the first chunk that failed */
+  int32_t code;
+  size_t failed;
+  bool stop;
+};
+
+// likely start of an entry, i.e. a line that starts with a character that
+// may start an owner or control entry
+static size_t find_entry(const char *data, size_t length, size_t offset)
+{
+  assert(offset);
+  for (size_t index = offset - 1; index < length; ) {
+    const char *newline = memchr(&data[index], '\n', length - index);
+    if (!newline)
+      break;
+    index = (size_t)(newline - data) + 1;
+    if (index < length && !strchr(" \t\r\n;()\"", data[index]))
+      return index;
+  }
+  return length;
+}
+
+static int32_t save_record(
+  parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  worker_t *worker = user_data;
+
+  (void)parser;
+  return zone_hold_record(
+    &worker->records, owner, type, class, ttl, rdlength, rdata);
+}
+
+nonnull_all
+static int32_t deliver_records(
+  chunk_pool_t *pool, worker_t *worker, uint32_t last_ttl)
+{
+  return zone_deliver_held_records(
+    &worker->records, pool->options->accept.callback, &worker->parser,
+    INHERITED_TTL, last_ttl, &worker->chunk);
+}
+
+// messages are reported once the chunk is parsed again
+static void speculative_log(
+  zone_parser_t *parser,
+  uint32_t priority,
+  const char *file,
+  size_t line,
+  const char *message,
+  void *user_data)
+{
+  (void)parser;
+  (void)priority;
+  (void)file;
+  (void)line;
+  (void)message;
+  ((worker_t *)user_data)->failed = true;
+}
+
+// included files are opened once the chunk is parsed again
+static int32_t speculative_open(
+  zone_parser_t *parser,
+  const char *name,
+  zone_reader_t **reader,
+  void *user_data)
+{
+  (void)parser;
+  (void)name;
+  (void)reader;
+  ((worker_t *)user_data)->failed = true;
+  return ZONE_NOT_PERMITTED;
+}
+
+static inline size_t chunk_limit(const chunk_pool_t *pool, size_t sequence)
+{
+  if (sequence + 1 < pool->chunk_count)
+    return pool->chunks[sequence + 1].start;
+  return pool->source.length;
+}
+
+// parse chunk without knowing where the preceding chunk ends, or which
+// origin, TTL and class apply. records are held until the guess is validated
+nonnull_all
+static void speculate(
+  chunk_pool_t *pool,
+  worker_t *worker,
+  size_t sequence,
+  const context_t *guess,
+  context_t *context)
+{
+  parser_t *parser = &worker->parser;
+
+  *context = *guess;
+  context->offset = pool->chunks[sequence].start;
+  context->line = 1;
+  context->owner.length = 0;
+  context->last_ttl = INHERITED_TTL;
+  open_chunk(&pool->source, parser, context, chunk_limit(pool, sequence));
+
+  parser->options.log.mask = 0;
+  parser->options.log.callback = speculative_log;
+  parser->options.accept.callback = save_record;
+  parser->options.include.callback = 0;
+  parser->options.include.open = speculative_open;
+  parser->user_data = worker;
+  worker->records.length = 0;
+  worker->failed = false;
+
+  if (pool->source.parse(parser) < 0)
+    worker->failed = true;
+  close_chunk(&pool->source, parser, context);
+  parser->options = *pool->options;
+  parser->user_data = &worker->chunk;
+}
+
+static inline bool is_compatible(
+  const context_t *guess, const context_t *context)
+{
+  if (guess->last_class != context->last_class ||
+      guess->use_dollar_ttl != context->use_dollar_ttl)
+    return false;
+  if (guess->use_dollar_ttl && guess->dollar_ttl != context->dollar_ttl)
+    return false;
+  return guess->origin.length == context->origin.length &&
+         memcmp(guess->origin.octets,
+                context->origin.octets,
+                context->origin.length) == 0;
+}
+
+static void *parse_chunks(void *argument)
+{
+  worker_t *worker = argument;
+  chunk_pool_t *pool = worker->pool;
+  context_t guess, start, context;
+  int32_t code;
+
+  pthread_mutex_lock(&pool->lock);
+  while (!pool->stop && pool->next < pool->chunk_count) {
+    const size_t sequence = pool->next++;
+    assert(pool->finished);
+    // the most recent chunk that is done is the best guess
+    guess = pool->chunks[pool->finished - 1].context;
+    pthread_mutex_unlock(&pool->lock);
+
+    speculate(pool, worker, sequence, &guess, &context);
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop && pool->finished < sequence)
+      pthread_cond_wait(&pool->done, &pool->lock);
+    if (pool->stop)
+      break;
+    start = pool->chunks[sequence - 1].context;
+    worker->chunk.sequence = sequence;
+
+    if (!worker->failed &&
+        start.offset == pool->chunks[sequence].start &&
+        is_compatible(&guess, &start))
+    {
+      // line, TTL and owner are only known once the preceding chunk is done
+      context.line += start.line - 1;
+      if (context.last_ttl == INHERITED_TTL)
+        context.last_ttl = start.last_ttl;
+      if (!context.owner.length)
+        context.owner = start.owner;
+      pool->chunks[sequence].context = context;
+      pool->finished++;
+      pthread_cond_broadcast(&pool->done);
+      pthread_mutex_unlock(&pool->lock);
+      code = deliver_records(pool, worker, start.last_ttl);
+      pthread_mutex_lock(&pool->lock);
+    } else {
+      pthread_mutex_unlock(&pool->lock);
+      code = zone_parse_chunk(&pool->source, &worker->parser, &start,
+                         chunk_limit(pool, sequence), &context);
+      pthread_mutex_lock(&pool->lock);
+      if (code >= 0) {
+        pool->chunks[sequence].context = context;
+        pool->finished++;
+        pthread_cond_broadcast(&pool->done);
+      }
+    }
+
+    if (code < 0) {
+      if (!pool->code || sequence < pool->failed) {
+        pool->code = code;
+        pool->failed = sequence;
+      }
+      pool->stop = true;
+      pthread_cond_broadcast(&pool->done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+nonnull_all
+static int32_t parse_parallel(
+  parser_t *parser,
+  zone_buffers_t *buffers,
+  size_t threads,
+  void *user_data)
+{
+  int32_t code;
+  chunk_pool_t pool;
+  worker_t *workers;
+  pthread_t *handles;
+  const size_t length = parser->first.buffer.length;
+  size_t size = length / (threads * CHUNKS_PER_THREAD);
+
+  if (size < MINIMUM_CHUNK_SIZE)
+    size = MINIMUM_CHUNK_SIZE;
+  if (size > MAXIMUM_CHUNK_SIZE)
+    size = MAXIMUM_CHUNK_SIZE;
+
+  memset(&pool, 0, sizeof(pool));
+  zone_initialize_source(parser, &pool.source);
+  pool.options = &parser->options;
+  if (!(pool.chunks = malloc((length / size + 2) * sizeof(*pool.chunks))))
+    return ZONE_OUT_OF_MEMORY;
+
+  pool.chunks[0].start = 0;
+  pool.chunk_count = 1;
+  for (size_t offset = FIRST_CHUNK_SIZE; offset < length; ) {
+    const size_t start = find_entry(pool.source.data, length, offset);
+    if (start >= length)
+      break;
+    pool.chunks[pool.chunk_count++].start = start;
+    offset = start + size;
+  }
+
+  workers = calloc(threads, sizeof(*workers));
+  handles = calloc(threads, sizeof(*handles));
+  if (!workers || !handles) {
+    free(workers);
+    free(handles);
+    free(pool.chunks);
+    return ZONE_OUT_OF_MEMORY;
+  }
+
+  for (size_t i=0; i < threads; i++) {
+    zone_buffers_t scratch = { 1, &buffers->owner[i], &buffers->rdata[i] };
+    (void)zone_setup_parser(
+      &workers[i].parser, &parser->options, &scratch, &workers[i].chunk);
+    workers[i].pool = &pool;
+    workers[i].chunk.thread = i;
+    workers[i].chunk.user_data = user_data;
+  }
+
+  // first chunk is parsed on the calling thread, from the top of the file
+  context_t start, context;
+  zone_initial_context(&parser->options, &start);
+  code = zone_parse_chunk(&pool.source, &workers[0].parser, &start,
+                     chunk_limit(&pool, 0), &context);
+  if (code < 0)
+    goto cleanup;
+
+  pool.chunks[0].context = context;
+  pool.next = pool.finished = 1;
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.done, NULL);
+
+  size_t count = 1;
+  for (; count < threads && count < pool.chunk_count; count++)
+    if (pthread_create(&handles[count], NULL, parse_chunks, &workers[count]) != 0)
+      break;
+  parse_chunks(&workers[0]);
+  for (size_t i=1; i < count; i++)
+    pthread_join(handles[i], NULL);
+
+  pthread_cond_destroy(&pool.done);
+  pthread_mutex_destroy(&pool.lock);
+  code = pool.code;
+cleanup:
+  for (size_t i=0; i < threads; i++)
+    free(workers[i].records.data);
+  free(workers);
+  free(handles);
+  free(pool.chunks);
+  return code;
+}
+#endif
+
+int32_t zone_parse_parallel(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  size_t threads,
+  void *user_data)
+{
+  int32_t code;
+  zone_chunk_t chunk = { 0, 0, user_data };
+
+  if (threads > buffers->size)
+    threads = buffers->size;
+  if ((code = zone_initialize_parser(parser, options, buffers, &chunk)) < 0)
+    return code;
+  if ((code = zone_open_first(parser, path)) < 0)
+    return code;
+
+#if HAVE_PTHREAD && HAVE_MMAP
+  // pipes, compressed files, etc are not mapped and parsed sequentially
+  if (threads > 1 && parser->first.mapped &&
+      parser->first.buffer.length >= 2 * MINIMUM_CHUNK_SIZE)
+  {
+    code = parse_parallel(parser, buffers, threads, user_data);
+    zone_close(parser);
+    return code;
+  }
+#endif
+
+  code = zone_parse_file(parser, &chunk);
+  zone_close(parser);
+  return code;
+}
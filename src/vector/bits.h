@@ -0,0 +1,57 @@
+/*
+ * bits.h -- bit manipulation instructions using GCC/Clang builtins
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef BITS_H
+#define BITS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+static inline bool add_overflow(uint64_t value1, uint64_t value2, uint64_t *result) {
+  return __builtin_uaddll_overflow(value1, value2, (unsigned long long *)result);
+}
+
+static inline uint64_t count_ones(uint64_t bits) {
+#if defined __POPCNT__ || defined __aarch64__ || defined __riscv_zbb || \
+    defined _ARCH_PWR7
+  return (uint64_t)__builtin_popcountll(bits);
+#else
+  // __builtin_popcountll compiles to a library call if the target lacks a
+  // population count instruction, which is considerably slower
+  bits = bits - ((bits >> 1) & 0x5555555555555555llu);
+  bits = (bits & 0x3333333333333333llu) + ((bits >> 2) & 0x3333333333333333llu);
+  bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0fllu;
+  return (bits * 0x0101010101010101llu) >> 56;
+#endif
+}
+
+no_sanitize_undefined
+static inline uint64_t trailing_zeroes(uint64_t bits) {
+  return (uint64_t)__builtin_ctzll(bits);
+}
+
+// result might be undefined when bits is zero
+static inline uint64_t clear_lowest_bit(uint64_t bits) {
+  return bits & (bits - 1);
+}
+
+no_sanitize_undefined
+static inline uint64_t leading_zeroes(uint64_t bits) {
+  return (uint64_t)__builtin_clzll(bits);
+}
+
+static inline uint64_t prefix_xor(uint64_t bitmask) {
+  bitmask ^= bitmask << 1;
+  bitmask ^= bitmask << 2;
+  bitmask ^= bitmask << 4;
+  bitmask ^= bitmask << 8;
+  bitmask ^= bitmask << 16;
+  bitmask ^= bitmask << 32;
+  return bitmask;
+}
+
+#endif // BITS_H
@@ -0,0 +1,54 @@
+/*
+ * parser.c -- vector extensions compilation target for (DNS) zone file parser
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause.
+ *
+ */
+#include "zone.h"
+#include "attributes.h"
+#include "diagnostic.h"
+#include "vector/simd.h"
+#include "generic/endian.h"
+#include "vector/bits.h"
+#include "generic/parser.h"
+#include "generic/scanner.h"
+#include "generic/indexer.h"
+#include "generic/number.h"
+#include "generic/ttl.h"
+#include "generic/time.h"
+#include "generic/ip4.h"
+#include "generic/ip6.h"
+#include "generic/text.h"
+#include "generic/name.h"
+#include "generic/base16.h"
+#include "generic/base32.h"
+#include "generic/base64.h"
+#include "generic/nsec.h"
+#include "generic/nxt.h"
+#include "generic/caa.h"
+#include "generic/ilnp64.h"
+#include "generic/eui.h"
+#include "generic/nsap.h"
+#include "generic/wks.h"
+#include "generic/loc.h"
+#include "generic/gpos.h"
+#include "generic/apl.h"
+#include "generic/svcb.h"
+#include "generic/cert.h"
+#include "generic/atma.h"
+#include "generic/algorithm.h"
+#include "generic/types.h"
+#include "generic/type.h"
+#include "generic/format.h"
+
+diagnostic_push()
+clang_diagnostic_ignored(missing-prototypes)
+
+int32_t zone_vector_parse(parser_t *parser)
+{
+  return parse(parser);
+}
+
+diagnostic_pop()
@@ -0,0 +1,201 @@
+/*
+ * simd.h -- SIMD abstractions using GCC/Clang vector extensions
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define SIMD_8X_SIZE (16)
+
+typedef uint8_t simd_table_t[SIMD_8X_SIZE];
+
+#define SIMD_TABLE(v00, v01, v02, v03, v04, v05, v06, v07, \
+                   v08, v09, v0a, v0b, v0c, v0d, v0e, v0f) \
+  {                                                        \
+    v00, v01, v02, v03, v04, v05, v06, v07,                \
+    v08, v09, v0a, v0b, v0c, v0d, v0e, v0f                 \
+  }
+
+// 128-bit vectors map onto SSE, NEON, AltiVec, z/Architecture vector
+// facility and RVV (VLEN >= 128). the compiler lowers operations to scalar
+// code if the target has no vector unit
+typedef uint8_t simd_u8x16_t __attribute__((vector_size(16)));
+typedef uint16_t simd_u16x8_t __attribute__((vector_size(16)));
+typedef uint32_t simd_u32x4_t __attribute__((vector_size(16)));
+typedef uint64_t simd_u64x2_t __attribute__((vector_size(16)));
+
+typedef struct { simd_u8x16_t chunks[1]; } simd_8x_t;
+
+typedef simd_8x_t simd_8x16_t;
+
+typedef struct { simd_u8x16_t chunks[2]; } simd_8x32_t;
+
+typedef struct { simd_u8x16_t chunks[4]; } simd_8x64_t;
+
+// there is no portable movemask. assign each byte a unique bit and fold the
+// bytes of each 64-bit lane using vector shifts
+static really_inline uint64_t simd_movemask_8x16(simd_u8x16_t r)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  const uint64_t bits = 0x0102040810204080llu;
+#else
+  const uint64_t bits = 0x8040201008040201llu;
+#endif
+  simd_u64x2_t m = (simd_u64x2_t)r & bits;
+  m |= m >> 32;
+  m |= m >> 16;
+  m |= m >> 8;
+  return (m[0] & 0xff) | ((m[1] & 0xff) << 8);
+}
+
+// gather four 16-bit masks at once. bytes are assigned a unique bit within
+// each 64-bit lane and folded in three steps, each step merging the results
+// of two chunks. in the end byte c of each 64-bit lane holds the mask of
+// chunk c for that lane, which are interleaved in a general purpose register
+static really_inline uint64_t simd_movemask_8x64(
+  simd_u8x16_t r0, simd_u8x16_t r1, simd_u8x16_t r2, simd_u8x16_t r3)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  const uint64_t bits = 0x0102040810204080llu;
+#else
+  const uint64_t bits = 0x8040201008040201llu;
+#endif
+  const simd_u16x8_t x0 = (simd_u16x8_t)((simd_u64x2_t)r0 & bits);
+  const simd_u16x8_t x1 = (simd_u16x8_t)((simd_u64x2_t)r1 & bits);
+  const simd_u16x8_t x2 = (simd_u16x8_t)((simd_u64x2_t)r2 & bits);
+  const simd_u16x8_t x3 = (simd_u16x8_t)((simd_u64x2_t)r3 & bits);
+
+  const simd_u32x4_t y01 = (simd_u32x4_t)(((x0 | (x0 >> 8)) & 0x00ff) |
+                                          ((x1 | (x1 << 8)) & 0xff00));
+  const simd_u32x4_t y23 = (simd_u32x4_t)(((x2 | (x2 >> 8)) & 0x00ff) |
+                                          ((x3 | (x3 << 8)) & 0xff00));
+
+  simd_u64x2_t z = (simd_u64x2_t)(((y01 | (y01 >> 16)) & 0x0000ffff) |
+                                  ((y23 | (y23 << 16)) & 0xffff0000));
+  z |= z >> 32;
+
+  // interleave bytes of both lanes
+  uint64_t m0 = z[0] & 0xffffffff, m1 = z[1] & 0xffffffff;
+  m0 = (m0 | (m0 << 16)) & 0x0000ffff0000ffffllu;
+  m0 = (m0 | (m0 <<  8)) & 0x00ff00ff00ff00ffllu;
+  m1 = (m1 | (m1 << 16)) & 0x0000ffff0000ffffllu;
+  m1 = (m1 | (m1 <<  8)) & 0x00ff00ff00ff00ffllu;
+  return m0 | (m1 << 8);
+}
+
+// variable shuffles are not portable (Clang only supports constant indexes).
+// byte v is matched by table if v == table[v & 0x0f] (pshufb semantics),
+// which is true only for entries whose lower nibble equals their index.
+// tables are constant, the compiler reduces the comparisons to the entries
+// that match. loops are not necessarily unrolled, hence the macro
+#define SIMD_MATCH(r, v, table, i) \
+  if ((table[i] & 0x8f) == i) \
+    r |= (simd_u8x16_t)(v == table[i]);
+
+static really_inline simd_u8x16_t simd_match_8x16(
+  simd_u8x16_t v, const simd_table_t table)
+{
+  simd_u8x16_t r = { 0 };
+  SIMD_MATCH(r, v, table, 0x0) SIMD_MATCH(r, v, table, 0x1)
+  SIMD_MATCH(r, v, table, 0x2) SIMD_MATCH(r, v, table, 0x3)
+  SIMD_MATCH(r, v, table, 0x4) SIMD_MATCH(r, v, table, 0x5)
+  SIMD_MATCH(r, v, table, 0x6) SIMD_MATCH(r, v, table, 0x7)
+  SIMD_MATCH(r, v, table, 0x8) SIMD_MATCH(r, v, table, 0x9)
+  SIMD_MATCH(r, v, table, 0xa) SIMD_MATCH(r, v, table, 0xb)
+  SIMD_MATCH(r, v, table, 0xc) SIMD_MATCH(r, v, table, 0xd)
+  SIMD_MATCH(r, v, table, 0xe) SIMD_MATCH(r, v, table, 0xf)
+  return r;
+}
+
+#undef SIMD_MATCH
+
+nonnull_all
+static really_inline void simd_loadu_8x(simd_8x_t *simd, const uint8_t *address)
+{
+  memcpy(&simd->chunks[0], address, 16);
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x(uint8_t *address, const simd_8x_t *simd)
+{
+  memcpy(address, &simd->chunks[0], 16);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x(const simd_8x_t *simd, char key)
+{
+  return simd_movemask_8x16(
+    (simd_u8x16_t)(simd->chunks[0] == (uint8_t)key));
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_any_8x(
+  const simd_8x_t *simd, const simd_table_t table)
+{
+  return simd_movemask_8x16(simd_match_8x16(simd->chunks[0], table));
+}
+
+#define simd_loadu_8x16(simd, address) simd_loadu_8x(simd, address)
+#define simd_find_8x16(simd, key) simd_find_8x(simd, key)
+
+nonnull_all
+static really_inline void simd_loadu_8x32(simd_8x32_t *simd, const char *address)
+{
+  memcpy(&simd->chunks[0], address, 16);
+  memcpy(&simd->chunks[1], address+16, 16);
+}
+
+nonnull_all
+static really_inline void simd_storeu_8x32(uint8_t *address, const simd_8x32_t *simd)
+{
+  memcpy(address, &simd->chunks[0], 16);
+  memcpy(address+16, &simd->chunks[1], 16);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x32(const simd_8x32_t *simd, char key)
+{
+  const uint64_t m0 = simd_movemask_8x16(
+    (simd_u8x16_t)(simd->chunks[0] == (uint8_t)key));
+  const uint64_t m1 = simd_movemask_8x16(
+    (simd_u8x16_t)(simd->chunks[1] == (uint8_t)key));
+  return m0 | (m1 << 16);
+}
+
+nonnull_all
+static really_inline void simd_loadu_8x64(simd_8x64_t *simd, const uint8_t *address)
+{
+  memcpy(&simd->chunks[0], address, 16);
+  memcpy(&simd->chunks[1], address+16, 16);
+  memcpy(&simd->chunks[2], address+32, 16);
+  memcpy(&simd->chunks[3], address+48, 16);
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_8x64(const simd_8x64_t *simd, char key)
+{
+  return simd_movemask_8x64(
+    (simd_u8x16_t)(simd->chunks[0] == (uint8_t)key),
+    (simd_u8x16_t)(simd->chunks[1] == (uint8_t)key),
+    (simd_u8x16_t)(simd->chunks[2] == (uint8_t)key),
+    (simd_u8x16_t)(simd->chunks[3] == (uint8_t)key));
+}
+
+nonnull_all
+static really_inline uint64_t simd_find_any_8x64(
+  const simd_8x64_t *simd, const simd_table_t table)
+{
+  return simd_movemask_8x64(
+    simd_match_8x16(simd->chunks[0], table),
+    simd_match_8x16(simd->chunks[1], table),
+    simd_match_8x16(simd->chunks[2], table),
+    simd_match_8x16(simd->chunks[3], table));
+}
+
+#endif // SIMD_H
@@ -0,0 +1,60 @@
+/*
+ * base16.h -- Fast Base16 stream decoder (SSE4.2)
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef BASE16_SSE_H
+#define BASE16_SSE_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+// decode 16 characters at a time straight into the output buffer, stop at
+// the first character that is not a hexadecimal digit and leave the
+// remainder to the generic loop. input and output buffers are padded,
+// reading or writing past the end is safe
+static really_inline void base16_dec_loop_sse(
+  const uint8_t **s, size_t *slen, uint8_t **o, size_t *olen)
+{
+  while (*slen >= 2) {
+    const __m128i input = _mm_loadu_si128((const __m128i *)*s);
+    // digits map to 0-9, letters (either case) map to 0-5
+    const __m128i digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+    const __m128i letters = _mm_sub_epi8(
+      _mm_or_si128(input, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_digit =
+      _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    const __m128i is_letter =
+      _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+    const uint64_t invalid = (uint16_t)~_mm_movemask_epi8(
+      _mm_or_si128(is_digit, is_letter));
+
+    size_t length = *slen < 16 ? *slen : 16;
+    if (invalid && trailing_zeroes(invalid) < length)
+      length = trailing_zeroes(invalid);
+    length &= ~(size_t)1;
+    if (!length)
+      break;
+
+    const __m128i nibbles = _mm_blendv_epi8(
+      _mm_add_epi8(letters, _mm_set1_epi8(10)), digits, is_digit);
+    // merge nibbles into octets, most significant nibble comes first
+    const __m128i octets =
+      _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+    _mm_storel_epi64((__m128i *)*o, _mm_packus_epi16(octets, octets));
+
+    *s += length;
+    *slen -= length;
+    *o += length / 2;
+    *olen += length / 2;
+    if (length != 16)
+      break;
+  }
+}
+
+#define BASE16_DEC_LOOP base16_dec_loop_sse
+
+#endif // BASE16_SSE_H
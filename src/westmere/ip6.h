@@ -0,0 +1,145 @@
+/*
+ * ip6.h -- SSE 4.1 parser for IPv6 addresses
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef IP6_SSE_H
+#define IP6_SSE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+// nibbles of a group are right-aligned in four bytes, indexes of absent
+// nibbles have the high bit set and are zeroed by pshufb
+static const uint32_t ip6_group_patterns[5] = {
+  0x80808080, 0x00808080, 0x01008080, 0x02010080, 0x03020100
+};
+
+// gather 16 nibbles from the 48 bytes of input, pshufb only indexes 16 bytes
+// so each chunk is shuffled and the right one is selected by index
+static really_inline __m128i ip6_gather_sse(
+  const __m128i nibbles[3], const __m128i index)
+{
+  const __m128i chunk1 = _mm_cmpgt_epi8(index, _mm_set1_epi8(15));
+  const __m128i chunk2 = _mm_cmpgt_epi8(index, _mm_set1_epi8(31));
+  __m128i gather = _mm_shuffle_epi8(nibbles[0], index);
+  gather = _mm_blendv_epi8(gather, _mm_shuffle_epi8(nibbles[1], index), chunk1);
+  gather = _mm_blendv_epi8(gather, _mm_shuffle_epi8(nibbles[2], index), chunk2);
+  return gather;
+}
+
+// convert IPv6 from text to binary form.
+//
+// the function reads 48 bytes starting at text and classifies each byte as
+// hexadecimal digit or colon to find the groups, "::" and the end of the
+// address. nibbles are gathered into place and combined to form the address.
+// embedded IPv4 addresses are converted by sse_inet_aton.
+//
+// returns the length of the address on success. only well-formed input is
+// handled, zero is returned for anything else (i.e., errors, leading zeroes
+// that exceed four digits, a single trailing colon, "::" replacing zero
+// groups) and the caller must fall back to the scalar implementation, which
+// remains authoritative.
+static inline int32_t sse_inet_pton6(const char *text, uint8_t *wire)
+{
+  __m128i nibbles[3];
+  uint64_t hex = 0, colons = 0;
+
+  for (uint32_t i=0; i < 3; i++) {
+    const __m128i input = _mm_loadu_si128((const __m128i *)(text + i*16));
+    // digits map to 0-9, letters (either case) map to 0-5
+    const __m128i digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+    const __m128i letters = _mm_sub_epi8(
+      _mm_or_si128(input, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_digit =
+      _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    const __m128i is_letter =
+      _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+    const __m128i is_colon = _mm_cmpeq_epi8(input, _mm_set1_epi8(':'));
+    nibbles[i] = _mm_blendv_epi8(
+      _mm_add_epi8(letters, _mm_set1_epi8(10)), digits, is_digit);
+    hex |= (uint64_t)_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) << (i*16);
+    colons |= (uint64_t)_mm_movemask_epi8(is_colon) << (i*16);
+  }
+
+  // upper bits are clear, length cannot exceed 48
+  const uint64_t length = trailing_zeroes(~(hex | colons));
+  if (length == 0 || length == 48)
+    return 0;
+  const uint64_t mask = (1llu << length) - 1;
+  hex &= mask;
+  colons &= mask;
+
+  // reject groups of five or more digits and runs of three or more colons
+  if ((hex & (hex >> 1) & (hex >> 2) & (hex >> 3) & (hex >> 4)) ||
+      (colons & (colons >> 1) & (colons >> 2)))
+    return 0;
+
+  const uint64_t double_colon = colons & (colons >> 1);
+  const uint64_t single_colons = colons & ~(double_colon | (double_colon << 1));
+  // single colons must separate groups, one "::" at most
+  if (count_ones(double_colon) > 1 ||
+      (single_colons & ((1llu << (length - 1)) | 1llu)))
+    return 0;
+
+  uint64_t starts = hex & ~(hex << 1);
+  uint64_t ends = hex & ~(hex >> 1);
+  uint64_t groups = count_ones(starts);
+  uint64_t slots = 8;
+  int32_t count = (int32_t)length;
+  uint8_t ip4[4];
+
+  if (text[length] == '.') {
+    size_t ip4_length;
+    // first octet of the embedded IPv4 address is the last group
+    if (!(ends & (1llu << (length - 1))))
+      return 0;
+    const uint64_t start = 63 - leading_zeroes(starts);
+    if (sse_inet_aton(text + start, ip4, &ip4_length) != 1)
+      return 0;
+    count = (int32_t)(start + ip4_length);
+    starts &= ~(1llu << start);
+    ends &= ~(1llu << (length - 1));
+    groups--;
+    slots = 6;
+  }
+
+  // "::" must replace at least one group
+  if (double_colon ? groups >= slots : groups != slots)
+    return 0;
+
+  // number of groups before "::", if any
+  const uint64_t head = count_ones(starts & (double_colon - 1));
+  const uint64_t skip = double_colon ? slots - groups : 0;
+  uint32_t index[8] = {
+    0x80808080, 0x80808080, 0x80808080, 0x80808080,
+    0x80808080, 0x80808080, 0x80808080, 0x80808080 };
+
+  for (uint64_t group = 0; group < groups; group++) {
+    const uint64_t start = trailing_zeroes(starts);
+    const uint64_t end = trailing_zeroes(ends);
+    const uint64_t slot = group < head ? group : group + skip;
+    index[slot] = ip6_group_patterns[(end - start) + 1] + (uint32_t)start * 0x01010101u;
+    starts = clear_lowest_bit(starts);
+    ends = clear_lowest_bit(ends);
+  }
+
+  // combine nibbles into octets and pack
+  const __m128i weights = _mm_set1_epi16(0x0110);
+  const __m128i lo = _mm_maddubs_epi16(
+    ip6_gather_sse(nibbles, _mm_loadu_si128((const __m128i *)&index[0])), weights);
+  const __m128i hi = _mm_maddubs_epi16(
+    ip6_gather_sse(nibbles, _mm_loadu_si128((const __m128i *)&index[4])), weights);
+  _mm_storeu_si128((__m128i *)wire, _mm_packus_epi16(lo, hi));
+  if (slots == 6)
+    memcpy(wire + 12, ip4, sizeof(ip4));
+  return count;
+}
+
+#define SCAN_IP6 sse_inet_pton6
+
+#endif // IP6_SSE_H
@@ -0,0 +1,52 @@
+/*
+ * number.h -- SSE4.1 integer parsing routines
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef NUMBER_SSE_H
+#define NUMBER_SSE_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+// sliding window of shuffle indexes to right-align up to 16 digits
+static const int8_t digits_shuffle[32] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15
+};
+
+// convert 1 to 16 decimal digits in a single pass. the input buffer is
+// padded, reading 16 bytes is safe. returns 1 if all characters are digits
+static really_inline int32_t scan_digits_sse(
+  const char *data, size_t length, uint64_t *number)
+{
+  const __m128i input = _mm_loadu_si128((const __m128i *)data);
+  const __m128i digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+  const __m128i is_digit =
+    _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  const uint32_t non_digits = (uint16_t)~_mm_movemask_epi8(is_digit);
+
+  if (non_digits & ((1u << length) - 1))
+    return 0;
+
+  // shift digits to the end of the vector, leading bytes are zeroed
+  const __m128i shuffle =
+    _mm_loadu_si128((const __m128i *)&digits_shuffle[length]);
+  const __m128i aligned = _mm_shuffle_epi8(digits, shuffle);
+  // combine 2 digits, then 4 digits, then 8 digits
+  const __m128i by2 = _mm_maddubs_epi16(aligned, _mm_set1_epi16(0x010a));
+  const __m128i by4 = _mm_madd_epi16(by2, _mm_set1_epi32(0x00010064));
+  const __m128i by8 = _mm_madd_epi16(
+    _mm_packus_epi32(by4, by4), _mm_set1_epi32(0x00012710));
+  const uint64_t halves = (uint64_t)_mm_cvtsi128_si64(by8);
+
+  *number = (halves & 0xffffffffu) * 100000000u + (halves >> 32);
+  return 1;
+}
+
+#define SCAN_DIGITS scan_digits_sse
+
+#endif // NUMBER_SSE_H
@@ -14,13 +14,19 @@
 #include "westmere/bits.h"
 #include "generic/parser.h"
 #include "generic/scanner.h"
+#include "generic/indexer.h"
+#include "westmere/number.h"
 #include "generic/number.h"
+#include "westmere/ttl.h"
 #include "generic/ttl.h"
 #include "westmere/time.h"
 #include "westmere/ip4.h"
+#include "westmere/ip6.h"
 #include "generic/ip6.h"
+#include "westmere/text.h"
 #include "generic/text.h"
 #include "generic/name.h"
+#include "westmere/base16.h"
 #include "generic/base16.h"
 #include "westmere/base32.h"
 #include "generic/base64.h"
@@ -0,0 +1,390 @@
+/*
+ * text.h -- SSE4.1 decoder for escape sequences in strings and names
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef TEXT_SSE_H
+#define TEXT_SSE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+// shuffle indexes to compress 8 bytes, i.e. move bytes for which the bit
+// is set in the index to the front
+static const uint8_t unescape_compress[256][8] = {
+  {128, 128, 128, 128, 128, 128, 128, 128},
+  {0, 128, 128, 128, 128, 128, 128, 128},
+  {1, 128, 128, 128, 128, 128, 128, 128},
+  {0, 1, 128, 128, 128, 128, 128, 128},
+  {2, 128, 128, 128, 128, 128, 128, 128},
+  {0, 2, 128, 128, 128, 128, 128, 128},
+  {1, 2, 128, 128, 128, 128, 128, 128},
+  {0, 1, 2, 128, 128, 128, 128, 128},
+  {3, 128, 128, 128, 128, 128, 128, 128},
+  {0, 3, 128, 128, 128, 128, 128, 128},
+  {1, 3, 128, 128, 128, 128, 128, 128},
+  {0, 1, 3, 128, 128, 128, 128, 128},
+  {2, 3, 128, 128, 128, 128, 128, 128},
+  {0, 2, 3, 128, 128, 128, 128, 128},
+  {1, 2, 3, 128, 128, 128, 128, 128},
+  {0, 1, 2, 3, 128, 128, 128, 128},
+  {4, 128, 128, 128, 128, 128, 128, 128},
+  {0, 4, 128, 128, 128, 128, 128, 128},
+  {1, 4, 128, 128, 128, 128, 128, 128},
+  {0, 1, 4, 128, 128, 128, 128, 128},
+  {2, 4, 128, 128, 128, 128, 128, 128},
+  {0, 2, 4, 128, 128, 128, 128, 128},
+  {1, 2, 4, 128, 128, 128, 128, 128},
+  {0, 1, 2, 4, 128, 128, 128, 128},
+  {3, 4, 128, 128, 128, 128, 128, 128},
+  {0, 3, 4, 128, 128, 128, 128, 128},
+  {1, 3, 4, 128, 128, 128, 128, 128},
+  {0, 1, 3, 4, 128, 128, 128, 128},
+  {2, 3, 4, 128, 128, 128, 128, 128},
+  {0, 2, 3, 4, 128, 128, 128, 128},
+  {1, 2, 3, 4, 128, 128, 128, 128},
+  {0, 1, 2, 3, 4, 128, 128, 128},
+  {5, 128, 128, 128, 128, 128, 128, 128},
+  {0, 5, 128, 128, 128, 128, 128, 128},
+  {1, 5, 128, 128, 128, 128, 128, 128},
+  {0, 1, 5, 128, 128, 128, 128, 128},
+  {2, 5, 128, 128, 128, 128, 128, 128},
+  {0, 2, 5, 128, 128, 128, 128, 128},
+  {1, 2, 5, 128, 128, 128, 128, 128},
+  {0, 1, 2, 5, 128, 128, 128, 128},
+  {3, 5, 128, 128, 128, 128, 128, 128},
+  {0, 3, 5, 128, 128, 128, 128, 128},
+  {1, 3, 5, 128, 128, 128, 128, 128},
+  {0, 1, 3, 5, 128, 128, 128, 128},
+  {2, 3, 5, 128, 128, 128, 128, 128},
+  {0, 2, 3, 5, 128, 128, 128, 128},
+  {1, 2, 3, 5, 128, 128, 128, 128},
+  {0, 1, 2, 3, 5, 128, 128, 128},
+  {4, 5, 128, 128, 128, 128, 128, 128},
+  {0, 4, 5, 128, 128, 128, 128, 128},
+  {1, 4, 5, 128, 128, 128, 128, 128},
+  {0, 1, 4, 5, 128, 128, 128, 128},
+  {2, 4, 5, 128, 128, 128, 128, 128},
+  {0, 2, 4, 5, 128, 128, 128, 128},
+  {1, 2, 4, 5, 128, 128, 128, 128},
+  {0, 1, 2, 4, 5, 128, 128, 128},
+  {3, 4, 5, 128, 128, 128, 128, 128},
+  {0, 3, 4, 5, 128, 128, 128, 128},
+  {1, 3, 4, 5, 128, 128, 128, 128},
+  {0, 1, 3, 4, 5, 128, 128, 128},
+  {2, 3, 4, 5, 128, 128, 128, 128},
+  {0, 2, 3, 4, 5, 128, 128, 128},
+  {1, 2, 3, 4, 5, 128, 128, 128},
+  {0, 1, 2, 3, 4, 5, 128, 128},
+  {6, 128, 128, 128, 128, 128, 128, 128},
+  {0, 6, 128, 128, 128, 128, 128, 128},
+  {1, 6, 128, 128, 128, 128, 128, 128},
+  {0, 1, 6, 128, 128, 128, 128, 128},
+  {2, 6, 128, 128, 128, 128, 128, 128},
+  {0, 2, 6, 128, 128, 128, 128, 128},
+  {1, 2, 6, 128, 128, 128, 128, 128},
+  {0, 1, 2, 6, 128, 128, 128, 128},
+  {3, 6, 128, 128, 128, 128, 128, 128},
+  {0, 3, 6, 128, 128, 128, 128, 128},
+  {1, 3, 6, 128, 128, 128, 128, 128},
+  {0, 1, 3, 6, 128, 128, 128, 128},
+  {2, 3, 6, 128, 128, 128, 128, 128},
+  {0, 2, 3, 6, 128, 128, 128, 128},
+  {1, 2, 3, 6, 128, 128, 128, 128},
+  {0, 1, 2, 3, 6, 128, 128, 128},
+  {4, 6, 128, 128, 128, 128, 128, 128},
+  {0, 4, 6, 128, 128, 128, 128, 128},
+  {1, 4, 6, 128, 128, 128, 128, 128},
+  {0, 1, 4, 6, 128, 128, 128, 128},
+  {2, 4, 6, 128, 128, 128, 128, 128},
+  {0, 2, 4, 6, 128, 128, 128, 128},
+  {1, 2, 4, 6, 128, 128, 128, 128},
+  {0, 1, 2, 4, 6, 128, 128, 128},
+  {3, 4, 6, 128, 128, 128, 128, 128},
+  {0, 3, 4, 6, 128, 128, 128, 128},
+  {1, 3, 4, 6, 128, 128, 128, 128},
+  {0, 1, 3, 4, 6, 128, 128, 128},
+  {2, 3, 4, 6, 128, 128, 128, 128},
+  {0, 2, 3, 4, 6, 128, 128, 128},
+  {1, 2, 3, 4, 6, 128, 128, 128},
+  {0, 1, 2, 3, 4, 6, 128, 128},
+  {5, 6, 128, 128, 128, 128, 128, 128},
+  {0, 5, 6, 128, 128, 128, 128, 128},
+  {1, 5, 6, 128, 128, 128, 128, 128},
+  {0, 1, 5, 6, 128, 128, 128, 128},
+  {2, 5, 6, 128, 128, 128, 128, 128},
+  {0, 2, 5, 6, 128, 128, 128, 128},
+  {1, 2, 5, 6, 128, 128, 128, 128},
+  {0, 1, 2, 5, 6, 128, 128, 128},
+  {3, 5, 6, 128, 128, 128, 128, 128},
+  {0, 3, 5, 6, 128, 128, 128, 128},
+  {1, 3, 5, 6, 128, 128, 128, 128},
+  {0, 1, 3, 5, 6, 128, 128, 128},
+  {2, 3, 5, 6, 128, 128, 128, 128},
+  {0, 2, 3, 5, 6, 128, 128, 128},
+  {1, 2, 3, 5, 6, 128, 128, 128},
+  {0, 1, 2, 3, 5, 6, 128, 128},
+  {4, 5, 6, 128, 128, 128, 128, 128},
+  {0, 4, 5, 6, 128, 128, 128, 128},
+  {1, 4, 5, 6, 128, 128, 128, 128},
+  {0, 1, 4, 5, 6, 128, 128, 128},
+  {2, 4, 5, 6, 128, 128, 128, 128},
+  {0, 2, 4, 5, 6, 128, 128, 128},
+  {1, 2, 4, 5, 6, 128, 128, 128},
+  {0, 1, 2, 4, 5, 6, 128, 128},
+  {3, 4, 5, 6, 128, 128, 128, 128},
+  {0, 3, 4, 5, 6, 128, 128, 128},
+  {1, 3, 4, 5, 6, 128, 128, 128},
+  {0, 1, 3, 4, 5, 6, 128, 128},
+  {2, 3, 4, 5, 6, 128, 128, 128},
+  {0, 2, 3, 4, 5, 6, 128, 128},
+  {1, 2, 3, 4, 5, 6, 128, 128},
+  {0, 1, 2, 3, 4, 5, 6, 128},
+  {7, 128, 128, 128, 128, 128, 128, 128},
+  {0, 7, 128, 128, 128, 128, 128, 128},
+  {1, 7, 128, 128, 128, 128, 128, 128},
+  {0, 1, 7, 128, 128, 128, 128, 128},
+  {2, 7, 128, 128, 128, 128, 128, 128},
+  {0, 2, 7, 128, 128, 128, 128, 128},
+  {1, 2, 7, 128, 128, 128, 128, 128},
+  {0, 1, 2, 7, 128, 128, 128, 128},
+  {3, 7, 128, 128, 128, 128, 128, 128},
+  {0, 3, 7, 128, 128, 128, 128, 128},
+  {1, 3, 7, 128, 128, 128, 128, 128},
+  {0, 1, 3, 7, 128, 128, 128, 128},
+  {2, 3, 7, 128, 128, 128, 128, 128},
+  {0, 2, 3, 7, 128, 128, 128, 128},
+  {1, 2, 3, 7, 128, 128, 128, 128},
+  {0, 1, 2, 3, 7, 128, 128, 128},
+  {4, 7, 128, 128, 128, 128, 128, 128},
+  {0, 4, 7, 128, 128, 128, 128, 128},
+  {1, 4, 7, 128, 128, 128, 128, 128},
+  {0, 1, 4, 7, 128, 128, 128, 128},
+  {2, 4, 7, 128, 128, 128, 128, 128},
+  {0, 2, 4, 7, 128, 128, 128, 128},
+  {1, 2, 4, 7, 128, 128, 128, 128},
+  {0, 1, 2, 4, 7, 128, 128, 128},
+  {3, 4, 7, 128, 128, 128, 128, 128},
+  {0, 3, 4, 7, 128, 128, 128, 128},
+  {1, 3, 4, 7, 128, 128, 128, 128},
+  {0, 1, 3, 4, 7, 128, 128, 128},
+  {2, 3, 4, 7, 128, 128, 128, 128},
+  {0, 2, 3, 4, 7, 128, 128, 128},
+  {1, 2, 3, 4, 7, 128, 128, 128},
+  {0, 1, 2, 3, 4, 7, 128, 128},
+  {5, 7, 128, 128, 128, 128, 128, 128},
+  {0, 5, 7, 128, 128, 128, 128, 128},
+  {1, 5, 7, 128, 128, 128, 128, 128},
+  {0, 1, 5, 7, 128, 128, 128, 128},
+  {2, 5, 7, 128, 128, 128, 128, 128},
+  {0, 2, 5, 7, 128, 128, 128, 128},
+  {1, 2, 5, 7, 128, 128, 128, 128},
+  {0, 1, 2, 5, 7, 128, 128, 128},
+  {3, 5, 7, 128, 128, 128, 128, 128},
+  {0, 3, 5, 7, 128, 128, 128, 128},
+  {1, 3, 5, 7, 128, 128, 128, 128},
+  {0, 1, 3, 5, 7, 128, 128, 128},
+  {2, 3, 5, 7, 128, 128, 128, 128},
+  {0, 2, 3, 5, 7, 128, 128, 128},
+  {1, 2, 3, 5, 7, 128, 128, 128},
+  {0, 1, 2, 3, 5, 7, 128, 128},
+  {4, 5, 7, 128, 128, 128, 128, 128},
+  {0, 4, 5, 7, 128, 128, 128, 128},
+  {1, 4, 5, 7, 128, 128, 128, 128},
+  {0, 1, 4, 5, 7, 128, 128, 128},
+  {2, 4, 5, 7, 128, 128, 128, 128},
+  {0, 2, 4, 5, 7, 128, 128, 128},
+  {1, 2, 4, 5, 7, 128, 128, 128},
+  {0, 1, 2, 4, 5, 7, 128, 128},
+  {3, 4, 5, 7, 128, 128, 128, 128},
+  {0, 3, 4, 5, 7, 128, 128, 128},
+  {1, 3, 4, 5, 7, 128, 128, 128},
+  {0, 1, 3, 4, 5, 7, 128, 128},
+  {2, 3, 4, 5, 7, 128, 128, 128},
+  {0, 2, 3, 4, 5, 7, 128, 128},
+  {1, 2, 3, 4, 5, 7, 128, 128},
+  {0, 1, 2, 3, 4, 5, 7, 128},
+  {6, 7, 128, 128, 128, 128, 128, 128},
+  {0, 6, 7, 128, 128, 128, 128, 128},
+  {1, 6, 7, 128, 128, 128, 128, 128},
+  {0, 1, 6, 7, 128, 128, 128, 128},
+  {2, 6, 7, 128, 128, 128, 128, 128},
+  {0, 2, 6, 7, 128, 128, 128, 128},
+  {1, 2, 6, 7, 128, 128, 128, 128},
+  {0, 1, 2, 6, 7, 128, 128, 128},
+  {3, 6, 7, 128, 128, 128, 128, 128},
+  {0, 3, 6, 7, 128, 128, 128, 128},
+  {1, 3, 6, 7, 128, 128, 128, 128},
+  {0, 1, 3, 6, 7, 128, 128, 128},
+  {2, 3, 6, 7, 128, 128, 128, 128},
+  {0, 2, 3, 6, 7, 128, 128, 128},
+  {1, 2, 3, 6, 7, 128, 128, 128},
+  {0, 1, 2, 3, 6, 7, 128, 128},
+  {4, 6, 7, 128, 128, 128, 128, 128},
+  {0, 4, 6, 7, 128, 128, 128, 128},
+  {1, 4, 6, 7, 128, 128, 128, 128},
+  {0, 1, 4, 6, 7, 128, 128, 128},
+  {2, 4, 6, 7, 128, 128, 128, 128},
+  {0, 2, 4, 6, 7, 128, 128, 128},
+  {1, 2, 4, 6, 7, 128, 128, 128},
+  {0, 1, 2, 4, 6, 7, 128, 128},
+  {3, 4, 6, 7, 128, 128, 128, 128},
+  {0, 3, 4, 6, 7, 128, 128, 128},
+  {1, 3, 4, 6, 7, 128, 128, 128},
+  {0, 1, 3, 4, 6, 7, 128, 128},
+  {2, 3, 4, 6, 7, 128, 128, 128},
+  {0, 2, 3, 4, 6, 7, 128, 128},
+  {1, 2, 3, 4, 6, 7, 128, 128},
+  {0, 1, 2, 3, 4, 6, 7, 128},
+  {5, 6, 7, 128, 128, 128, 128, 128},
+  {0, 5, 6, 7, 128, 128, 128, 128},
+  {1, 5, 6, 7, 128, 128, 128, 128},
+  {0, 1, 5, 6, 7, 128, 128, 128},
+  {2, 5, 6, 7, 128, 128, 128, 128},
+  {0, 2, 5, 6, 7, 128, 128, 128},
+  {1, 2, 5, 6, 7, 128, 128, 128},
+  {0, 1, 2, 5, 6, 7, 128, 128},
+  {3, 5, 6, 7, 128, 128, 128, 128},
+  {0, 3, 5, 6, 7, 128, 128, 128},
+  {1, 3, 5, 6, 7, 128, 128, 128},
+  {0, 1, 3, 5, 6, 7, 128, 128},
+  {2, 3, 5, 6, 7, 128, 128, 128},
+  {0, 2, 3, 5, 6, 7, 128, 128},
+  {1, 2, 3, 5, 6, 7, 128, 128},
+  {0, 1, 2, 3, 5, 6, 7, 128},
+  {4, 5, 6, 7, 128, 128, 128, 128},
+  {0, 4, 5, 6, 7, 128, 128, 128},
+  {1, 4, 5, 6, 7, 128, 128, 128},
+  {0, 1, 4, 5, 6, 7, 128, 128},
+  {2, 4, 5, 6, 7, 128, 128, 128},
+  {0, 2, 4, 5, 6, 7, 128, 128},
+  {1, 2, 4, 5, 6, 7, 128, 128},
+  {0, 1, 2, 4, 5, 6, 7, 128},
+  {3, 4, 5, 6, 7, 128, 128, 128},
+  {0, 3, 4, 5, 6, 7, 128, 128},
+  {1, 3, 4, 5, 6, 7, 128, 128},
+  {0, 1, 3, 4, 5, 6, 7, 128},
+  {2, 3, 4, 5, 6, 7, 128, 128},
+  {0, 2, 3, 4, 5, 6, 7, 128},
+  {1, 2, 3, 4, 5, 6, 7, 128},
+  {0, 1, 2, 3, 4, 5, 6, 7}
+};
+
+// (x * 100) % 256 and x * 10 for decimal digits
+static const int8_t unescape_hundreds[16] = {
+  0, 100, -56, 44, -112, -12, 88, -68, 32, -124, 0, 0, 0, 0, 0, 0
+};
+
+static const int8_t unescape_tens[16] = {
+  0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 0, 0, 0, 0, 0, 0
+};
+
+// expand 16-bit mask to 16 bytes, 0xff for each bit that is set
+static really_inline __m128i unescape_expand_mask(uint32_t mask)
+{
+  const __m128i bits = _mm_set_epi8(
+    -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+  const __m128i spread = _mm_shuffle_epi8(
+    _mm_cvtsi32_si128((int32_t)mask),
+    _mm_set_epi8(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0));
+  return _mm_cmpeq_epi8(_mm_and_si128(spread, bits), bits);
+}
+
+// decode all escape sequences in (up to) 16 characters in one pass. input
+// and output buffers are padded, reading and writing 16 bytes is safe.
+// escape sequences that extend beyond the window are left for the next
+// window. returns the number of octets written and stores the number of
+// characters consumed and the mask of unescaped dots in the output (for
+// domain names). returns zero if the window starts with an escape sequence
+// that is cut short, the caller must fall back to unescape, and -1 if an
+// escape sequence is invalid
+static really_inline int32_t unescape_block_sse(
+  const char *text, uint64_t length, uint8_t *wire, uint64_t *consumed, uint64_t *dots)
+{
+  const __m128i input = _mm_loadu_si128((const __m128i *)text);
+  const __m128i digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+  const __m128i is_digit =
+    _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  uint64_t count = length < 16 ? length : 16;
+  const uint64_t backslash = (uint32_t)_mm_movemask_epi8(
+    _mm_cmpeq_epi8(input, _mm_set1_epi8('\\'))) & ((1llu << count) - 1);
+  const uint64_t digit = (uint32_t)_mm_movemask_epi8(is_digit);
+  const uint64_t dot = (uint32_t)_mm_movemask_epi8(
+    _mm_cmpeq_epi8(input, _mm_set1_epi8('.')));
+
+  // find escaped characters, backslashes in a sequence escape each other.
+  // see simdjson find_escaped_branchless
+  const uint64_t even_bits = 0x5555555555555555llu;
+  const uint64_t follows_escape = backslash << 1;
+  const uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+  const uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+  const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  const uint64_t escaped = (even_bits ^ invert_mask) & follows_escape;
+  const uint64_t escapes = backslash & ~escaped;
+  const uint64_t decimals = escapes & (digit >> 1);
+  const uint64_t window = (1llu << count) - 1;
+
+  // digits in decimal escape sequences, values must not exceed 255
+  const __m128i hundreds = _mm_slli_si128(digits, 2);
+  const __m128i tens = _mm_shuffle_epi8(
+    _mm_loadu_si128((const __m128i *)unescape_tens), _mm_slli_si128(digits, 1));
+  const __m128i lower = _mm_add_epi8(tens, digits);
+  const __m128i overflow = _mm_or_si128(
+    _mm_cmpgt_epi8(hundreds, _mm_set1_epi8(2)),
+    _mm_and_si128(_mm_cmpeq_epi8(hundreds, _mm_set1_epi8(2)),
+                  _mm_cmpgt_epi8(lower, _mm_set1_epi8(55))));
+  // positions of last digits, i.e. where the octet is written
+  const uint64_t invalid =
+    ~(digit & (digit << 1)) | (uint32_t)_mm_movemask_epi8(overflow);
+  if (invalid & (decimals << 3) & window)
+    return -1;
+
+  // escape sequences end at the escaped character, or the last digit.
+  // stop at the first sequence that extends beyond the window
+  const uint64_t cut =
+    (escapes & ~decimals & ~(window >> 1)) | (decimals & ~(window >> 3));
+  if (cut) {
+    count = trailing_zeroes(cut);
+    if (!count)
+      return 0;
+  }
+
+  const uint64_t mask = (1llu << count) - 1;
+  const uint64_t replace = (decimals << 3) & mask;
+
+  const __m128i octets = _mm_add_epi8(lower, _mm_shuffle_epi8(
+    _mm_loadu_si128((const __m128i *)unescape_hundreds), hundreds));
+  const __m128i output =
+    _mm_blendv_epi8(input, octets, unescape_expand_mask((uint32_t)replace));
+  const __m128i unescaped_dots =
+    unescape_expand_mask((uint32_t)(dot & ~escaped & mask));
+
+  // drop backslashes and leading digits of decimal escape sequences
+  const uint64_t keep = ~(escapes | (decimals << 1) | (decimals << 2)) & mask;
+  const uint64_t keep_lo = keep & 0xff, keep_hi = keep >> 8;
+  uint64_t index_lo, index_hi;
+  memcpy(&index_lo, unescape_compress[keep_lo], sizeof(index_lo));
+  memcpy(&index_hi, unescape_compress[keep_hi], sizeof(index_hi));
+  const __m128i compress = _mm_add_epi8(
+    _mm_set_epi64x((long long)index_hi, (long long)index_lo),
+    _mm_set_epi8(8, 8, 8, 8, 8, 8, 8, 8, 0, 0, 0, 0, 0, 0, 0, 0));
+  const __m128i compressed = _mm_shuffle_epi8(output, compress);
+  const uint64_t lo = count_ones(keep_lo);
+  const uint64_t compressed_dots =
+    (uint32_t)_mm_movemask_epi8(_mm_shuffle_epi8(unescaped_dots, compress));
+
+  _mm_storel_epi64((__m128i *)wire, compressed);
+  _mm_storel_epi64((__m128i *)(wire + lo), _mm_unpackhi_epi64(compressed, compressed));
+  *consumed = count;
+  *dots = ((compressed_dots & 0xff) | ((compressed_dots >> 8) << lo)) &
+          ((1llu << count_ones(keep)) - 1);
+  return (int32_t)count_ones(keep);
+}
+
+#define UNESCAPE_BLOCK unescape_block_sse
+
+#endif // TEXT_SSE_H
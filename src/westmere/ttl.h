@@ -0,0 +1,123 @@
+/*
+ * ttl.h -- SSE4.1 Time to Live (TTL) parser for values with units
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef TTL_SSE_H
+#define TTL_SSE_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+// units are identified by the lower nibble of the lower case letter, which
+// is unique for [dhmsw]. ranks order units from smallest to greatest
+static const int8_t ttl_unit_letters[16] = {
+  -1, -1, -1, 's', 'd', -1, -1, 'w', 'h', -1, -1, -1, -1, 'm', -1, -1
+};
+
+static const int8_t ttl_unit_ranks[16] = {
+  0, 0, 0, 1, 4, 0, 0, 5, 3, 0, 0, 0, 0, 2, 0, 0
+};
+
+static const uint32_t ttl_unit_seconds[6] = {
+  0, 1, 60, 60*60, 24*60*60, 7*24*60*60
+};
+
+// nibble patterns to right-align numbers of up to four digits
+static const uint32_t ttl_number_patterns[5] = {
+  0x80808080, 0x00808080, 0x01008080, 0x02010080, 0x03020100
+};
+
+// convert TTL with units, e.g. 1h30m, from text to binary form. digits
+// and units are classified in one pass, numbers of up to four digits are
+// gathered into place and converted at once. returns 1 on success, zero
+// is returned for anything else (i.e., errors, longer numbers) and the
+// caller must fall back to the scalar implementation
+static really_inline int32_t scan_ttl_sse(
+  const char *data, size_t length, uint32_t *ttl)
+{
+  if (length > 16)
+    return 0;
+
+  const __m128i input = _mm_loadu_si128((const __m128i *)data);
+  const __m128i digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+  const __m128i is_digit =
+    _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  const __m128i lower = _mm_or_si128(input, _mm_set1_epi8(0x20));
+  const __m128i letters = _mm_loadu_si128((const __m128i *)ttl_unit_letters);
+  const __m128i is_unit =
+    _mm_cmpeq_epi8(_mm_shuffle_epi8(letters, lower), lower);
+  const __m128i ranks = _mm_and_si128(is_unit, _mm_shuffle_epi8(
+    _mm_loadu_si128((const __m128i *)ttl_unit_ranks), lower));
+
+  const uint32_t mask = (uint32_t)((1llu << length) - 1);
+  const uint32_t numbers = (uint32_t)_mm_movemask_epi8(is_digit) & mask;
+  uint32_t units = (uint32_t)_mm_movemask_epi8(is_unit) & mask;
+
+  // ttls must start with a number and units must be followed by a number
+  if ((numbers | units) != mask || !(numbers & 1) || !units ||
+      (units & (units >> 1)) ||
+      (numbers & (numbers >> 1) & (numbers >> 2) & (numbers >> 3) & (numbers >> 4)))
+    return 0;
+
+  uint32_t starts = numbers & ~(numbers << 1);
+  uint32_t ends = numbers & ~(numbers >> 1);
+  // units are distinct, but that is checked later. four numbers suffice
+  const uint32_t count = (uint32_t)count_ones(starts);
+  if (count > 4)
+    return 0;
+
+  // shift indexes in from the top to avoid store forwarding stalls, the
+  // last number ends up in the last lane, unused lanes are ignored
+  __m128i index = _mm_setzero_si128();
+  for (uint32_t i = 0; i < count; i++) {
+    const uint32_t start = (uint32_t)trailing_zeroes(starts);
+    const uint32_t end = (uint32_t)trailing_zeroes(ends);
+    const uint32_t pattern =
+      ttl_number_patterns[(end - start) + 1] + start * 0x01010101u;
+    index = _mm_or_si128(_mm_srli_si128(index, 4),
+      _mm_slli_si128(_mm_cvtsi32_si128((int32_t)pattern), 12));
+    starts = (uint32_t)clear_lowest_bit(starts);
+    ends = (uint32_t)clear_lowest_bit(ends);
+  }
+
+  // combine 2 digits, then 4 digits
+  uint32_t values[4];
+  _mm_storeu_si128((__m128i *)values, _mm_madd_epi16(_mm_maddubs_epi16(
+    _mm_shuffle_epi8(digits, index), _mm_set1_epi16(0x010a)),
+    _mm_set1_epi32(0x00010064)));
+
+  uint8_t rank[16];
+  _mm_storeu_si128((__m128i *)rank, ranks);
+
+  uint64_t sum = 0;
+  uint32_t last_rank = 6, i = 4 - count;
+  for (; units; i++) {
+    const uint32_t unit = rank[trailing_zeroes(units)];
+    // greater units must precede smaller units and must not be repeated
+    if (unit >= last_rank)
+      return 0;
+    sum += (uint64_t)values[i] * ttl_unit_seconds[unit];
+    last_rank = unit;
+    units = (uint32_t)clear_lowest_bit(units);
+  }
+
+  // trailing number, must not follow seconds
+  if (i < 4) {
+    if (last_rank == 1)
+      return 0;
+    sum += values[i];
+  }
+
+  if (sum > UINT32_MAX)
+    return 0;
+  *ttl = (uint32_t)sum;
+  return 1;
+}
+
+#define SCAN_TTL scan_ttl_sse
+
+#endif // TTL_SSE_H
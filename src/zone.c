@@ -6,6 +6,10 @@
  * SPDX-License-Identifier: BSD-3-Clause
  *
  */
+#if __linux__
+// memfd_create is a GNU extension
+#  define _GNU_SOURCE 1
+#endif
 #include "config.h"
 
 #include <assert.h>
@@ -22,14 +26,23 @@
 #else
 #  include <unistd.h>
 #endif
+#if HAVE_MMAP || HAVE_MEMFD_CREATE
+#  include <sys/mman.h>
+#  if !defined MAP_ANONYMOUS && defined MAP_ANON
+#    define MAP_ANONYMOUS MAP_ANON
+#  endif
+#endif
+#if HAVE_IO_URING
+#  include <liburing.h>
+#endif
+#if HAVE_PTHREAD
+#  include <pthread.h>
+#endif
 
 #include "zone.h"
-
-typedef zone_parser_t parser_t; // convenience
-typedef zone_file_t file_t;
-
 #include "attributes.h"
 #include "diagnostic.h"
+#include "internal.h"
 
 #if _MSC_VER
 # define strcasecmp(s1, s2) _stricmp(s1, s2)
@@ -39,6 +52,9 @@ typedef zone_file_t file_t;
 #endif
 
 static const char not_a_file[] = "<string>";
+// terminates tapes of input that is not null-terminated. tokens are read a
+// block at a time, the sentinel is padded like input
+static const char not_a_token[ZONE_BLOCK_SIZE] = { '\0' };
 
 #include "isadetection.h"
 
@@ -46,6 +62,10 @@ static const char not_a_file[] = "<string>";
 #define PATH_MAX 4096
 #endif
 
+#if HAVE_ICELAKE
+extern int32_t zone_icelake_parse(parser_t *);
+#endif
+
 #if HAVE_HASWELL
 extern int32_t zone_haswell_parse(parser_t *);
 #endif
@@ -54,21 +74,31 @@ extern int32_t zone_haswell_parse(parser_t *);
 extern int32_t zone_westmere_parse(parser_t *);
 #endif
 
-extern int32_t zone_fallback_parse(parser_t *);
+#if HAVE_NEON
+extern int32_t zone_neon_parse(parser_t *);
+#endif
 
-typedef struct kernel kernel_t;
-struct kernel {
-  const char *name;
-  uint32_t instruction_set;
-  int32_t (*parse)(parser_t *);
-};
+#if HAVE_VECTOR
+extern int32_t zone_vector_parse(parser_t *);
+#endif
+
+extern int32_t zone_fallback_parse(parser_t *);
 
 static const kernel_t kernels[] = {
+#if HAVE_ICELAKE
+  { "icelake", AVX512F|AVX512BW|AVX512VL|AVX512VBMI2, &zone_icelake_parse },
+#endif
 #if HAVE_HASWELL
   { "haswell", AVX2, &zone_haswell_parse },
 #endif
 #if HAVE_WESTMERE
   { "westmere", SSE42|PCLMULQDQ, &zone_westmere_parse },
+#endif
+#if HAVE_NEON
+  { "neon", NEON, &zone_neon_parse },
+#endif
+#if HAVE_VECTOR
+  { "vector", DEFAULT, &zone_vector_parse },
 #endif
   { "fallback", DEFAULT, &zone_fallback_parse }
 };
@@ -76,8 +106,7 @@ static const kernel_t kernels[] = {
 diagnostic_push()
 msvc_diagnostic_ignored(4996)
 
-static inline const kernel_t *
-select_kernel(void)
+const kernel_t *zone_select_kernel(void)
 {
   const char *preferred;
   const uint32_t supported = detect_supported_architectures();
@@ -101,11 +130,11 @@ select_kernel(void)
 
 diagnostic_pop()
 
-static int32_t parse(parser_t *parser, void *user_data)
+int32_t zone_parse_file(parser_t *parser, void *user_data)
 {
   const kernel_t *kernel;
 
-  kernel = select_kernel();
+  kernel = zone_select_kernel();
   assert(kernel);
   parser->user_data = user_data;
   return kernel->parse(parser);
@@ -121,7 +150,7 @@ msvc_diagnostic_ignored(4996)
 // Rooted paths, relative or not, unc and extended paths are never resolved
 // relative to the includer.
 nonnull_all
-static int32_t resolve_path(const char *include, char **path)
+int32_t zone_resolve_path(const char *include, char **path)
 {
   if ((*path = _fullpath(NULL, include, 0)))
     return 0;
@@ -129,7 +158,7 @@ static int32_t resolve_path(const char *include, char **path)
 }
 #else
 nonnull_all
-static int32_t resolve_path(const char *include, char **path)
+int32_t zone_resolve_path(const char *include, char **path)
 {
   char *resolved;
   char buffer[PATH_MAX + 1];
@@ -146,25 +175,440 @@ static int32_t resolve_path(const char *include, char **path)
 }
 #endif
 
+#if HAVE_MMAP
+// size of the mapping, padding is ZONE_BLOCK_SIZE zero bytes, but at least
+// one null byte is required to terminate the buffer
+size_t zone_mapped_size(size_t length)
+{
+  const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  return ((length + 1 + ZONE_BLOCK_SIZE) + (page_size - 1)) & ~(page_size - 1);
+}
+#endif
+
+#if HAVE_POSIX_FADVISE
+// pages are dropped from the page cache in batches rather than on every
+// refill to limit the number of system calls
+#define DROP_CACHE_SIZE (64 * ZONE_WINDOW_SIZE)
+
+// drop everything up to length, or the entire file if length is zero.
+// pages are cached in folios that may be larger than a page and folios that
+// straddle the range are not dropped, hence the range always starts at zero
+nonnull_all
+static void drop_cache(file_t *file, uint64_t length)
+{
+  const int fd = fileno(file->handle);
+  // fails for pipes, which is harmless
+  (void)posix_fadvise(fd, 0, (off_t)length, POSIX_FADV_DONTNEED);
+}
+#endif
+
+#if HAVE_IO_URING
+// number of reads kept in flight and size of each read. the parser scans
+// the oldest window while the kernel fills the others
+#define READ_AHEAD_DEPTH (4)
+#define READ_AHEAD_SIZE (16 * ZONE_WINDOW_SIZE)
+
+typedef struct read_ahead_window read_ahead_window_t;
+struct read_ahead_window {
+  uint64_t offset;
+  size_t index, length, expected;
+  bool pending;
+  char *data;
+};
+
+struct zone_read_ahead {
+  struct io_uring ring;
+  int fd;
+  bool drop_cache;
+  /** size of the file when opened, updated if the file is truncated */
+  uint64_t size;
+  /** offset of the next read */
+  uint64_t offset;
+  size_t head;
+  read_ahead_window_t windows[READ_AHEAD_DEPTH];
+};
+
+nonnull_all
+static void prepare_read(
+  struct zone_read_ahead *read_ahead, read_ahead_window_t *window)
+{
+  struct io_uring_sqe *sqe = io_uring_get_sqe(&read_ahead->ring);
+  // never more reads in flight than there are entries in the ring
+  assert(sqe);
+  io_uring_prep_read(sqe, read_ahead->fd, window->data + window->length,
+    (unsigned)(window->expected - window->length),
+    window->offset + window->length);
+  io_uring_sqe_set_data(sqe, window);
+  window->pending = true;
+}
+
+nonnull_all
+static void prepare_window(
+  struct zone_read_ahead *read_ahead, read_ahead_window_t *window)
+{
+  window->offset = read_ahead->offset;
+  window->index = window->length = window->expected = 0;
+  window->pending = false;
+  if (read_ahead->offset >= read_ahead->size)
+    return;
+  window->expected = READ_AHEAD_SIZE;
+  if (read_ahead->size - read_ahead->offset < READ_AHEAD_SIZE)
+    window->expected = (size_t)(read_ahead->size - read_ahead->offset);
+  read_ahead->offset += window->expected;
+  prepare_read(read_ahead, window);
+}
+
+nonnull_all
+static void close_read_ahead(file_t *file)
+{
+  struct zone_read_ahead *read_ahead = file->read_ahead;
+  struct io_uring_cqe *cqe;
+
+  // buffers must not be released while the kernel may write to them
+  for (size_t i=0; i < READ_AHEAD_DEPTH; i++) {
+    while (read_ahead->windows[i].pending) {
+      if (io_uring_wait_cqe(&read_ahead->ring, &cqe) < 0)
+        break;
+      read_ahead_window_t *window = io_uring_cqe_get_data(cqe);
+      window->pending = false;
+      io_uring_cqe_seen(&read_ahead->ring, cqe);
+    }
+  }
+
+  io_uring_queue_exit(&read_ahead->ring);
+  free(read_ahead->windows[0].data);
+  free(read_ahead);
+  file->read_ahead = NULL;
+}
+
+// regular files are read using io_uring with a number of reads in flight
+// so that disk and processor work in parallel. zero is returned if the file
+// cannot be read using io_uring, the file is then read by other means
+nonnull_all
+static int32_t open_read_ahead(parser_t *parser, file_t *file)
+{
+  struct stat status;
+  struct zone_read_ahead *read_ahead;
+  char *data;
+  const int fd = fileno(file->handle);
+
+  if (fd == -1 || fstat(fd, &status) == -1 || !S_ISREG(status.st_mode))
+    return 0;
+  if (status.st_size <= 0)
+    return 0;
+
+  if (!(read_ahead = calloc(1, sizeof(*read_ahead))))
+    return ZONE_OUT_OF_MEMORY;
+  if (!(data = malloc(READ_AHEAD_DEPTH * READ_AHEAD_SIZE)))
+    return free(read_ahead), ZONE_OUT_OF_MEMORY;
+  // io_uring may not be supported by the kernel, or may be disabled
+  if (io_uring_queue_init(READ_AHEAD_DEPTH, &read_ahead->ring, 0) < 0)
+    return free(data), free(read_ahead), 0;
+
+  read_ahead->fd = fd;
+  read_ahead->drop_cache = parser->options.no_page_cache;
+  read_ahead->size = (uint64_t)status.st_size;
+  for (size_t i=0; i < READ_AHEAD_DEPTH; i++) {
+    read_ahead->windows[i].data = data + i * READ_AHEAD_SIZE;
+    prepare_window(read_ahead, &read_ahead->windows[i]);
+  }
+
+  file->read_ahead = read_ahead;
+  if (io_uring_submit(&read_ahead->ring) < 0)
+    return close_read_ahead(file), 0;
+  return 1;
+}
+
+nonnull_all
+static int32_t read_ahead(file_t *file, char *data, size_t size, size_t *count)
+{
+  struct zone_read_ahead *read_ahead = file->read_ahead;
+  read_ahead_window_t *window = &read_ahead->windows[read_ahead->head];
+  struct io_uring_cqe *cqe;
+
+  // wait for the oldest window, reads complete in any order
+  while (window->pending) {
+    if (io_uring_wait_cqe(&read_ahead->ring, &cqe) < 0)
+      return ZONE_READ_ERROR;
+    read_ahead_window_t *completed = io_uring_cqe_get_data(cqe);
+    const int32_t result = cqe->res;
+    io_uring_cqe_seen(&read_ahead->ring, cqe);
+    completed->pending = false;
+
+    if (result < 0 && result != -EINTR && result != -EAGAIN)
+      return ZONE_READ_ERROR;
+    if (result == 0) {
+      // file was truncated, stop at the last byte read
+      completed->expected = completed->length;
+      if (read_ahead->size > completed->offset + completed->length)
+        read_ahead->size = completed->offset + completed->length;
+    } else if (result > 0) {
+      completed->length += (size_t)result;
+    }
+    // short reads are resumed
+    if (completed->length < completed->expected) {
+      prepare_read(read_ahead, completed);
+      if (io_uring_submit(&read_ahead->ring) < 0)
+        return ZONE_READ_ERROR;
+    }
+  }
+
+  assert(window->index <= window->length);
+  size_t length = window->length - window->index;
+  if (length > size)
+    length = size;
+  memcpy(data, window->data + window->index, length);
+  window->index += length;
+  *count = length;
+
+  const uint64_t offset = window->offset + window->index;
+  if (window->index == window->length) {
+#if HAVE_POSIX_FADVISE
+    if (read_ahead->drop_cache &&
+        offset - file->cache.dropped >= DROP_CACHE_SIZE)
+    {
+      drop_cache(file, offset);
+      file->cache.dropped = offset;
+    }
+#endif
+    prepare_window(read_ahead, window);
+    if (window->pending && io_uring_submit(&read_ahead->ring) < 0)
+      return ZONE_READ_ERROR;
+    read_ahead->head = (read_ahead->head + 1) % READ_AHEAD_DEPTH;
+  }
+
+  file->end_of_file = offset >= read_ahead->size;
+  return 0;
+}
+#endif
+
+nonnull_all
+int32_t zone_read_handle(
+  parser_t *parser, file_t *file, char *data, size_t size, size_t *count)
+{
+  *count = fread(data, sizeof(data[0]), size, file->handle);
+  if (!*count && ferror(file->handle))
+    return ZONE_READ_ERROR;
+  file->end_of_file = feof(file->handle) != 0;
+  file->cache.offset += *count;
+#if HAVE_POSIX_FADVISE
+  if (parser->options.no_page_cache &&
+      file->cache.offset - file->cache.dropped >= DROP_CACHE_SIZE)
+  {
+    drop_cache(file, file->cache.offset);
+    file->cache.dropped = file->cache.offset;
+  }
+#else
+  (void)parser;
+#endif
+  return 0;
+}
+
+// like fread, reads until the window is filled or the input is exhausted.
+// the scanner does not index partial blocks unless the end of the input is
+// reached, returning early for short reads serves no purpose
+nonnull_all
+static int32_t read_reader(
+  file_t *file, char *data, size_t size, size_t *count)
+{
+  *count = 0;
+  while (*count < size) {
+    int32_t code;
+    size_t length = 0;
+    if ((code = file->reader->read(
+           file->reader, data + *count, size - *count, &length)) < 0)
+      return code;
+    if (length > size - *count)
+      return ZONE_READ_ERROR;
+    if (!length)
+      return (void)(file->end_of_file = 1), 0;
+    *count += length;
+  }
+  return 0;
+}
+
+// input pushed by the application is copied to the window as far as it
+// fits, the remainder is consumed on the next refill
+nonnull_all
+static int32_t read_stream(
+  file_t *file, char *data, size_t size, size_t *count)
+{
+  *count = file->stream.length < size ? file->stream.length : size;
+  // no input is pushed to finish the stream
+  if (*count)
+    memcpy(data, file->stream.data, *count);
+  file->stream.data += *count;
+  file->stream.length -= *count;
+  file->end_of_file = file->stream.finished && !file->stream.length;
+  return 0;
+}
+
+#if HAVE_MEMFD_CREATE
+// the window is mapped twice back-to-back so that data that wraps around
+// the end of the window is contiguous in memory. refill then never has to
+// move unread data or a partial token to the start of the window. null is
+// returned if the window cannot be mapped
+static char *map_ring(size_t size)
+{
+  void *base, *first, *second;
+  int fd;
+
+  if ((fd = memfd_create("zone", MFD_CLOEXEC)) == -1)
+    return NULL;
+  if (ftruncate(fd, (off_t)size) == -1)
+    return (void)close(fd), NULL;
+  base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    return (void)close(fd), NULL;
+  first = mmap(
+    base, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0);
+  second = mmap(
+    (char *)base + size, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0);
+  (void)close(fd);
+  if (first == MAP_FAILED || second == MAP_FAILED)
+    return (void)munmap(base, 2 * size), NULL;
+  return base;
+}
+#endif
+
+nonnull_all
+static void release_window(file_t *file)
+{
+#if HAVE_MEMFD_CREATE
+  if (file->ring.data)
+    (void)munmap(file->ring.data, 2 * file->ring.size);
+  else
+#endif
+    free(file->buffer.data);
+  file->ring.data = NULL;
+  file->ring.size = 0;
+  file->buffer.data = NULL;
+}
+
+// allocate a window that holds at least size bytes, unread data is copied
+// over. windows are mapped twice back-to-back if possible, the window is
+// allocated on the heap otherwise. input handed over by the application
+// is not released
+nonnull_all
+static int32_t resize_window(file_t *file, size_t size)
+{
+  const size_t length = file->buffer.data ? file->buffer.length : 0;
+  const bool owned = file->buffer.data && !file->borrowed;
+  char *data = NULL;
+
+#if HAVE_MEMFD_CREATE
+  const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t ring_size =
+    ((size + 1 + ZONE_BLOCK_SIZE) + (page_size - 1)) & ~(page_size - 1);
+  // do not map a ring if that failed before
+  if ((file->ring.data || !owned) && (data = map_ring(ring_size))) {
+    if (file->buffer.data)
+      memcpy(data, file->buffer.data, length);
+    if (owned)
+      release_window(file);
+    file->ring.data = data;
+    file->ring.size = ring_size;
+  }
+#endif
+
+  if (!data) {
+    if (!(data = malloc(size + 1 + ZONE_BLOCK_SIZE)))
+      return ZONE_OUT_OF_MEMORY;
+    if (file->buffer.data)
+      memcpy(data, file->buffer.data, length);
+    if (owned)
+      release_window(file);
+  }
+
+  data[length] = '\0';
+  file->borrowed = false;
+  file->buffer.data = data;
+  file->buffer.size = size;
+  file->buffer.oversized = 0;
+  return 0;
+}
+
+#if HAVE_PTHREAD && HAVE_MMAP
+// tapes are filled ahead of the parser by a scanner thread. the scanner
+// fills one slot at a time and hands it over once filled. slots are handed
+// over once every few thousand tokens, a lock per handover does not show
+#define PIPELINE_DEPTH (4)
+// files smaller than a couple of tapes are not worth a thread
+#define PIPELINE_MINIMUM_SIZE (256u * 1024u)
+
+struct zone_pipeline {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  /** signaled if a slot is published or released, or if the scanner is
+      stopped or done */
+  pthread_cond_t cond;
+  int32_t (*scan)(parser_t *);
+  /** parser used by the scanner, file is the slot that is being filled */
+  parser_t scanner;
+  /** slots are used in order, only tapes, input and scanner state are used */
+  file_t slots[PIPELINE_DEPTH];
+  /** number of slots published and taken, the last slot taken is in use */
+  size_t produced, consumed;
+  bool stop, done;
+};
+
+static void *scan_file(void *argument)
+{
+  struct zone_pipeline *pipeline = argument;
+
+  (void)pipeline->scan(&pipeline->scanner);
+  pthread_mutex_lock(&pipeline->lock);
+  pipeline->done = true;
+  pthread_cond_broadcast(&pipeline->cond);
+  pthread_mutex_unlock(&pipeline->lock);
+  return NULL;
+}
+
+nonnull_all
+static void close_pipeline(file_t *file)
+{
+  struct zone_pipeline *pipeline = file->pipeline;
+
+  pthread_mutex_lock(&pipeline->lock);
+  pipeline->stop = true;
+  pthread_cond_broadcast(&pipeline->cond);
+  pthread_mutex_unlock(&pipeline->lock);
+  pthread_join(pipeline->thread, NULL);
+  pthread_cond_destroy(&pipeline->cond);
+  pthread_mutex_destroy(&pipeline->lock);
+  free(pipeline);
+  file->pipeline = NULL;
+}
+#endif
+
 nonnull((1))
 static void close_file(
   parser_t *parser, file_t *file)
 {
   assert((file->name == not_a_file) == (file->path == not_a_file));
-
+#ifndef NDEBUG
   const bool is_string = file->name == not_a_file || file->path == not_a_file;
-
   assert(!is_string || file == &parser->first);
   assert(!is_string || file->handle == NULL);
-  (void)parser;
-#ifndef NDEBUG
   const bool is_stdin = file->name &&
                         file->name != not_a_file &&
                         strcmp(file->name, "-") == 0;
   assert(!is_stdin || (!file->handle || file->handle == stdin));
 #endif
-  if (file->buffer.data && !is_string)
-    free(file->buffer.data);
+#if HAVE_PTHREAD && HAVE_MMAP
+  // scanner reads from the mapping, stop it before the file is unmapped
+  if (file->pipeline)
+    close_pipeline(file);
+#endif
+#if HAVE_MMAP
+  if (file->buffer.data && file->mapped)
+    (void)munmap(file->buffer.data, zone_mapped_size(file->buffer.length));
+  else
+#endif
+  if (file->buffer.data && !file->borrowed)
+    release_window(file);
+  file->mapped = false;
+  file->borrowed = false;
   file->buffer.data = NULL;
   if (file->name && file->name != not_a_file)
     free((char *)file->name);
@@ -172,14 +616,30 @@ static void close_file(
   if (file->path && file->path != not_a_file)
     free((char *)file->path);
   file->path = NULL;
+#if HAVE_IO_URING
+  if (file->read_ahead)
+    close_read_ahead(file);
+#endif
+#if HAVE_ZLIB || HAVE_ZSTD
+  if (file->decompressor)
+    zone_close_decompressor(file);
+#endif
+#if HAVE_POSIX_FADVISE
+  // drop whatever is left, a length of zero extends to the end of the file
+  if (file->handle && parser->options.no_page_cache)
+    drop_cache(file, 0);
+#endif
   // stdin is not opened, it must not be closed
   if (file->handle && file->handle != stdin)
     (void)fclose(file->handle);
   file->handle = NULL;
+  if (file->reader && file->reader->close)
+    file->reader->close(file->reader);
+  file->reader = NULL;
 }
 
 nonnull_all
-static void initialize_file(
+void zone_initialize_file(
   parser_t *parser, file_t *file)
 {
   const size_t size = offsetof(file_t, fields.head);
@@ -216,7 +676,19 @@ static void initialize_file(
   file->name = (char *)not_a_file;
   file->path = (char *)not_a_file;
   file->handle = NULL;
+  file->reader = NULL;
   file->buffer.data = NULL;
+  file->buffer.minimum = ZONE_WINDOW_SIZE;
+  file->mapped = false;
+  file->borrowed = false;
+  file->ring.data = NULL;
+  file->ring.size = 0;
+  file->read_ahead = NULL;
+  file->decompressor = NULL;
+  file->pipeline = NULL;
+  file->stream.open = false;
+  file->stream.restart = NULL;
+  file->stream.fields = NULL;
   file->start_of_line = true;
   file->end_of_file = 1;
   file->fields.tape[0] = NULL;
@@ -227,27 +699,69 @@ static void initialize_file(
   file->newlines.head = file->newlines.tail = file->newlines.tape;
 }
 
+#if HAVE_MMAP
+// regular files are mapped into memory and scanned directly, which avoids
+// copying every byte into the window. an anonymous zero-filled mapping is
+// reserved first and the file is mapped over it, the remainder of the last
+// page of the file is zero-filled by the kernel and the pages that follow
+// provide the padding. zero is returned if the file cannot be mapped, the
+// file is then read into the window instead
+nonnull_all
+static int32_t map_file(file_t *file)
+{
+  struct stat status;
+  const int fd = fileno(file->handle);
+
+  if (fd == -1 || fstat(fd, &status) == -1 || !S_ISREG(status.st_mode))
+    return 0;
+  // empty files cannot be mapped
+  if (status.st_size <= 0 ||
+      (uintmax_t)status.st_size > (uintmax_t)(SIZE_MAX / 2))
+    return 0;
+
+  const size_t length = (size_t)status.st_size;
+  const size_t size = zone_mapped_size(length);
+  void *base, *data;
+
+  base = mmap(NULL, size, PROT_READ, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    return 0;
+  data = mmap(base, length, PROT_READ, MAP_PRIVATE|MAP_FIXED, fd, 0);
+  if (data == MAP_FAILED)
+    return (void)munmap(base, size), 0;
+  assert(data == base);
+#if defined MADV_SEQUENTIAL
+  (void)madvise(data, length, MADV_SEQUENTIAL);
+#endif
+
+  (void)fclose(file->handle);
+  file->handle = NULL;
+  file->mapped = true;
+  file->buffer.data = data;
+  file->buffer.size = length;
+  file->buffer.length = length;
+  file->end_of_file = 1;
+  file->fields.tape[0] = &file->buffer.data[length];
+  file->fields.tape[1] = &file->buffer.data[length];
+  return 1;
+}
+#endif
+
 nonnull_all
 static int32_t open_file(
   parser_t *parser, file_t *file, const char *include, size_t length)
 {
   int32_t code;
-  const size_t size = ZONE_WINDOW_SIZE + 1 + ZONE_BLOCK_SIZE;
+  char magic[4];
+  size_t peeked = 0;
 
-  initialize_file(parser, file);
+  zone_initialize_file(parser, file);
 
   file->path = NULL;
   if (!(file->name = malloc(length + 1)))
     return ZONE_OUT_OF_MEMORY;
   memcpy(file->name, include, length);
   file->name[length] = '\0';
-  if (!(file->buffer.data = malloc(size)))
-    return (void)close_file(parser, file), ZONE_OUT_OF_MEMORY;
-  file->buffer.data[0] = '\0';
-  file->buffer.size = ZONE_WINDOW_SIZE;
-  file->end_of_file = 0;
-  file->fields.tape[0] = &file->buffer.data[0];
-  file->fields.tape[1] = &file->buffer.data[0];
 
   if(file == &parser->first && strcmp(file->name, "-") == 0) {
     if (!(file->path = malloc(2)))
@@ -260,32 +774,126 @@ static int32_t open_file(
     // file as file descriptors for pipes and sockets the entries will be
     // symoblic links whose content is the file type with the inode.
     // See NLnetLabs/nsd#380.
-    if ((code = resolve_path(file->name, &file->path)))
+    if ((code = zone_resolve_path(file->name, &file->path)))
       return (void)close_file(parser, file), code;
   }
 
   if(strcmp(file->path, "-") == 0) {
     file->handle = stdin;
+  } else if (!(file->handle = fopen(file->name, "rb"))) {
+    switch (errno) {
+      case ENOMEM:
+        code = ZONE_OUT_OF_MEMORY;
+        break;
+      case EACCES:
+        code = ZONE_NOT_PERMITTED;
+        break;
+      default:
+        code = ZONE_NOT_A_FILE;
+        break;
+    }
+
+    close_file(parser, file);
+    return code;
+  }
+
+#if HAVE_ZLIB || HAVE_ZSTD
+  // compressed files are decompressed into the window
+  if ((code = zone_open_decompressor(parser, file, magic, &peeked)) < 0)
+    return (void)close_file(parser, file), code;
+#endif
+#if HAVE_IO_URING
+  // io_uring is preferred over mmap if enabled
+  if (file->handle != stdin && !file->decompressor &&
+      (code = open_read_ahead(parser, file)) < 0)
+    return (void)close_file(parser, file), code;
+#endif
+#if HAVE_MMAP
+  // pipes and stdin are read into the window. mapped pages cannot be
+  // dropped from the page cache, files are read into the window instead
+  if (file->handle != stdin && !file->read_ahead && !file->decompressor &&
+      !parser->options.no_page_cache && map_file(file))
     return 0;
-  } else {
-    if ((file->handle = fopen(file->name, "rb")))
+#endif
+
+  if ((code = resize_window(file, file->buffer.minimum)) < 0)
+    return (void)close_file(parser, file), code;
+  // bytes read to detect compressed input, if the stream is not seekable
+  memcpy(file->buffer.data, magic, peeked);
+  file->buffer.length = peeked;
+  file->buffer.data[peeked] = '\0';
+  file->end_of_file = 0;
+  file->fields.tape[0] = &file->buffer.data[peeked];
+  file->fields.tape[1] = &file->buffer.data[peeked];
+  return 0;
+}
+
+// windows are not sized beyond what a reader may reasonably ask for
+#define MAXIMUM_READER_WINDOW_SIZE (16u * 1024u * 1024u)
+
+// input is read from the reader into the window, unless the reader hands
+// over the input in its entirety, which is then scanned directly. the name
+// is used as path too as the input need not exist on the filesystem
+nonnull_all
+static int32_t open_reader(
+  parser_t *parser,
+  file_t *file,
+  const char *name,
+  size_t length,
+  zone_reader_t *reader)
+{
+  int32_t code;
+
+  zone_initialize_file(parser, file);
+
+  file->reader = reader;
+  file->path = NULL;
+  if (!(file->name = malloc(length + 1)))
+    return (void)close_file(parser, file), ZONE_OUT_OF_MEMORY;
+  memcpy(file->name, name, length);
+  file->name[length] = '\0';
+  if (!(file->path = malloc(length + 1)))
+    return (void)close_file(parser, file), ZONE_OUT_OF_MEMORY;
+  memcpy(file->path, name, length + 1);
+
+  if (!reader->read)
+    return (void)close_file(parser, file), ZONE_BAD_PARAMETER;
+
+  if (reader->map) {
+    const char *data = NULL;
+    size_t size = 0;
+    if ((code = reader->map(reader, &data, &size)) < 0)
+      return (void)close_file(parser, file), code;
+    if (code > 0) {
+      if (!data || data[size] != '\0')
+        return (void)close_file(parser, file), ZONE_BAD_PARAMETER;
+      file->borrowed = true;
+      file->buffer.data = (char *)data;
+      file->buffer.size = size;
+      file->buffer.length = size;
+      file->end_of_file = 1;
+      file->fields.tape[0] = &data[size];
+      file->fields.tape[1] = &data[size];
       return 0;
+    }
   }
 
-  switch (errno) {
-    case ENOMEM:
-      code = ZONE_OUT_OF_MEMORY;
-      break;
-    case EACCES:
-      code = ZONE_NOT_PERMITTED;
-      break;
-    default:
-      code = ZONE_NOT_A_FILE;
-      break;
+  if (reader->window_size > file->buffer.minimum) {
+    size_t size = reader->window_size;
+    if (size > MAXIMUM_READER_WINDOW_SIZE)
+      size = MAXIMUM_READER_WINDOW_SIZE;
+    file->buffer.minimum =
+      (size + (ZONE_BLOCK_SIZE - 1)) & ~(size_t)(ZONE_BLOCK_SIZE - 1);
   }
 
-  close_file(parser, file);
-  return code;
+  if ((code = resize_window(file, file->buffer.minimum)) < 0)
+    return (void)close_file(parser, file), code;
+  file->buffer.length = 0;
+  file->buffer.data[0] = '\0';
+  file->end_of_file = 0;
+  file->fields.tape[0] = &file->buffer.data[0];
+  file->fields.tape[1] = &file->buffer.data[0];
+  return 0;
 }
 
 diagnostic_pop()
@@ -303,6 +911,132 @@ void zone_close_file(
   free(file);
 }
 
+nonnull_all
+int32_t zone_resize_window(zone_file_t *file, size_t size)
+{
+  return resize_window(file, size);
+}
+
+nonnull_all
+int32_t zone_read_file(
+  parser_t *parser, zone_file_t *file, char *data, size_t size, size_t *count)
+{
+  if (file->reader)
+    return read_reader(file, data, size, count);
+  if (file->stream.open)
+    return read_stream(file, data, size, count);
+#if HAVE_IO_URING
+  if (file->read_ahead)
+    return read_ahead(file, data, size, count);
+#endif
+#if HAVE_ZLIB || HAVE_ZSTD
+  if (file->decompressor)
+    return zone_decompress(parser, file, data, size, count);
+#endif
+  return zone_read_handle(parser, file, data, size, count);
+}
+
+nonnull_all
+void zone_open_pipeline(
+  parser_t *parser, zone_file_t *file, int32_t (*scan)(parser_t *))
+{
+#if HAVE_PTHREAD && HAVE_MMAP
+  struct zone_pipeline *pipeline;
+
+  (void)parser;
+  assert(file->mapped && !file->pipeline);
+  // files are parsed on the calling thread if no scanner can be started
+  if (file->buffer.length < PIPELINE_MINIMUM_SIZE)
+    return;
+  if (!(pipeline = malloc(sizeof(*pipeline))))
+    return;
+
+  // scanner starts from the file, which is not modified by the parser
+  // until the first slot is published
+  memset(&pipeline->scanner, 0, offsetof(parser_t, file));
+  pipeline->scanner.user_data = pipeline;
+  pipeline->scanner.file = file;
+  pipeline->scan = scan;
+  pipeline->produced = pipeline->consumed = 0;
+  pipeline->stop = pipeline->done = false;
+  pthread_mutex_init(&pipeline->lock, NULL);
+  pthread_cond_init(&pipeline->cond, NULL);
+  if (pthread_create(&pipeline->thread, NULL, scan_file, pipeline) != 0) {
+    pthread_cond_destroy(&pipeline->cond);
+    pthread_mutex_destroy(&pipeline->lock);
+    free(pipeline);
+    return;
+  }
+
+  file->pipeline = pipeline;
+#else
+  (void)parser;
+  (void)file;
+  (void)scan;
+#endif
+}
+
+nonnull_all
+zone_file_t *zone_acquire_tapes(parser_t *scanner)
+{
+#if HAVE_PTHREAD && HAVE_MMAP
+  struct zone_pipeline *pipeline = scanner->user_data;
+  file_t *file = NULL;
+
+  // slot in use by the parser and the last slot that was published are
+  // never written, the latter is read to carry over state
+  pthread_mutex_lock(&pipeline->lock);
+  while (!pipeline->stop &&
+          pipeline->produced + 1 >= pipeline->consumed + PIPELINE_DEPTH)
+    pthread_cond_wait(&pipeline->cond, &pipeline->lock);
+  if (!pipeline->stop)
+    file = &pipeline->slots[pipeline->produced % PIPELINE_DEPTH];
+  pthread_mutex_unlock(&pipeline->lock);
+  return file;
+#else
+  (void)scanner;
+  return NULL;
+#endif
+}
+
+nonnull_all
+void zone_publish_tapes(parser_t *scanner)
+{
+#if HAVE_PTHREAD && HAVE_MMAP
+  struct zone_pipeline *pipeline = scanner->user_data;
+
+  pthread_mutex_lock(&pipeline->lock);
+  pipeline->produced++;
+  pthread_cond_broadcast(&pipeline->cond);
+  pthread_mutex_unlock(&pipeline->lock);
+#else
+  (void)scanner;
+#endif
+}
+
+nonnull_all
+const zone_file_t *zone_take_tapes(zone_file_t *file)
+{
+#if HAVE_PTHREAD && HAVE_MMAP
+  struct zone_pipeline *pipeline = file->pipeline;
+  const file_t *tapes = NULL;
+
+  // slot taken last is released
+  pthread_mutex_lock(&pipeline->lock);
+  pipeline->consumed++;
+  pthread_cond_broadcast(&pipeline->cond);
+  while (!pipeline->done && pipeline->produced < pipeline->consumed)
+    pthread_cond_wait(&pipeline->cond, &pipeline->lock);
+  if (pipeline->produced >= pipeline->consumed)
+    tapes = &pipeline->slots[(pipeline->consumed - 1) % PIPELINE_DEPTH];
+  pthread_mutex_unlock(&pipeline->lock);
+  return tapes;
+#else
+  (void)file;
+  return NULL;
+#endif
+}
+
 nonnull_all
 int32_t zone_open_file(
   parser_t *parser, const char *path, size_t length, zone_file_t **file)
@@ -311,19 +1045,40 @@ int32_t zone_open_file(
 
   if (!(*file = malloc(sizeof(**file))))
     return ZONE_OUT_OF_MEMORY;
-  if ((code = open_file(parser, *file, path, length)) == 0)
+
+  if (parser->options.include.open) {
+    // application provides input for included files
+    zone_reader_t *reader = NULL;
+    char name[PATH_MAX + 1];
+    if (length > PATH_MAX) {
+      code = ZONE_NOT_A_FILE;
+    } else {
+      memcpy(name, path, length);
+      name[length] = '\0';
+      code = parser->options.include.open(
+        parser, name, &reader, parser->user_data);
+      if (code == 0 && !reader)
+        code = ZONE_NOT_A_FILE;
+      else if (code == 0)
+        code = open_reader(parser, *file, path, length, reader);
+    }
+  } else {
+    code = open_file(parser, *file, path, length);
+  }
+
+  if (code == 0)
     return 0;
 
   free(*file);
 
-  const char *reason = NULL;
+  const char *reason = "error";
   switch (code) {
     case ZONE_OUT_OF_MEMORY: reason = "out of memory"; break;
     case ZONE_NOT_PERMITTED: reason = "access denied"; break;
     case ZONE_NOT_A_FILE:    reason = "no such file";  break;
+    case ZONE_READ_ERROR:    reason = "read error";    break;
   }
 
-  assert(reason);
   zone_error(parser, "Cannot open %.*s, %s", (int)length, path, reason);
   return code;
 }
@@ -333,22 +1088,23 @@ void zone_close(parser_t *parser)
 {
   assert(parser);
   for (zone_file_t *file = parser->file, *includer; file; file = includer) {
-    includer = file->includer;
+    // first file may be included from a file of another parser, see
+    // zone_parse_includes
+    includer = file == &parser->first ? NULL : file->includer;
     close_file(parser, file);
     if (file != &parser->first)
       free(file);
   }
+  parser->file = &parser->first;
 }
 
 nonnull((1,2,3))
-static int32_t initialize_parser(
+int32_t zone_setup_parser(
   zone_parser_t *parser,
   const zone_options_t *options,
   zone_buffers_t *buffers,
   void *user_data)
 {
-  if (!options->accept.callback)
-    return ZONE_BAD_PARAMETER;
   if (!options->default_ttl)
     return ZONE_BAD_PARAMETER;
   if (!options->secondary && options->default_ttl > INT32_MAX)
@@ -389,17 +1145,23 @@ static int32_t initialize_parser(
   return 0;
 }
 
-int32_t zone_open(
+nonnull((1,2,3))
+int32_t zone_initialize_parser(
   zone_parser_t *parser,
   const zone_options_t *options,
   zone_buffers_t *buffers,
-  const char *path,
   void *user_data)
+{
+  if (!options->accept.callback)
+    return ZONE_BAD_PARAMETER;
+  return zone_setup_parser(parser, options, buffers, user_data);
+}
+
+nonnull_all
+int32_t zone_open_first(zone_parser_t *parser, const char *path)
 {
   int32_t code;
 
-  if ((code = initialize_parser(parser, options, buffers, user_data)) < 0)
-    return code;
   if ((code = open_file(parser, &parser->first, path, strlen(path))) == 0)
     return 0;
 
@@ -417,6 +1179,32 @@ int32_t zone_open(
 
 diagnostic_pop()
 
+int32_t zone_open(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *path,
+  void *user_data)
+{
+  int32_t code;
+
+  // records are returned by zone_next, no accept callback is required
+  if ((code = zone_setup_parser(parser, options, buffers, user_data)) < 0)
+    return code;
+  return zone_open_first(parser, path);
+}
+
+int32_t zone_next(
+  zone_parser_t *parser,
+  zone_rr_t *rr)
+{
+  // select kernel once rather than for every record
+  if (!parser->next)
+    parser->next = zone_select_kernel()->parse;
+  parser->rr = rr;
+  return parser->next(parser);
+}
+
 int32_t zone_parse(
   zone_parser_t *parser,
   const zone_options_t *options,
@@ -426,9 +1214,101 @@ int32_t zone_parse(
 {
   int32_t code;
 
-  if ((code = zone_open(parser, options, buffers, path, user_data)) < 0)
+  if ((code = zone_initialize_parser(parser, options, buffers, user_data)) < 0)
+    return code;
+  if ((code = zone_open_first(parser, path)) < 0)
+    return code;
+  code = zone_parse_file(parser, user_data);
+  zone_close(parser);
+  return code;
+}
+
+int32_t zone_parse_reader(
+  zone_parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *name,
+  zone_reader_t *reader,
+  void *user_data)
+{
+  int32_t code;
+
+  if ((code = zone_initialize_parser(parser, options, buffers, user_data)) < 0) {
+    if (reader->close)
+      reader->close(reader);
+    return code;
+  }
+  if ((code = open_reader(parser, parser->file, name, strlen(name), reader)) < 0)
+    return code;
+  code = zone_parse_file(parser, user_data);
+  zone_close(parser);
+  return code;
+}
+
+typedef struct memory_reader memory_reader_t;
+struct memory_reader {
+  zone_reader_t reader;
+  const char *data;
+  size_t length;
+};
+
+static int32_t read_memory(
+  zone_reader_t *reader, char *data, size_t size, size_t *count)
+{
+  memory_reader_t *memory = (memory_reader_t *)reader;
+  *count = memory->length < size ? memory->length : size;
+  memcpy(data, memory->data, *count);
+  memory->data += *count;
+  memory->length -= *count;
+  return 0;
+}
+
+// number of bytes at the end of unpadded input that are copied to a window.
+// tokens that end before the tail may be read up to a block beyond their
+// delimiter, which is what the padding requirement guarantees otherwise
+#define UNPADDED_TAIL_SIZE (2 * ZONE_BLOCK_SIZE)
+
+int32_t zone_parse_buffer(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  const char *data,
+  size_t length,
+  void *user_data)
+{
+  int32_t code;
+  memory_reader_t tail = { { read_memory, NULL, NULL, 0 }, data, length };
+
+  if ((code = zone_initialize_parser(parser, options, buffers, user_data)) < 0)
+    return code;
+  zone_initialize_file(parser, parser->file);
+  parser->file->reader = &tail.reader;
+
+  // full blocks are scanned in place, the tail (and any token that
+  // straddles it) is copied to a window once the parser gets there
+  size_t scanned = 0;
+  if (length > UNPADDED_TAIL_SIZE)
+    scanned = (length - UNPADDED_TAIL_SIZE) & ~(size_t)(ZONE_BLOCK_SIZE - 1);
+  if (scanned) {
+    tail.data += scanned;
+    tail.length -= scanned;
+    parser->file->borrowed = true;
+    parser->file->buffer.data = (char *)data;
+    parser->file->buffer.size = scanned;
+    parser->file->buffer.length = scanned;
+  } else if ((code = resize_window(parser->file, ZONE_WINDOW_SIZE)) < 0) {
+    zone_close(parser);
     return code;
-  code = parse(parser, user_data);
+  } else {
+    parser->file->buffer.length = 0;
+  }
+
+  // input is not null-terminated, no partial token is signaled otherwise
+  parser->file->end_of_file = 0;
+  parser->file->fields.tape[0] = &not_a_token[0];
+  parser->file->fields.tape[1] = &not_a_token[0];
+
+  code = zone_parse_file(parser, user_data);
   zone_close(parser);
   return code;
 }
@@ -443,11 +1323,12 @@ int32_t zone_parse_string(
 {
   int32_t code;
 
-  if ((code = initialize_parser(parser, options, buffers, user_data)) < 0)
+  if ((code = zone_initialize_parser(parser, options, buffers, user_data)) < 0)
     return code;
   if (!length || string[length] != '\0')
     return ZONE_BAD_PARAMETER;
-  initialize_file(parser, parser->file);
+  zone_initialize_file(parser, parser->file);
+  parser->file->borrowed = true;
   parser->file->buffer.data = (char *)string;
   parser->file->buffer.size = length;
   parser->file->buffer.length = length;
@@ -455,8 +1336,89 @@ int32_t zone_parse_string(
   parser->file->fields.tape[1] = &string[length];
   assert(parser->file->end_of_file == 1);
 
-  code = parse(parser, user_data);
+  code = zone_parse_file(parser, user_data);
+  zone_close(parser);
+  return code;
+}
+
+int32_t zone_stream_open(
+  parser_t *parser,
+  const zone_options_t *options,
+  zone_buffers_t *buffers,
+  void *user_data)
+{
+  int32_t code;
+
+  if ((code = zone_initialize_parser(parser, options, buffers, user_data)) < 0)
+    return code;
+  zone_initialize_file(parser, parser->file);
+  if ((code = resize_window(parser->file, ZONE_WINDOW_SIZE)) < 0) {
+    zone_close(parser);
+    return code;
+  }
+
+  // select kernel once rather than for every chunk of input
+  parser->next = zone_select_kernel()->parse;
+  parser->file->stream.open = true;
+  parser->file->buffer.length = 0;
+  parser->file->buffer.data[0] = '\0';
+  parser->file->end_of_file = 0;
+  parser->file->fields.tape[0] = &not_a_token[0];
+  parser->file->fields.tape[1] = &not_a_token[0];
+  return 0;
+}
+
+int32_t zone_stream_feed(
+  parser_t *parser,
+  const char *data,
+  size_t length)
+{
+  int32_t code;
+
+  if (parser->file != &parser->first ||
+      !parser->first.stream.open || parser->first.stream.finished)
+    return ZONE_BAD_PARAMETER;
+  if (!length)
+    return 0;
+
+  // input is scanned in blocks, records are not parsed again until input
+  // that completes a block is fed
+  file_t *file = parser->file;
+  if (file->buffer.length - file->buffer.index + length < ZONE_BLOCK_SIZE &&
+      file->buffer.size - file->buffer.length >= length) {
+    memcpy(file->buffer.data + file->buffer.length, data, length);
+    file->buffer.length += length;
+    file->buffer.data[file->buffer.length] = '\0';
+    // tapes are terminated by the end of input
+    file->fields.tail[0] = file->buffer.data + file->buffer.length;
+    file->delimiters.tail[0] = file->buffer.data + file->buffer.length;
+    return 0;
+  }
+
+  // records that are complete are parsed, the parser is rewound to the
+  // start of the last record if it is incomplete
+  file->stream.data = data;
+  file->stream.length = length;
+  if ((code = parser->next(parser)) < 0) {
+    zone_close(parser);
+    parser->first.stream.open = false;
+  }
+  return code;
+}
+
+int32_t zone_stream_finish(
+  parser_t *parser)
+{
+  int32_t code;
+
+  if (parser->file != &parser->first ||
+      !parser->first.stream.open || parser->first.stream.finished)
+    return ZONE_BAD_PARAMETER;
+
+  parser->file->stream.finished = true;
+  code = parser->next(parser);
   zone_close(parser);
+  parser->first.stream.open = false;
   return code;
 }
 
@@ -0,0 +1,234 @@
+/*
+ * batch.c -- test parsing a batch of zone files on multiple threads
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "tools.h"
+
+#define MAXIMUM_THREADS (4)
+#define ZONES (200)
+
+// records are kept per job to compare against the records of parsing each
+// zone on its own
+static int32_t hash_job_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  // user data of the job is the list of the job
+  const zone_chunk_t *chunk = user_data;
+
+  (void)parser;
+  if (chunk->thread >= MAXIMUM_THREADS)
+    return ZONE_BAD_PARAMETER;
+  return append(chunk->user_data, hash_record(
+    HASH_SEED, owner, type, class, ttl, rdlength, rdata));
+}
+
+// owners are relative so that the origin of the job shows in the records
+static void write_zone(const char *path, size_t number, size_t count)
+{
+  char *text = malloc(count * 64 + 256);
+  assert_non_null(text);
+  size_t length = 0;
+
+  for (size_t i=0; i < count; i++) {
+    if (i == 0)
+      length += (size_t)sprintf(text + length,
+        "@ SOA ns hostmaster %zu 3600 900 604800 86400\n@ NS ns\n", number);
+    length += (size_t)sprintf(text + length,
+      "host%zu A 192.0.2.%zu\n  TXT \"zone %zu\"\n", i, i % 256, number);
+  }
+
+  write_file(path, text, length);
+  free(text);
+}
+
+typedef struct zones zones_t;
+struct zones {
+  char *paths[ZONES];
+  uint8_t origins[ZONES][32];
+  zone_job_t jobs[ZONES];
+  list_t lists[ZONES];
+};
+
+static void create_zones(zones_t *zones)
+{
+  memset(zones, 0, sizeof(*zones));
+  for (size_t i=0; i < ZONES; i++) {
+    zones->paths[i] = get_tempnam(NULL, "zone");
+    assert_non_null(zones->paths[i]);
+    // one zone is too large to be read into the window of the worker
+    write_zone(zones->paths[i], i, i == ZONES / 2 ? 40000 : 10 + i % 50);
+
+    // zoneN.example.
+    uint8_t *origin = zones->origins[i];
+    const int length = sprintf((char *)origin + 1, "zone%zu", i);
+    origin[0] = (uint8_t)length;
+    memcpy(origin + 1 + length, "\7example\0", 9);
+    zones->jobs[i].path = zones->paths[i];
+    zones->jobs[i].origin.octets = origin;
+    zones->jobs[i].origin.length = (uint8_t)(1 + length + 9);
+    zones->jobs[i].user_data = &zones->lists[i];
+  }
+}
+
+static void release_lists(zones_t *zones)
+{
+  for (size_t i=0; i < ZONES; i++)
+    release_list(&zones->lists[i]);
+}
+
+static void remove_zones(zones_t *zones)
+{
+  release_lists(zones);
+  for (size_t i=0; i < ZONES; i++) {
+    remove(zones->paths[i]);
+    free(zones->paths[i]);
+  }
+}
+
+static void initialize_batch_options(zone_options_t *options)
+{
+  initialize_options(options);
+  options->accept.callback = &hash_job_rr;
+}
+
+static int32_t parse_batch(
+  zones_t *zones, const zone_options_t *options, size_t threads, int32_t *codes)
+{
+  zone_name_buffer_t owner[MAXIMUM_THREADS];
+  zone_rdata_buffer_t rdata[MAXIMUM_THREADS];
+  zone_buffers_t buffers = { MAXIMUM_THREADS, owner, rdata };
+
+  return zone_parse_batch(options, &buffers, zones->jobs, ZONES, threads, codes);
+}
+
+// parse every zone on its own
+static void parse_zones(zones_t *zones, list_t expected[ZONES])
+{
+  for (size_t i=0; i < ZONES; i++) {
+    zone_parser_t parser;
+    zone_name_buffer_t owner;
+    zone_rdata_buffer_t rdata;
+    zone_buffers_t buffers = { 1, &owner, &rdata };
+    zone_options_t options;
+    zone_chunk_t chunk = { 0, i, &expected[i] };
+
+    initialize_batch_options(&options);
+    options.origin = zones->jobs[i].origin;
+    assert_int_equal(
+      zone_parse(&parser, &options, &buffers, zones->paths[i], &chunk),
+      ZONE_SUCCESS);
+  }
+}
+
+/*!cmocka */
+void batch_records(void **state)
+{
+  (void)state;
+
+  static zones_t zones;
+  static list_t expected[ZONES];
+  create_zones(&zones);
+  memset(expected, 0, sizeof(expected));
+  parse_zones(&zones, expected);
+
+  zone_options_t options;
+  initialize_batch_options(&options);
+  for (size_t threads=1; threads <= MAXIMUM_THREADS; threads++) {
+    int32_t codes[ZONES];
+    memset(codes, 0xff, sizeof(codes));
+    assert_int_equal(parse_batch(&zones, &options, threads, codes), ZONE_SUCCESS);
+    for (size_t i=0; i < ZONES; i++) {
+      assert_int_equal(codes[i], ZONE_SUCCESS);
+      assert_same_list(&expected[i], &zones.lists[i]);
+    }
+    release_lists(&zones);
+  }
+
+  // paths are not resolved if includes are disabled
+  options.no_includes = true;
+  assert_int_equal(parse_batch(&zones, &options, 2, NULL), ZONE_SUCCESS);
+  for (size_t i=0; i < ZONES; i++)
+    assert_int_equal(zones.lists[i].count, expected[i].count);
+
+  for (size_t i=0; i < ZONES; i++)
+    release_list(&expected[i]);
+  remove_zones(&zones);
+}
+
+/*!cmocka */
+void batch_errors(void **state)
+{
+  (void)state;
+
+  static zones_t zones;
+  create_zones(&zones);
+
+  // included files are opened from zones read into the window
+  char *include = get_tempnam(NULL, "zone");
+  assert_non_null(include);
+  write_zone(include, 0, 10);
+  char text[512];
+  int length = snprintf(text, sizeof(text), "$INCLUDE \"%s\"\n", include);
+  assert_true(length > 0 && (size_t)length < sizeof(text));
+  write_file(zones.paths[3], text, (size_t)length);
+
+  // errors are reported per job, the code of the first job that failed is
+  // returned
+  static const char error[] = "foo A 192.0.2\n";
+  write_file(zones.paths[ZONES - 10], error, sizeof(error) - 1);
+  remove(zones.paths[ZONES - 20]);
+
+  zone_options_t options;
+  initialize_batch_options(&options);
+  for (size_t threads=1; threads <= MAXIMUM_THREADS; threads++) {
+    int32_t codes[ZONES];
+    assert_int_equal(
+      parse_batch(&zones, &options, threads, codes), ZONE_NOT_A_FILE);
+    for (size_t i=0; i < ZONES; i++) {
+      if (i == ZONES - 20)
+        assert_int_equal(codes[i], ZONE_NOT_A_FILE);
+      else if (i == ZONES - 10)
+        assert_int_equal(codes[i], ZONE_SYNTAX_ERROR);
+      else
+        assert_int_equal(codes[i], ZONE_SUCCESS);
+    }
+    assert_int_equal(zones.lists[3].count, 22);
+    release_lists(&zones);
+  }
+
+  options.no_includes = true;
+  int32_t codes[ZONES];
+  assert_int_equal(
+    parse_batch(&zones, &options, 3, codes), ZONE_NOT_PERMITTED);
+  assert_int_equal(codes[3], ZONE_NOT_PERMITTED);
+  release_lists(&zones);
+
+  // jobs are not parsed if options are invalid
+  options.default_ttl = 0;
+  assert_int_equal(
+    parse_batch(&zones, &options, 3, codes), ZONE_BAD_PARAMETER);
+  assert_int_equal(zones.lists[0].count, 0);
+
+  remove(include);
+  free(include);
+  remove_zones(&zones);
+}
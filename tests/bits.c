@@ -36,6 +36,13 @@ struct kernel {
   void (*test_add_overflow)(void **state);
 };
 
+#if HAVE_ICELAKE
+extern void test_icelake_trailing_zeroes(void **);
+extern void test_icelake_leading_zeroes(void **);
+extern void test_icelake_prefix_xor(void **);
+extern void test_icelake_add_overflow(void **);
+#endif
+
 #if HAVE_HASWELL
 extern void test_haswell_trailing_zeroes(void **);
 extern void test_haswell_leading_zeroes(void **);
@@ -50,10 +57,33 @@ extern void test_westmere_prefix_xor(void **);
 extern void test_westmere_add_overflow(void **);
 #endif
 
+#if HAVE_NEON
+extern void test_neon_trailing_zeroes(void **);
+extern void test_neon_leading_zeroes(void **);
+extern void test_neon_prefix_xor(void **);
+extern void test_neon_add_overflow(void **);
+#endif
+
+#if HAVE_VECTOR
+extern void test_vector_trailing_zeroes(void **);
+extern void test_vector_leading_zeroes(void **);
+extern void test_vector_prefix_xor(void **);
+extern void test_vector_add_overflow(void **);
+#endif
+
 extern void test_fallback_trailing_zeroes(void **);
 extern void test_fallback_leading_zeroes(void **);
+extern void test_fallback_prefix_xor(void **);
+extern void test_fallback_add_overflow(void **);
 
 static const struct kernel kernels[] = {
+#if HAVE_ICELAKE
+  { "icelake", AVX512F|AVX512BW|AVX512VL|AVX512VBMI2,
+                                 &test_icelake_trailing_zeroes,
+                                 &test_icelake_leading_zeroes,
+                                 &test_icelake_prefix_xor,
+                                 &test_icelake_add_overflow },
+#endif
 #if HAVE_HASWELL
   { "haswell", AVX2,             &test_haswell_trailing_zeroes,
                                  &test_haswell_leading_zeroes,
@@ -65,10 +95,23 @@ static const struct kernel kernels[] = {
                                  &test_westmere_leading_zeroes,
                                  &test_westmere_prefix_xor,
                                  &test_westmere_add_overflow },
+#endif
+#if HAVE_NEON
+  { "neon", NEON,                &test_neon_trailing_zeroes,
+                                 &test_neon_leading_zeroes,
+                                 &test_neon_prefix_xor,
+                                 &test_neon_add_overflow },
+#endif
+#if HAVE_VECTOR
+  { "vector", DEFAULT,           &test_vector_trailing_zeroes,
+                                 &test_vector_leading_zeroes,
+                                 &test_vector_prefix_xor,
+                                 &test_vector_add_overflow },
 #endif
   { "fallback", DEFAULT,         &test_fallback_trailing_zeroes,
                                  &test_fallback_leading_zeroes,
-                                 0, 0 }
+                                 &test_fallback_prefix_xor,
+                                 &test_fallback_add_overflow }
 };
 
 static inline const struct kernel *
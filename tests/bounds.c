@@ -239,8 +239,252 @@ void contiguous_on_buffer_boundary(void **state)
   (void)fclose(handle);
   size_t count = 0;
   int32_t code = zone_parse(&parser, &options, &buffers, path, &count);
+  assert_int_equal(code, ZONE_SUCCESS);
+  assert_int_equal(count, 3);
+
+  // regular files are mapped, read into the window to test resizing
+  options.no_page_cache = true;
+  count = 0;
+  code = zone_parse(&parser, &options, &buffers, path, &count);
   remove(path);
   assert_int_equal(code, ZONE_SUCCESS);
   assert_int_equal(count, 3);
   free(path);
 }
+
+static int32_t count_a(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  (void)parser;
+  (void)class;
+  (void)ttl;
+  (void)rdata;
+
+  static const uint8_t foo[5] = { 3, 'f', 'o', 'o', 0 };
+
+  if (owner->length != 5 || memcmp(owner->octets, foo, 5) != 0)
+    return ZONE_SYNTAX_ERROR;
+  if (type != ZONE_TYPE_A || rdlength != 4)
+    return ZONE_SYNTAX_ERROR;
+  *((size_t *)user_data) += 1;
+  return 0;
+}
+
+/*!cmocka */
+void tape_boundary(void **state)
+{
+  // test if start-of-line is retained if the tape fills up before the
+  // input is fully indexed, as happens for strings and mapped files
+
+  (void)state;
+
+  static const uint8_t root[1] = { 0 };
+  static const char *records[] = {
+    "foo. A 192.0.2.1\n", " A 192.0.2.2\n", "  A 192.0.2.3 ; comment\n" };
+  const size_t count = 3 * 4 * ZONE_TAPE_SIZE;
+
+  char *input = calloc(count * 32 + ZONE_BLOCK_SIZE, 1);
+  assert_non_null(input);
+  size_t length = 0;
+  for (size_t i=0; i < count; i++) {
+    const char *record = records[(i * 7 + i / 3) % 3];
+    // owner must be stated for the first record
+    if (i == 0)
+      record = records[0];
+    memcpy(input + length, record, strlen(record));
+    length += strlen(record);
+  }
+
+  zone_parser_t parser;
+  memset(&parser, 0, sizeof(parser));
+  zone_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.origin.octets = root;
+  options.origin.length = 1;
+  options.accept.callback = &count_a;
+  options.default_ttl = 3600;
+  options.default_class = 1;
+
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+
+  size_t accepted = 0;
+  int32_t code = zone_parse_string(
+    &parser, &options, &buffers, input, length, &accepted);
+  assert_int_equal(code, ZONE_SUCCESS);
+  assert_int_equal(accepted, count);
+
+  // unpadded input is scanned in place up to the tail
+  char *unpadded = malloc(length);
+  assert_non_null(unpadded);
+  memcpy(unpadded, input, length);
+  accepted = 0;
+  code = zone_parse_buffer(
+    &parser, &options, &buffers, unpadded, length, &accepted);
+  free(unpadded);
+  assert_int_equal(code, ZONE_SUCCESS);
+  assert_int_equal(accepted, count);
+
+  // regular files are mapped into memory if supported
+  char *path = get_tempnam(NULL, "xtape");
+  assert_non_null(path);
+  FILE *handle = fopen(path, "wb");
+  assert_non_null(handle);
+  size_t written = fwrite(input, 1, length, handle);
+  assert_int_equal(written, length);
+  (void)fclose(handle);
+  accepted = 0;
+  code = zone_parse(&parser, &options, &buffers, path, &accepted);
+  assert_int_equal(code, ZONE_SUCCESS);
+  assert_int_equal(accepted, count);
+
+  // files are read into the window if dropped from the page cache
+  options.no_page_cache = true;
+  accepted = 0;
+  code = zone_parse(&parser, &options, &buffers, path, &accepted);
+  remove(path);
+  assert_int_equal(code, ZONE_SUCCESS);
+  assert_int_equal(accepted, count);
+  free(path);
+  free(input);
+}
+
+static int32_t check_line(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  (void)owner;
+  (void)type;
+  (void)class;
+  (void)ttl;
+  (void)rdlength;
+  (void)rdata;
+
+  // each record spans two lines
+  size_t *count = user_data;
+  if (parser->file->line != 2 * *count + 1)
+    return ZONE_SYNTAX_ERROR;
+  *count += 1;
+  return 0;
+}
+
+/*!cmocka */
+void embedded_newlines_on_tape_boundary(void **state)
+{
+  // test if newlines in quoted strings are counted once if the tape is
+  // reused, line numbers were off for every record beyond the first tape
+
+  (void)state;
+
+  static const uint8_t root[1] = { 0 };
+  static const char record[] = "foo. TXT \"a\nb\"\n";
+  const size_t count = 2 * ZONE_TAPE_SIZE;
+
+  char *input = calloc(count * (sizeof(record) - 1) + ZONE_BLOCK_SIZE, 1);
+  assert_non_null(input);
+  size_t length = 0;
+  for (size_t i=0; i < count; i++) {
+    memcpy(input + length, record, sizeof(record) - 1);
+    length += sizeof(record) - 1;
+  }
+
+  zone_parser_t parser;
+  memset(&parser, 0, sizeof(parser));
+  zone_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.origin.octets = root;
+  options.origin.length = 1;
+  options.accept.callback = &check_line;
+  options.default_ttl = 3600;
+  options.default_class = 1;
+
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+
+  size_t accepted = 0;
+  int32_t code = zone_parse_string(
+    &parser, &options, &buffers, input, length, &accepted);
+  assert_int_equal(code, ZONE_SUCCESS);
+  assert_int_equal(accepted, count);
+  free(input);
+}
+
+/*!cmocka */
+void unpadded_tail(void **state)
+{
+  // test if input that is not null-terminated or padded is parsed the same
+  // as padded input regardless of where tokens are relative to the tail,
+  // which is copied. run with address sanitizer to detect reading past the
+  // end of the input
+
+  (void)state;
+
+  static const uint8_t root[1] = { 0 };
+  static const char *records[] = {
+    "foo. A 192.0.2.1\n",
+    "foo.                                            A 192.0.2.4 ; \"a\"\n",
+    "  A 192.0.2.2 ; comment\n",
+    "foo. A ( 192.0.2.3 )\n" };
+  const size_t count = 64;
+
+  char *input = calloc(count * 64 + ZONE_BLOCK_SIZE, 1);
+  assert_non_null(input);
+  size_t length = 0;
+  for (size_t i=0; i < count; i++) {
+    const char *record = records[i == 0 ? 0 : (i * 5) % 4];
+    memcpy(input + length, record, strlen(record));
+    length += strlen(record);
+  }
+
+  zone_parser_t parser;
+  memset(&parser, 0, sizeof(parser));
+  zone_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.origin.octets = root;
+  options.origin.length = 1;
+  options.accept.callback = &count_a;
+  options.default_ttl = 3600;
+  options.default_class = 1;
+  options.log.mask = ZONE_ERROR | ZONE_WARNING | ZONE_INFO;
+
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+
+  // cut input anywhere, including in the middle of tokens
+  for (size_t cut=1; cut <= length; cut++) {
+    char *padded = calloc(cut + 1 + ZONE_BLOCK_SIZE, 1);
+    char *unpadded = malloc(cut);
+    assert_non_null(padded);
+    assert_non_null(unpadded);
+    memcpy(padded, input, cut);
+    memcpy(unpadded, input, cut);
+
+    size_t expected = 0, accepted = 0;
+    int32_t expected_code = zone_parse_string(
+      &parser, &options, &buffers, padded, cut, &expected);
+    int32_t code = zone_parse_buffer(
+      &parser, &options, &buffers, unpadded, cut, &accepted);
+    free(padded);
+    free(unpadded);
+    assert_int_equal(code, expected_code);
+    assert_int_equal(accepted, expected);
+  }
+
+  free(input);
+}
@@ -0,0 +1,220 @@
+/*
+ * compression.c -- test transparent decompression of zone files
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "config.h"
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "zone.h"
+#include "tools.h"
+
+#if HAVE_ZLIB || HAVE_ZSTD
+static int32_t count_a(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  (void)parser;
+  (void)owner;
+  (void)class;
+  (void)ttl;
+  (void)rdata;
+
+  if (type != ZONE_TYPE_A || rdlength != 4)
+    return ZONE_SYNTAX_ERROR;
+  *((size_t *)user_data) += 1;
+  return 0;
+}
+
+static const size_t record_count = 20000;
+
+// generate records, compressed files are split at arbitrary offsets to
+// verify records that straddle members or frames are parsed correctly
+static char *generate_records(size_t *length)
+{
+  // longest record, "host19999.example. A 192.0.2.255\n", takes 33 bytes
+  const size_t size = record_count * 48;
+  char *text = malloc(size);
+  assert_non_null(text);
+  *length = 0;
+  for (size_t i=0; i < record_count; i++) {
+    const int count = snprintf(text + *length, size - *length,
+      "host%zu.example. A 192.0.2.%zu\n", i, i % 256);
+    assert_true(count > 0 && (size_t)count < size - *length);
+    *length += (size_t)count;
+  }
+  return text;
+}
+
+static int32_t parse_file(const char *path, uint32_t threads, size_t *count)
+{
+  static const uint8_t root[1] = { 0 };
+  zone_parser_t parser;
+  zone_options_t options;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+
+  memset(&parser, 0, sizeof(parser));
+  memset(&options, 0, sizeof(options));
+  options.origin.octets = root;
+  options.origin.length = 1;
+  options.accept.callback = &count_a;
+  options.default_ttl = 3600;
+  options.default_class = 1;
+  options.decompress_threads = threads;
+
+  *count = 0;
+  return zone_parse(&parser, &options, &buffers, path, count);
+}
+#endif
+
+/*!cmocka */
+void gzip_input(void **state)
+{
+  (void)state;
+#if !HAVE_ZLIB
+  skip();
+#else
+  size_t length, count;
+  char *text = generate_records(&length);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+
+  // write two members, gzip files may be concatenated
+  for (size_t i=0; i < 2; i++) {
+    const size_t half = length / 2 + 7;
+    gzFile handle = gzopen(path, i ? "ab" : "wb");
+    assert_non_null(handle);
+    assert_int_equal(
+      gzwrite(handle, text + i * half, (unsigned)(i ? length - half : half)),
+      (int)(i ? length - half : half));
+    assert_int_equal(gzclose(handle), Z_OK);
+  }
+
+  assert_int_equal(parse_file(path, 0, &count), ZONE_SUCCESS);
+  assert_int_equal(count, record_count);
+
+  // $INCLUDE of compressed files
+  char *includer_path = get_tempnam(NULL, "zone");
+  assert_non_null(includer_path);
+  char includer[512];
+  const int written = snprintf(includer, sizeof(includer),
+    "$INCLUDE \"%s\"\nfoo.example. A 192.0.2.1\n", path);
+  assert_true(written > 0 && (size_t)written < sizeof(includer));
+  write_file(includer_path, includer, (size_t)written);
+  assert_int_equal(parse_file(includer_path, 0, &count), ZONE_SUCCESS);
+  assert_int_equal(count, record_count + 1);
+  remove(includer_path);
+  free(includer_path);
+
+  // truncated files are read errors
+  FILE *handle = fopen(path, "rb");
+  assert_non_null(handle);
+  char *compressed = malloc(length);
+  assert_non_null(compressed);
+  const size_t size = fread(compressed, 1, length, handle);
+  (void)fclose(handle);
+  write_file(path, compressed, size - 9);
+  assert_int_equal(parse_file(path, 0, &count), ZONE_READ_ERROR);
+
+  remove(path);
+  free(compressed);
+  free(path);
+  free(text);
+#endif
+}
+
+/*!cmocka */
+void zstd_input(void **state)
+{
+  (void)state;
+#if !HAVE_ZSTD
+  skip();
+#else
+  size_t length, count;
+  char *text = generate_records(&length);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+
+  // split into frames, frames of multi-frame files are decompressed on
+  // worker threads if requested
+  const size_t frame_size = 4099;
+  const size_t bound = ZSTD_compressBound(frame_size);
+  const size_t frame_count = (length + frame_size - 1) / frame_size;
+  char *compressed = malloc(frame_count * bound);
+  assert_non_null(compressed);
+  size_t size = 0;
+  for (size_t i=0; i < length; i += frame_size) {
+    const size_t chunk = length - i < frame_size ? length - i : frame_size;
+    const size_t result =
+      ZSTD_compress(compressed + size, bound, text + i, chunk, 1);
+    assert_false(ZSTD_isError(result));
+    size += result;
+  }
+
+  write_file(path, compressed, size);
+  assert_int_equal(parse_file(path, 0, &count), ZONE_SUCCESS);
+  assert_int_equal(count, record_count);
+  assert_int_equal(parse_file(path, 4, &count), ZONE_SUCCESS);
+  assert_int_equal(count, record_count);
+
+  // truncated files are read errors
+  write_file(path, compressed, size - 5);
+  assert_int_equal(parse_file(path, 0, &count), ZONE_READ_ERROR);
+  assert_int_equal(parse_file(path, 4, &count), ZONE_READ_ERROR);
+
+  // frames that compress well decompress to many times the initial capacity
+  // of a frame slot, which must grow until the frame fits
+  static const char record[] = "foo.example. A 192.0.2.1\n";
+  const size_t repeat = 1024 * 1024;
+  const size_t large_length = repeat * (sizeof(record) - 1);
+  char *large = malloc(large_length);
+  assert_non_null(large);
+  for (size_t i=0; i < repeat; i++)
+    memcpy(large + i * (sizeof(record) - 1), record, sizeof(record) - 1);
+  const size_t large_bound = ZSTD_compressBound(large_length);
+  char *frames = malloc(large_bound + size);
+  assert_non_null(frames);
+  const size_t large_size =
+    ZSTD_compress(frames, large_bound, large, large_length, 19);
+  assert_false(ZSTD_isError(large_size));
+  assert_true(large_length > 16 * large_size);
+  assert_true(large_length > ZONE_WINDOW_SIZE);
+  memcpy(frames + large_size, compressed, size);
+
+  write_file(path, frames, large_size + size);
+  assert_int_equal(parse_file(path, 0, &count), ZONE_SUCCESS);
+  assert_int_equal(count, repeat + record_count);
+  assert_int_equal(parse_file(path, 4, &count), ZONE_SUCCESS);
+  assert_int_equal(count, repeat + record_count);
+
+  remove(path);
+  free(frames);
+  free(large);
+  free(compressed);
+  free(path);
+  free(text);
+#endif
+}
@@ -37,3 +37,38 @@ void test_fallback_leading_zeroes(void **state)
     assert_int_equal(lz, 63 - shift);
   }
 }
+
+void test_fallback_prefix_xor(void **state)
+{
+  (void)state;
+  fprintf(stderr, "test_fallback_prefix_xor\n");
+  // "0001 0001 0000 0101 0000 0110 0000 0000"
+  uint64_t mask =
+    (1llu << 28) | (1llu << 24) |
+    (1llu << 18) | (1llu << 16) |
+    (1llu << 10) | (1llu <<  9);
+  // "0000 1111 0000 0011 0000 0010 0000 0000"
+  uint64_t prefix_mask =
+    (1llu << 27) | (1llu << 26) | (1llu << 25) | (1llu << 24) |
+    (1llu << 17) | (1llu << 16) |
+    (1llu <<  9);
+
+  assert_int_equal(prefix_xor(mask), prefix_mask);
+}
+
+void test_fallback_add_overflow(void **state)
+{
+  (void)state;
+  fprintf(stderr, "test_fallback_add_overflow\n");
+  uint64_t all_ones = UINT64_MAX;
+  uint64_t result = 0;
+  uint64_t overflow = add_overflow(all_ones, 2llu, &result);
+  assert_int_equal(result, 1llu);
+  assert_true(overflow);
+  overflow = add_overflow(all_ones, 1llu, &result);
+  assert_int_equal(result, 0llu);
+  assert_true(overflow);
+  overflow = add_overflow(all_ones, 0llu, &result);
+  assert_int_equal(result, all_ones);
+  assert_false(overflow);
+}
@@ -0,0 +1,248 @@
+/*
+ * indexer.c -- test Ice Lake specific index writer
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdarg.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "attributes.h"
+#include "diagnostic.h"
+#include "icelake/simd.h"
+#include "generic/endian.h"
+#include "icelake/bits.h"
+#include "generic/parser.h"
+#include "generic/scanner.h"
+#include "icelake/indexer.h"
+
+// tapes take up too much space for the stack
+static zone_parser_t parser;
+static zone_file_t file;
+
+static void initialize_file(const char *data, size_t length, bool end_of_file)
+{
+  memset(&file, 0, sizeof(file));
+  file.end_of_file = end_of_file ? READ_ALL_DATA : 0;
+  file.buffer.data = (char *)data;
+  file.buffer.length = length;
+  file.buffer.size = length;
+  file.fields.head = file.fields.tail = file.fields.tape;
+  file.delimiters.head = file.delimiters.tail = file.delimiters.tape;
+  file.newlines.head = file.newlines.tail = file.newlines.tape;
+  parser.file = &file;
+}
+
+static bool is_contiguous_octet(char c)
+{
+  return !strchr(" \t\r()\n", c);
+}
+
+// input is limited to contiguous characters, blanks, parentheses and
+// newlines, i.e. no quotes, comments or escapes. tokens are delimited by
+// the first non-contiguous character, the delimiter of a contiguous token
+// at the end of the input is implied
+static void assert_tapes(
+  const char *data,
+  size_t from,
+  size_t to,
+  const char **fields,
+  const char **delimiters)
+{
+  for (size_t i=from; i < to; i++) {
+    const bool special = strchr("()\n", data[i]) != NULL;
+    const bool contiguous = is_contiguous_octet(data[i]);
+    const bool follows_contiguous = i && is_contiguous_octet(data[i-1]);
+    if (special || (contiguous && !follows_contiguous)) {
+      assert_true(*fields == &data[i]);
+      fields++;
+    }
+    if (!contiguous && follows_contiguous) {
+      assert_true(*delimiters == &data[i]);
+      delimiters++;
+    }
+  }
+
+  assert_true(fields == file.fields.tail);
+  assert_true(delimiters == file.delimiters.tail);
+}
+
+// generate blocks with exactly fields[n] fields in block n. tokens are one
+// or more characters, contiguous tokens may span blocks
+static char *generate_blocks(const size_t *fields, size_t count, size_t *length)
+{
+  char *data;
+  const size_t size = count * ZONE_BLOCK_SIZE;
+
+  if (!(data = malloc(size + ZONE_BLOCK_SIZE)))
+    return NULL;
+  // input is padded, but garbage beyond the end must not be indexed
+  memset(data + size, 'x', ZONE_BLOCK_SIZE);
+
+  for (size_t block=0; block < count; block++) {
+    char *octets = data + block * ZONE_BLOCK_SIZE;
+    bool starts[ZONE_BLOCK_SIZE] = { 0 };
+    for (size_t n=0; n < fields[block]; ) {
+      const size_t position = (size_t)rand() % ZONE_BLOCK_SIZE;
+      n += !starts[position];
+      starts[position] = true;
+    }
+
+    for (size_t i=0; i < ZONE_BLOCK_SIZE; i++) {
+      const char previous = (block || i) ? octets[(ptrdiff_t)i - 1] : ' ';
+      if (starts[i]) {
+        // contiguous characters following a contiguous token extend it
+        static const char specials[] = "()\na";
+        octets[i] = specials[(size_t)rand() % (is_contiguous_octet(previous) ? 3 : 4)];
+      } else {
+        static const char blanks[] = " \tb";
+        octets[i] = blanks[(size_t)rand() % (is_contiguous_octet(previous) ? 3 : 2)];
+      }
+    }
+  }
+
+  *length = size;
+  return data;
+}
+
+void test_icelake_many_fields(void **state)
+{
+  (void)state;
+
+  // blocks with no more than eight fields take the fast path, vpcompressb
+  // writes up to seven indexes beyond the count
+  size_t counts[ZONE_BLOCK_SIZE + 1];
+  const size_t count = sizeof(counts)/sizeof(counts[0]);
+  for (size_t i=0; i < count; i++)
+    counts[i] = i;
+  for (size_t i=count - 1; i > 0; i--) {
+    const size_t j = (size_t)rand() % (i + 1);
+    const size_t swap = counts[i];
+    counts[i] = counts[j];
+    counts[j] = swap;
+  }
+
+  size_t length;
+  char *data = generate_blocks(counts, count, &length);
+  assert_non_null(data);
+
+  initialize_file(data, length, false);
+  assert_int_equal(reindex(&parser), is_contiguous_octet(data[length - 1]));
+  assert_int_equal(file.buffer.index, length);
+  assert_tapes(data, 0, length, file.fields.tape, file.delimiters.tape);
+
+  // fields are written in order, verify the count for each block
+  const char **fields = file.fields.tape;
+  for (size_t block=0; block < count; block++) {
+    const char *limit = data + (block + 1) * ZONE_BLOCK_SIZE;
+    size_t n = 0;
+    for (; fields < file.fields.tail && *fields < limit; fields++)
+      n++;
+    assert_int_equal(n, counts[block]);
+  }
+
+  free(data);
+}
+
+void test_icelake_partial_block(void **state)
+{
+  (void)state;
+
+  for (size_t length=1; length < 3 * ZONE_BLOCK_SIZE; length++) {
+    const size_t counts[3] = {
+      (size_t)rand() % (ZONE_BLOCK_SIZE + 1),
+      (size_t)rand() % (ZONE_BLOCK_SIZE + 1),
+      (size_t)rand() % (ZONE_BLOCK_SIZE + 1) };
+    size_t size;
+    char *data = generate_blocks(counts, 3, &size);
+    assert_non_null(data);
+    // garbage beyond the end of the input must not be indexed
+    memset(data + length, 'x', size - length);
+
+    // partial block is not indexed until all data is read
+    const size_t index = length - (length % ZONE_BLOCK_SIZE);
+    initialize_file(data, length, false);
+    assert_int_equal(reindex(&parser),
+                     index && is_contiguous_octet(data[index - 1]));
+    assert_int_equal(file.buffer.index, index);
+    assert_int_equal(file.end_of_file, 0);
+    assert_tapes(data, 0, index, file.fields.tape, file.delimiters.tape);
+
+    // contiguous token at the end of the input is terminated
+    initialize_file(data, length, true);
+    assert_int_equal(reindex(&parser), 0);
+    assert_int_equal(file.buffer.index, length);
+    assert_int_equal(file.end_of_file, NO_MORE_DATA);
+    assert_tapes(data, 0, length, file.fields.tape, file.delimiters.tape);
+
+    free(data);
+  }
+}
+
+void test_icelake_full_tape(void **state)
+{
+  (void)state;
+
+  // blocks with a field count that is not a multiple of eight write past
+  // the last index, the tape may start with a partial token
+  static const size_t fields[] = { ZONE_BLOCK_SIZE, ZONE_BLOCK_SIZE - 7, 57 };
+  static const size_t offsets[] = { 0, 1, 7 };
+  const size_t blocks = 2 * ZONE_TAPE_SIZE / ZONE_BLOCK_SIZE;
+
+  for (size_t f=0; f < sizeof(fields)/sizeof(fields[0]); f++) {
+    for (size_t o=0; o < sizeof(offsets)/sizeof(offsets[0]); o++) {
+      size_t *counts = malloc(blocks * sizeof(*counts));
+      assert_non_null(counts);
+      for (size_t i=0; i < blocks; i++)
+        counts[i] = fields[f];
+
+      size_t length;
+      char *data = generate_blocks(counts, blocks, &length);
+      assert_non_null(data);
+      free(counts);
+
+      initialize_file(data, length, true);
+      const char *sentinel = "sentinel";
+
+      size_t from = 0;
+      while (file.buffer.index < length) {
+        file.fields.tape[ZONE_TAPE_SIZE] = sentinel;
+        file.fields.tape[ZONE_TAPE_SIZE + 1] = sentinel;
+        file.delimiters.tape[ZONE_TAPE_SIZE] = sentinel;
+        file.newlines.tape[0] = 0;
+        file.fields.tail = file.fields.tape + offsets[o];
+        file.delimiters.tail = file.delimiters.tape;
+        file.newlines.tail = file.newlines.tape;
+
+        const int32_t contiguous = reindex(&parser);
+
+        // indexer stops before the tape overflows, but does fill it up
+        assert_true(file.buffer.index > from);
+        assert_int_equal(contiguous, file.buffer.index < length &&
+                         is_contiguous_octet(data[file.buffer.index - 1]));
+        assert_int_equal(file.buffer.index % ZONE_BLOCK_SIZE, 0);
+        assert_true(file.fields.tail <= file.fields.tape + ZONE_TAPE_SIZE);
+        if (file.buffer.index < length)
+          assert_true(file.fields.tail + ZONE_BLOCK_SIZE >
+                      file.fields.tape + ZONE_TAPE_SIZE);
+        assert_true(file.fields.tape[ZONE_TAPE_SIZE] == sentinel);
+        assert_true(file.fields.tape[ZONE_TAPE_SIZE + 1] == sentinel);
+        assert_true(file.delimiters.tape[ZONE_TAPE_SIZE] == sentinel);
+        assert_tapes(data, from, file.buffer.index,
+                     file.fields.tape + offsets[o], file.delimiters.tape);
+        from = file.buffer.index;
+      }
+
+      assert_int_equal(file.end_of_file, NO_MORE_DATA);
+      free(data);
+    }
+  }
+}
@@ -0,0 +1,306 @@
+/*
+ * includes.c -- test parsing included files on multiple threads
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "tools.h"
+
+#define MAXIMUM_THREADS (4)
+#define INCLUDES (24)
+
+static int32_t parse_file(
+  result_t *result, const char *path, size_t threads, bool ordered)
+{
+  zone_parser_t parser;
+  zone_options_t options;
+  zone_buffers_t buffers;
+  int32_t code;
+
+  memset(result, 0, sizeof(*result));
+  result->threads = threads;
+  result->ordered = ordered || threads == 1;
+  initialize_options(&options);
+  options.accept.callback = &hash_chunk_rr;
+  options.log.callback = &log_chunk_line;
+
+  buffers.size = threads;
+  buffers.owner = malloc(threads * sizeof(*buffers.owner));
+  buffers.rdata = malloc(threads * sizeof(*buffers.rdata));
+  assert_non_null(buffers.owner);
+  assert_non_null(buffers.rdata);
+  code = zone_parse_includes(
+    &parser, &options, &buffers, path, threads, ordered, result);
+  free(buffers.owner);
+  free(buffers.rdata);
+  return code;
+}
+
+// records that omit owner, TTL and class so that the origin, TTL and class
+// in effect at the $INCLUDE entry show in the records of the included file
+static void write_include(const char *path, size_t number, const char *nested)
+{
+  const size_t count = 1000 + number * 100;
+  char *text = malloc(count * 128 + 1024);
+  assert_non_null(text);
+
+  char *line = text;
+  for (size_t i=0; i < count; i++) {
+    if (i == 0)
+      line += sprintf(line, "@ TXT \"top of include %zu\"\n", number);
+    if (i == count / 2 && nested)
+      line += sprintf(line, "$INCLUDE \"%s\"\n", nested);
+    if (i % 3 == 0)
+      line += sprintf(line, "host%zu A 192.0.2.%zu\n", i, i % 256);
+    else if (i % 3 == 1)
+      line += sprintf(line, "  AAAA 2001:db8::%zx\n", i);
+    else
+      line += sprintf(line, "text%zu TXT \"include %zu\nline %zu\"\n",
+        i, number, i);
+  }
+
+  write_file(path, text, (size_t)(line - text));
+  free(text);
+}
+
+static char *generate_top_level(size_t *length, char *includes[INCLUDES])
+{
+  const size_t count = 20000;
+  char *text = malloc(count * 128 + INCLUDES * 1024);
+  assert_non_null(text);
+  char *line = text;
+
+  for (size_t i=0; i < count; i++) {
+    if (i % (count / INCLUDES) == 0 && i / (count / INCLUDES) < INCLUDES) {
+      const size_t number = i / (count / INCLUDES);
+      if (number % 4 == 1)
+        line += sprintf(line, "$TTL %zu\n", 300 + number);
+      if (number % 4 == 2)
+        line += sprintf(line, "ch%zu CH TXT \"chaos\"\n", number);
+      if (number % 3 == 0)
+        line += sprintf(line, "$INCLUDE \"%s\" sub%zu.example.com.\n",
+          includes[number], number);
+      else
+        line += sprintf(line, "$INCLUDE %s\n", includes[number]);
+      if (number % 4 == 2)
+        line += sprintf(line, "in%zu IN TXT \"in\"\n", number);
+    }
+    if (i % 5000 == 4999)
+      line += sprintf(line, "$ORIGIN zone%zu.example.com.\n", i);
+    if (i % 2 == 0)
+      line += sprintf(line, "host%zu %zu A 192.0.2.%zu\n", i, i % 7200, i % 256);
+    else
+      line += sprintf(line, "  AAAA 2001:db8::%zx\n", i);
+  }
+
+  *length = (size_t)(line - text);
+  return text;
+}
+
+static void create_includes(char *includes[INCLUDES], const char *nested)
+{
+  for (size_t i=0; i < INCLUDES; i++) {
+    includes[i] = get_tempnam(NULL, "zone");
+    assert_non_null(includes[i]);
+    write_include(includes[i], i, i == 5 ? nested : NULL);
+  }
+}
+
+static void remove_includes(char *includes[INCLUDES])
+{
+  for (size_t i=0; i < INCLUDES; i++) {
+    remove(includes[i]);
+    free(includes[i]);
+  }
+}
+
+/*!cmocka */
+void includes_records(void **state)
+{
+  (void)state;
+
+  char *nested = get_tempnam(NULL, "zone");
+  assert_non_null(nested);
+  write_include(nested, INCLUDES, NULL);
+  char *includes[INCLUDES];
+  create_includes(includes, nested);
+
+  size_t length;
+  char *text = generate_top_level(&length, includes);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  write_file(path, text, length);
+
+  static result_t expected, result;
+  assert_int_equal(parse_file(&expected, path, 1, false), ZONE_SUCCESS);
+  assert_true(expected.chunks[0].count > 40000);
+
+  // included files are chunks of their own, chunks follow the entries. the
+  // first include is at the top of the file, the first chunk is empty
+  for (size_t threads=2; threads <= MAXIMUM_THREADS; threads++) {
+    assert_int_equal(parse_file(&result, path, threads, false), ZONE_SUCCESS);
+    assert_same_chunks(&expected, &result);
+    assert_int_equal(result.chunks[2 * INCLUDES + 1].count, 0);
+    for (size_t i=1; i <= 2 * INCLUDES; i++)
+      assert_true(result.chunks[i].count > 0);
+    release_result(&result);
+  }
+
+  // records are delivered in order of a sequential parse
+  for (size_t threads=2; threads <= MAXIMUM_THREADS; threads++) {
+    assert_int_equal(parse_file(&result, path, threads, true), ZONE_SUCCESS);
+    assert_false(result.out_of_order);
+    assert_int_equal(result.records.count, expected.chunks[0].count);
+    for (size_t i=0; i < expected.chunks[0].count; i++)
+      assert_true(result.records.hashes[i] == expected.chunks[0].hashes[i]);
+    release_result(&result);
+  }
+
+  release_result(&expected);
+  remove(path);
+  free(path);
+  free(text);
+  remove_includes(includes);
+  remove(nested);
+  free(nested);
+}
+
+/*!cmocka */
+void includes_errors(void **state)
+{
+  (void)state;
+
+  char *includes[INCLUDES];
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+
+  // errors in included files are reported on the right line
+  char *nested = get_tempnam(NULL, "zone");
+  assert_non_null(nested);
+  static const char error[] = "foo A 192.0.2.1\nerror A 192.0.2\n";
+  write_file(nested, error, sizeof(error) - 1);
+  create_includes(includes, nested);
+
+  size_t length;
+  char *text = generate_top_level(&length, includes);
+  write_file(path, text, length);
+  free(text);
+
+  static result_t expected, result;
+  for (size_t i=0; i < 2; i++) {
+    const bool ordered = i != 0;
+    assert_int_equal(parse_file(&expected, path, 1, ordered), ZONE_SYNTAX_ERROR);
+    assert_int_equal(expected.error_line, 2);
+    assert_int_equal(parse_file(&result, path, 3, ordered), ZONE_SYNTAX_ERROR);
+    assert_int_equal(result.error_line, 2);
+    release_result(&expected);
+    release_result(&result);
+  }
+
+  // circular includes are detected across threads
+  write_file(nested, "", 0);
+  text = malloc(256 + strlen(path));
+  assert_non_null(text);
+  length = (size_t)sprintf(text, "foo A 192.0.2.1\n$INCLUDE %s\n", path);
+  write_file(nested, text, length);
+  free(text);
+  assert_int_equal(
+    parse_file(&result, path, 1, false), ZONE_SEMANTIC_ERROR);
+  release_result(&result);
+  assert_int_equal(
+    parse_file(&result, path, 3, false), ZONE_SEMANTIC_ERROR);
+  release_result(&result);
+
+  // missing files are reported by the top-level parser
+  remove_includes(includes);
+  write_file(nested, "", 0);
+  create_includes(includes, nested);
+  text = generate_top_level(&length, includes);
+  write_file(path, text, length);
+  free(text);
+  remove(includes[INCLUDES / 2]);
+  assert_int_equal(
+    parse_file(&expected, path, 1, true), ZONE_NOT_A_FILE);
+  assert_int_equal(
+    parse_file(&result, path, 3, true), ZONE_NOT_A_FILE);
+  assert_int_equal(result.error_line, expected.error_line);
+  assert_int_equal(result.records.count, expected.records.count);
+  release_result(&expected);
+  release_result(&result);
+
+  remove_includes(includes);
+  remove(nested);
+  free(nested);
+  remove(path);
+  free(path);
+}
+
+// hosts, optionally followed by a syntax error
+static void write_hosts(const char *path, size_t count, bool error)
+{
+  char *text = malloc(count * 32 + 32);
+  assert_non_null(text);
+  char *line = text;
+  for (size_t i=0; i < count; i++)
+    line += sprintf(line, "host%zu A 192.0.2.%zu\n", i, i % 256);
+  if (error)
+    line += sprintf(line, "error A 192.0.2\n");
+  write_file(path, text, (size_t)(line - text));
+  free(text);
+}
+
+/*!cmocka */
+void includes_unordered_errors(void **state)
+{
+  (void)state;
+
+  // included files that follow a file that failed are abandoned, even if
+  // records are not delivered in order. the file that fails is large enough
+  // for the next file to be claimed before it fails
+  const size_t count = 10000, big_count = 200000;
+  char *bad = get_tempnam(NULL, "zone");
+  assert_non_null(bad);
+  write_hosts(bad, count, true);
+  char *big = get_tempnam(NULL, "zone");
+  assert_non_null(big);
+  write_hosts(big, big_count, false);
+
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  char *text = malloc(strlen(bad) + strlen(big) + 64);
+  assert_non_null(text);
+  const int length =
+    sprintf(text, "$INCLUDE \"%s\"\n$INCLUDE \"%s\"\n", bad, big);
+  write_file(path, text, (size_t)length);
+  free(text);
+
+  static result_t expected, result;
+  assert_int_equal(parse_file(&expected, path, 1, false), ZONE_SYNTAX_ERROR);
+  assert_int_equal(expected.chunks[0].count, count);
+  for (size_t i=0; i < 2; i++) {
+    const bool ordered = i != 0;
+    assert_int_equal(parse_file(&result, path, 3, ordered), ZONE_SYNTAX_ERROR);
+    assert_int_equal(result.error_line, count + 1);
+    assert_int_equal(result.chunks[1].count, count);
+    assert_true(result.chunks[3].count < big_count / 2);
+    release_result(&result);
+  }
+
+  release_result(&expected);
+  remove(path);
+  free(path);
+  remove(big);
+  free(big);
+  remove(bad);
+  free(bad);
+}
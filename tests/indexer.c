@@ -0,0 +1,66 @@
+/*
+ * indexer.c -- test kernel specific index writers
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdarg.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <cmocka.h>
+
+#include "config.h"
+#include "attributes.h"
+#include "isadetection.h"
+
+#if HAVE_ICELAKE
+extern void test_icelake_many_fields(void **);
+extern void test_icelake_partial_block(void **);
+extern void test_icelake_full_tape(void **);
+
+// tests are compiled for Ice Lake, but the host may not support AVX-512.
+// this file is not, so the instruction set can be detected safely
+static void test_icelake(void (*test)(void **), void **state)
+{
+  const uint32_t instruction_set = AVX512F|AVX512BW|AVX512VL|AVX512VBMI2;
+  if ((detect_supported_architectures() & instruction_set) != instruction_set)
+    skip();
+  test(state);
+}
+#endif
+
+/*!cmocka */
+void icelake_many_fields(void **state)
+{
+#if !HAVE_ICELAKE
+  (void)state;
+  skip();
+#else
+  test_icelake(&test_icelake_many_fields, state);
+#endif
+}
+
+/*!cmocka */
+void icelake_partial_block(void **state)
+{
+#if !HAVE_ICELAKE
+  (void)state;
+  skip();
+#else
+  test_icelake(&test_icelake_partial_block, state);
+#endif
+}
+
+/*!cmocka */
+void icelake_full_tape(void **state)
+{
+#if !HAVE_ICELAKE
+  (void)state;
+  skip();
+#else
+  test_icelake(&test_icelake_full_tape, state);
+#endif
+}
@@ -0,0 +1,240 @@
+/*
+ * index.c -- test parsing ranges of a file using an index of checkpoints
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "tools.h"
+
+static int32_t parse_file(list_t *list, const char *path)
+{
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  initialize_options(&options);
+  options.accept.callback = &hash_rr;
+  options.log.callback = &log_list_line;
+  return zone_parse(&parser, &options, &buffers, path, list);
+}
+
+static int32_t build_index(
+  list_t *list, const char *path, size_t interval, zone_index_t *index)
+{
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  initialize_options(&options);
+  options.accept.callback = &hash_rr;
+  options.log.callback = &log_list_line;
+  return zone_build_index(
+    &parser, &options, &buffers, path, interval, index, list);
+}
+
+static int32_t parse_range(
+  list_t *list, const char *path, const zone_index_t *index, size_t from, size_t to)
+{
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  // origin, TTL and class are restored from the index
+  initialize_options(&options);
+  options.accept.callback = &hash_rr;
+  options.log.callback = &log_list_line;
+  options.default_ttl = 1;
+  options.default_class = ZONE_CLASS_CH;
+  return zone_parse_range(
+    &parser, &options, &buffers, path, index, from, to, list);
+}
+
+/*!cmocka */
+void index_ranges(void **state)
+{
+  (void)state;
+
+  size_t length;
+  char *text = generate_zone(&length, 20000, NULL);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  write_file(path, text, length);
+
+  list_t expected = { 0 }, list = { 0 };
+  assert_int_equal(parse_file(&expected, path), ZONE_SUCCESS);
+
+  // records are delivered while the index is built
+  zone_index_t index;
+  assert_int_equal(build_index(&list, path, 16384, &index), ZONE_SUCCESS);
+  assert_same_list(&expected, &list);
+  release_list(&list);
+  assert_true(index.count > 8);
+  assert_int_equal(index.length, length);
+  assert_int_equal(index.checkpoints[0].offset, 0);
+  for (size_t i=1; i < index.count; i++)
+    assert_true(text[index.checkpoints[i].offset - 1] == '\n');
+
+  // ranges put back in order yield the records of the file
+  for (size_t i=0; i < index.count; i++)
+    assert_int_equal(
+      parse_range(&list, path, &index, i, i + 1), ZONE_SUCCESS);
+  assert_same_list(&expected, &list);
+  release_list(&list);
+
+  assert_int_equal(
+    parse_range(&list, path, &index, 0, index.count), ZONE_SUCCESS);
+  assert_same_list(&expected, &list);
+  release_list(&list);
+
+  // index survives a round trip through a file
+  char *index_path = get_tempnam(NULL, "index");
+  assert_non_null(index_path);
+  zone_index_t copy;
+  assert_int_equal(zone_write_index(&index, index_path), ZONE_SUCCESS);
+  assert_int_equal(zone_read_index(&copy, index_path), ZONE_SUCCESS);
+  assert_int_equal(copy.length, index.length);
+  assert_int_equal(copy.interval, index.interval);
+  assert_int_equal(copy.count, index.count);
+  for (size_t i=0; i < index.count; i++) {
+    const zone_checkpoint_t *a = &index.checkpoints[i], *b = &copy.checkpoints[i];
+    assert_int_equal(a->offset, b->offset);
+    assert_int_equal(a->line, b->line);
+    assert_int_equal(a->last_ttl, b->last_ttl);
+    assert_int_equal(a->dollar_ttl, b->dollar_ttl);
+    assert_int_equal(a->use_dollar_ttl, b->use_dollar_ttl);
+    assert_int_equal(a->last_class, b->last_class);
+    assert_int_equal(a->origin.length, b->origin.length);
+    assert_memory_equal(a->origin.octets, b->origin.octets, a->origin.length);
+    assert_int_equal(a->owner.length, b->owner.length);
+    assert_memory_equal(a->owner.octets, b->owner.octets, a->owner.length);
+  }
+
+  for (size_t i=copy.count; i > 0; i--)
+    assert_int_equal(
+      parse_range(&list, path, &copy, i - 1, i), ZONE_SUCCESS);
+  assert_int_equal(list.count, expected.count);
+  release_list(&list);
+
+  zone_free_index(&copy);
+  zone_free_index(&index);
+  release_list(&expected);
+  remove(index_path);
+  free(index_path);
+  remove(path);
+  free(path);
+  free(text);
+}
+
+/*!cmocka */
+void index_errors(void **state)
+{
+  (void)state;
+
+  size_t length;
+  char *text = generate_zone(&length, 20000, NULL);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  write_file(path, text, length);
+
+  list_t expected = { 0 }, list = { 0 };
+  zone_index_t index;
+  assert_int_equal(build_index(&list, path, 16384, &index), ZONE_SUCCESS);
+  release_list(&list);
+
+  assert_int_equal(
+    parse_range(&list, path, &index, 1, 1), ZONE_BAD_PARAMETER);
+  assert_int_equal(
+    parse_range(&list, path, &index, 0, index.count + 1), ZONE_BAD_PARAMETER);
+
+  // errors in a range are reported on the right line
+  char *address = strstr(text + length / 2, "192.0.2.");
+  assert_non_null(address);
+  address[7] = 'x';
+  write_file(path, text, length);
+  assert_int_equal(parse_file(&expected, path), ZONE_SYNTAX_ERROR);
+  assert_true(expected.error_line > 1);
+  size_t errors = 0;
+  for (size_t i=0; i < index.count; i++) {
+    list_t range = { 0 };
+    if (parse_range(&range, path, &index, i, i + 1) != ZONE_SUCCESS) {
+      assert_int_equal(range.error_line, expected.error_line);
+      errors++;
+    }
+    release_list(&range);
+  }
+  assert_int_equal(errors, 1);
+  release_list(&expected);
+
+  // index is rejected for a file of a different length
+  write_file(path, text, length - 1);
+  assert_int_equal(
+    parse_range(&list, path, &index, 0, 1), ZONE_BAD_PARAMETER);
+
+  // files that are not an index are rejected
+  char *index_path = get_tempnam(NULL, "index");
+  assert_non_null(index_path);
+  zone_index_t copy;
+  write_file(index_path, text, 64);
+  assert_int_equal(zone_read_index(&copy, index_path), ZONE_BAD_PARAMETER);
+  assert_int_equal(zone_write_index(&index, index_path), ZONE_SUCCESS);
+  FILE *handle = fopen(index_path, "rb");
+  assert_non_null(handle);
+  char data[65536];
+  const size_t size = fread(data, 1, sizeof(data), handle);
+  (void)fclose(handle);
+  assert_true(size > 1 && size < sizeof(data));
+  write_file(index_path, data, size - 1);
+  assert_int_equal(zone_read_index(&copy, index_path), ZONE_BAD_PARAMETER);
+
+  zone_free_index(&index);
+  remove(index_path);
+  free(index_path);
+  remove(path);
+  free(path);
+  free(text);
+}
+
+/*!cmocka */
+void index_blank_after_quoted_newline(void **state)
+{
+  (void)state;
+
+  // line that starts with a blank after a quoted section that spans lines
+  // inherits the owner and is not the start of an entry
+  static const char inherited[] =
+    "a IN TXT \"x\ny\"\n"
+    "  IN A 192.0.2.4\n";
+  static const char stated[] =
+    "a IN TXT \"x\ny\"\n"
+    "a IN A 192.0.2.4\n";
+
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  list_t expected = { 0 }, list = { 0 };
+  write_file(path, stated, sizeof(stated) - 1);
+  assert_int_equal(parse_file(&expected, path), ZONE_SUCCESS);
+  write_file(path, inherited, sizeof(inherited) - 1);
+  assert_int_equal(parse_file(&list, path), ZONE_SUCCESS);
+  assert_same_list(&expected, &list);
+
+  release_list(&list);
+  release_list(&expected);
+  remove(path);
+  free(path);
+}
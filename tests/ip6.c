@@ -0,0 +1,319 @@
+/*
+ * ip6.c -- test IPv6 support
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdarg.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdio.h>
+#include <cmocka.h>
+#if !_WIN32
+#include <arpa/inet.h>
+#endif
+
+#include "zone.h"
+
+static int32_t add_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  (void)parser;
+  (void)owner;
+  (void)type;
+  (void)class;
+  (void)ttl;
+  (void)rdata;
+  (void)user_data;
+  if (rdlength != 16)
+    return ZONE_SYNTAX_ERROR;
+  return ZONE_SUCCESS;
+}
+
+static uint8_t origin[] =
+  { 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0 };
+
+static int32_t parse_aaaa(const char *address, uint8_t octets[16])
+{
+  char rr[128];
+  zone_parser_t parser;
+  zone_name_buffer_t name;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &name, &rdata };
+  zone_options_t options;
+  int32_t result;
+
+  memset(rr, 0, sizeof(rr));
+  (void)snprintf(rr, sizeof(rr), "foo. AAAA %s", address);
+
+  memset(&options, 0, sizeof(options));
+  options.accept.callback = add_rr;
+  options.origin.octets = origin;
+  options.origin.length = sizeof(origin);
+  options.default_ttl = 3600;
+  options.default_class = ZONE_CLASS_IN;
+
+  result = zone_parse_string(&parser, &options, &buffers, rr, strlen(rr), NULL);
+  if (result == ZONE_SUCCESS)
+    memcpy(octets, rdata.octets, 16);
+  return result;
+}
+
+/*!cmocka */
+void ipv6_syntax(void **state)
+{
+  static const uint8_t address_2001_db8__1[16] = {
+    0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01 };
+  static const uint8_t address__ffff_192_0_2_1[16] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 192, 0, 2, 1 };
+  static const uint8_t address_1_8[16] = {
+    0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0, 7, 0, 8 };
+  static const uint8_t address_any[16] = { 0 };
+  static const struct {
+    int32_t result;
+    const char *address;
+    const uint8_t *octets;
+  } tests[] = {
+    { ZONE_SUCCESS, "2001:db8::1", address_2001_db8__1 },
+    { ZONE_SUCCESS, "2001:DB8::1", address_2001_db8__1 },
+    { ZONE_SUCCESS, "2001:0db8:0000:0000:0000:0000:0000:0001", address_2001_db8__1 },
+    { ZONE_SUCCESS, "2001:db8:0:0:0:0:0:1", address_2001_db8__1 },
+    { ZONE_SUCCESS, "::ffff:192.0.2.1", address__ffff_192_0_2_1 },
+    { ZONE_SUCCESS, "0:0:0:0:0:ffff:192.0.2.1", address__ffff_192_0_2_1 },
+    { ZONE_SUCCESS, "1:2:3:4:5:6:7:8", address_1_8 },
+    { ZONE_SUCCESS, "1:2:3:4:5:6:0.7.0.8", address_1_8 },
+    { ZONE_SUCCESS, "::", address_any },
+    // leading zeroes beyond four digits are accepted (historic behavior)
+    { ZONE_SUCCESS, "2001:db8::00001", address_2001_db8__1 },
+    // bad number of groups
+    { ZONE_SYNTAX_ERROR, "1:2:3:4:5:6:7", NULL },
+    { ZONE_SYNTAX_ERROR, "1:2:3:4:5:6:7:8:9", NULL },
+    { ZONE_SYNTAX_ERROR, "1:2:3:4:5:6:7:1.2.3.4", NULL },
+    { ZONE_SYNTAX_ERROR, "1:2:3:4:5:1.2.3.4", NULL },
+    // bad number of colons
+    { ZONE_SYNTAX_ERROR, ":1:2:3:4:5:6:7", NULL },
+    { ZONE_SYNTAX_ERROR, "1::2::3", NULL },
+    { ZONE_SYNTAX_ERROR, "1:::2", NULL },
+    { ZONE_SYNTAX_ERROR, ":::", NULL },
+    { ZONE_SYNTAX_ERROR, "2001:db8::1:", NULL },
+    { ZONE_SYNTAX_ERROR, "1:2:3:4::5:6:7:8", NULL },
+    { ZONE_SYNTAX_ERROR, "1:2:3:4:5:6::192.0.2.1", NULL },
+    // bad groups
+    { ZONE_SYNTAX_ERROR, "2001:db8::10000", NULL },
+    { ZONE_SYNTAX_ERROR, "2001:db8::g", NULL },
+    { ZONE_SYNTAX_ERROR, "2001:db8::1.", NULL },
+    { ZONE_SYNTAX_ERROR, "::ffff:192.0.2.256", NULL },
+    { ZONE_SYNTAX_ERROR, "::ffff:192.0.2", NULL },
+    { ZONE_SYNTAX_ERROR, "::ffff:192.0.2.1.", NULL },
+    { ZONE_SYNTAX_ERROR, "::192.0.2.1:1", NULL }
+  };
+
+  (void)state;
+
+  for (size_t i=0, n=sizeof(tests)/sizeof(tests[0]); i < n; i++) {
+    uint8_t octets[16];
+    int32_t result;
+
+    fprintf(stderr, "INPUT: %s\n", tests[i].address);
+    result = parse_aaaa(tests[i].address, octets);
+    assert_int_equal(result, tests[i].result);
+    if (tests[i].octets)
+      assert_memory_equal(octets, tests[i].octets, 16);
+  }
+}
+
+static uint64_t next(uint64_t *seed)
+{
+  // xorshift64
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+// print groups, optionally compressing the range of groups from start to
+// end and optionally embedding an IPv4 address in the last two groups
+static void print_ip6(
+  char *text, const uint8_t octets[16], size_t start, size_t end, bool ip4, bool upper, bool pad)
+{
+  const size_t groups = ip4 ? 6 : 8;
+  const char *format = pad ? (upper ? "%04X" : "%04x") : (upper ? "%X" : "%x");
+  int count = 0;
+
+  for (size_t i=0; i < groups; i++) {
+    if (i == start && end > start) {
+      count += sprintf(text + count, i == 0 ? "::" : ":");
+      i = end - 1;
+      continue;
+    }
+    count += sprintf(text + count, format, (octets[2*i] << 8) | octets[2*i+1]);
+    if (i < groups - 1 || ip4)
+      count += sprintf(text + count, ":");
+  }
+
+  if (ip4)
+    (void)sprintf(text + count, "%u.%u.%u.%u",
+      octets[12], octets[13], octets[14], octets[15]);
+}
+
+/*!cmocka */
+void ipv6_compressed(void **state)
+{
+  // parse every compressed form of a number of addresses, kernels with a
+  // vectorized parser fall back to the scalar parser for some forms. run
+  // with ZONE_KERNEL=fallback to test the scalar parser
+  uint64_t seed = 88172645463325252llu;
+
+  (void)state;
+
+  for (size_t i=0; i < 2048; i++) {
+    uint8_t octets[16];
+    for (size_t j=0; j < 16; j += 2) {
+      const uint64_t value = next(&seed);
+      // favor zero and small groups
+      switch (value % 4) {
+        case 0: octets[j] = 0; octets[j+1] = 0; break;
+        case 1: octets[j] = 0; octets[j+1] = (uint8_t)(value >> 8); break;
+        default: octets[j] = (uint8_t)(value >> 8); octets[j+1] = (uint8_t)(value >> 16); break;
+      }
+    }
+
+    const bool ip4 = (i % 4) == 3, upper = (i % 3) == 1, pad = (i % 5) == 2;
+    const size_t groups = ip4 ? 6 : 8;
+    for (size_t start=0; start <= groups; start++) {
+      for (size_t end=start; end <= groups; end++) {
+        char text[64];
+        uint8_t copy[16], result[16];
+        memcpy(copy, octets, sizeof(copy));
+        for (size_t k=start; k < end; k++)
+          copy[2*k] = copy[2*k+1] = 0;
+        print_ip6(text, copy, start, end, ip4, upper, pad);
+        const int32_t code = parse_aaaa(text, result);
+        if (code != ZONE_SUCCESS)
+          fprintf(stderr, "INPUT: %s\n", text);
+        assert_int_equal(code, ZONE_SUCCESS);
+        assert_memory_equal(result, copy, 16);
+      }
+    }
+  }
+}
+
+#if !_WIN32
+// inet_pton is stricter than the (historic) scalar parser in two ways, i.e.
+// groups of more than four digits and octets of embedded IPv4 addresses with
+// leading zeroes are rejected. such input is not compared
+static bool is_ambiguous(const char *text)
+{
+  size_t digits = 0;
+  const bool ip4 = strchr(text, '.') != NULL;
+  for (const char *p = text; *p; p++) {
+    if (!strchr("0123456789abcdefABCDEF", *p)) {
+      digits = 0;
+      continue;
+    }
+    if (++digits > 4)
+      return true;
+    if (ip4 && digits == 1 && *p == '0' && p[1] >= '0' && p[1] <= '9')
+      return true;
+  }
+  return false;
+}
+
+static void mutate_ip6(char *text, uint64_t *seed)
+{
+  static const char alphabet[] = "0123456789abcdefABCDEFg::..";
+  const size_t operations = 1 + next(seed) % 3;
+
+  for (size_t i=0; i < operations; i++) {
+    const size_t length = strlen(text);
+    const size_t offset = (size_t)(next(seed) % (length + 1));
+    const char symbol = alphabet[next(seed) % (sizeof(alphabet) - 1)];
+    switch (next(seed) % 3) {
+      case 0: // insert
+        memmove(text + offset + 1, text + offset, length - offset + 1);
+        text[offset] = symbol;
+        break;
+      case 1: // delete
+        if (offset < length)
+          memmove(text + offset, text + offset + 1, length - offset);
+        break;
+      default: // replace
+        if (offset < length)
+          text[offset] = symbol;
+        break;
+    }
+  }
+}
+
+static void compare_ip6(const char *text)
+{
+  uint8_t expected[16], octets[16];
+
+  if (!*text || is_ambiguous(text))
+    return;
+  const int32_t accept = inet_pton(AF_INET6, text, expected) == 1;
+  const int32_t code = parse_aaaa(text, octets);
+  if ((code == ZONE_SUCCESS) != accept)
+    fprintf(stderr, "INPUT: %s\n", text);
+  assert_int_equal(code == ZONE_SUCCESS, accept);
+  if (accept)
+    assert_memory_equal(octets, expected, 16);
+}
+#endif
+
+/*!cmocka */
+void ipv6_differential(void **state)
+{
+  // random valid addresses and mutations thereof must be accepted or
+  // rejected like inet_pton does, and convert to the same octets
+  (void)state;
+#if _WIN32
+  skip();
+#else
+  uint64_t seed = 2463534242llu;
+
+  for (size_t i=0; i < 65536; i++) {
+    uint8_t octets[16];
+    char text[128];
+    for (size_t j=0; j < 16; j += 2) {
+      const uint64_t value = next(&seed);
+      octets[j] = (value % 3) ? (uint8_t)(value >> 8) : 0;
+      octets[j+1] = (value % 5) ? (uint8_t)(value >> 16) : 0;
+    }
+
+    const uint64_t value = next(&seed);
+    const bool ip4 = (value & 3) == 0, upper = (value & 4) != 0,
+               pad = (value & 8) != 0;
+    const size_t groups = ip4 ? 6 : 8;
+    size_t start = (size_t)((value >> 8) % (groups + 1));
+    size_t end = start + (size_t)((value >> 16) % (groups - start + 1));
+    for (size_t k=start; k < end; k++)
+      octets[2*k] = octets[2*k+1] = 0;
+    print_ip6(text, octets, start, end, ip4, upper, pad);
+    compare_ip6(text);
+
+    // invalid input is mostly produced by mutating valid input, random
+    // strings of the same alphabet cover what mutations do not
+    mutate_ip6(text, &seed);
+    compare_ip6(text);
+    if ((i & 7) == 0) {
+      static const char alphabet[] = "0123456789abcdefABCDEFg::::..";
+      const size_t length = 1 + next(&seed) % 48;
+      for (size_t k=0; k < length; k++)
+        text[k] = alphabet[next(&seed) % (sizeof(alphabet) - 1)];
+      text[length] = '\0';
+      compare_ip6(text);
+    }
+  }
+#endif
+}
@@ -0,0 +1,167 @@
+/*
+ * next.c -- test pulling records one at a time
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "tools.h"
+
+static int32_t parse_file(digest_t *digest, const char *path)
+{
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  initialize_options(&options);
+  options.accept.callback = &digest_rr;
+  initialize_digest(digest);
+  return zone_parse(&parser, &options, &buffers, path, digest);
+}
+
+static int32_t next_file(digest_t *digest, const char *path)
+{
+  int32_t code;
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+  zone_rr_t rr;
+
+  // no accept callback, records are pulled
+  initialize_options(&options);
+  initialize_digest(digest);
+  if ((code = zone_open(&parser, &options, &buffers, path, NULL)) < 0)
+    return code;
+  while ((code = zone_next(&parser, &rr)) > 0)
+    (void)digest_rr(&parser, &rr.owner, rr.type, rr.rrclass, rr.ttl,
+      rr.rdlength, rr.rdata, digest);
+  zone_close(&parser);
+  return code;
+}
+
+/*!cmocka */
+void next_records(void **state)
+{
+  (void)state;
+
+  static const char records[] =
+    "$TTL 300\n"
+    "@ SOA ns hostmaster ( 2024010101 3600 900 604800 86400 )\n"
+    "  NS ns.example.com.\n"
+    "ns A 192.0.2.1 ; comment\n"
+    "  AAAA 2001:db8::1\n"
+    "$ORIGIN sub.example.com.\n"
+    "txt 60 TXT ( \"text that spans\"\n"
+    "             \"multiple lines\" )\n"
+    "www CNAME @\n";
+
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  digest_t expected, digest;
+
+  write_file(path, records, sizeof(records) - 1);
+  assert_int_equal(parse_file(&expected, path), ZONE_SUCCESS);
+  assert_int_equal(expected.records, 6);
+  assert_int_equal(next_file(&digest, path), ZONE_SUCCESS);
+  assert_int_equal(digest.records, expected.records);
+  assert_true(digest.hash == expected.hash);
+
+  // records span many windows
+  const size_t count = 100000;
+  char *text = malloc(count * 48);
+  assert_non_null(text);
+  size_t length = 0;
+  for (size_t i=0; i < count; i++)
+    length += (size_t)sprintf(
+      text + length, "host%zu %zu A 192.0.2.%zu\n", i, i, i % 256);
+  write_file(path, text, length);
+  assert_int_equal(parse_file(&expected, path), ZONE_SUCCESS);
+  assert_int_equal(expected.records, count);
+  assert_int_equal(next_file(&digest, path), ZONE_SUCCESS);
+  assert_int_equal(digest.records, expected.records);
+  assert_true(digest.hash == expected.hash);
+
+  remove(path);
+  free(text);
+  free(path);
+}
+
+/*!cmocka */
+void next_include(void **state)
+{
+  (void)state;
+
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  char *include_path = get_tempnam(NULL, "zone");
+  assert_non_null(include_path);
+
+  static const char include[] = "bar A 192.0.2.2\nbaz A 192.0.2.3\n";
+  write_file(include_path, include, sizeof(include) - 1);
+  char includer[512];
+  const int written = snprintf(includer, sizeof(includer),
+    "foo A 192.0.2.1\n$INCLUDE \"%s\" sub.example.com.\nqux A 192.0.2.4\n",
+    include_path);
+  assert_true(written > 0 && (size_t)written < sizeof(includer));
+  write_file(path, includer, (size_t)written);
+
+  digest_t expected, digest;
+  assert_int_equal(parse_file(&expected, path), ZONE_SUCCESS);
+  assert_int_equal(expected.records, 4);
+  assert_int_equal(next_file(&digest, path), ZONE_SUCCESS);
+  assert_int_equal(digest.records, expected.records);
+  assert_true(digest.hash == expected.hash);
+
+  remove(include_path);
+  free(include_path);
+  remove(path);
+  free(path);
+}
+
+/*!cmocka */
+void next_errors(void **state)
+{
+  (void)state;
+
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+
+  // records that precede a syntax error are returned
+  static const char records[] =
+    "foo A 192.0.2.1\nbar A 192.0.2\nbaz A 192.0.2.3\n";
+  write_file(path, records, sizeof(records) - 1);
+
+  digest_t digest;
+  assert_int_equal(next_file(&digest, path), ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.records, 1);
+
+  remove(path);
+  free(path);
+
+  // accept callback is required to parse, not to pull records
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+  char text[] = "foo A 192.0.2.1\n\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0"
+                "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0"
+                "\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
+  initialize_options(&options);
+  assert_int_equal(
+    zone_parse_string(&parser, &options, &buffers, text, 16, NULL),
+    ZONE_BAD_PARAMETER);
+}
@@ -0,0 +1,141 @@
+/*
+ * parallel.c -- test parsing a single file on multiple threads
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "tools.h"
+
+#define MAXIMUM_THREADS (8)
+
+static int32_t parse_file(result_t *result, const char *path, size_t threads)
+{
+  zone_parser_t parser;
+  zone_options_t options;
+  zone_buffers_t buffers;
+  int32_t code;
+
+  memset(result, 0, sizeof(*result));
+  result->threads = threads;
+  initialize_options(&options);
+  options.accept.callback = &hash_chunk_rr;
+  options.log.callback = &log_chunk_line;
+
+  buffers.size = threads;
+  buffers.owner = malloc(threads * sizeof(*buffers.owner));
+  buffers.rdata = malloc(threads * sizeof(*buffers.rdata));
+  assert_non_null(buffers.owner);
+  assert_non_null(buffers.rdata);
+  code = zone_parse_parallel(
+    &parser, &options, &buffers, path, threads, result);
+  free(buffers.owner);
+  free(buffers.rdata);
+  return code;
+}
+
+/*!cmocka */
+void parallel_records(void **state)
+{
+  (void)state;
+
+  size_t length;
+  char *text = generate_zone(&length, 100000, NULL);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  write_file(path, text, length);
+
+  static result_t expected, result;
+  assert_int_equal(parse_file(&expected, path, 1), ZONE_SUCCESS);
+  assert_true(expected.chunks[0].count > 100000);
+
+  const size_t threads[] = { 2, 3, MAXIMUM_THREADS };
+  for (size_t i=0; i < sizeof(threads)/sizeof(threads[0]); i++) {
+    assert_int_equal(parse_file(&result, path, threads[i]), ZONE_SUCCESS);
+    assert_same_chunks(&expected, &result);
+    release_result(&result);
+  }
+
+  release_result(&expected);
+  remove(path);
+  free(path);
+  free(text);
+}
+
+/*!cmocka */
+void parallel_include(void **state)
+{
+  (void)state;
+
+  static const char records[] = "foo A 192.0.2.1\nbar A 192.0.2.2\n";
+  char *include = get_tempnam(NULL, "zone");
+  assert_non_null(include);
+  write_file(include, records, sizeof(records) - 1);
+
+  size_t length;
+  char *text = generate_zone(&length, 100000, include);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  write_file(path, text, length);
+
+  static result_t expected, result;
+  assert_int_equal(parse_file(&expected, path, 1), ZONE_SUCCESS);
+  assert_int_equal(parse_file(&result, path, 4), ZONE_SUCCESS);
+  assert_same_chunks(&expected, &result);
+
+  release_result(&expected);
+  release_result(&result);
+  remove(path);
+  free(path);
+  remove(include);
+  free(include);
+  free(text);
+}
+
+/*!cmocka */
+void parallel_errors(void **state)
+{
+  (void)state;
+
+  size_t length;
+  char *text = generate_zone(&length, 100000, NULL);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+
+  // errors are reported once, on the right line
+  const size_t offsets[] = { length / 3, (3 * length) / 4 };
+  for (size_t i=0; i < sizeof(offsets)/sizeof(offsets[0]); i++) {
+    char *newline = memchr(text + offsets[i], '\n', length - offsets[i]);
+    assert_non_null(newline);
+    const size_t offset = (size_t)(newline - text) + 1;
+    static const char error[] = "error A 192.0.2\n";
+    char *broken = malloc(length + sizeof(error));
+    assert_non_null(broken);
+    memcpy(broken, text, offset);
+    memcpy(broken + offset, error, sizeof(error) - 1);
+    memcpy(broken + offset + sizeof(error) - 1, text + offset, length - offset);
+    write_file(path, broken, length + sizeof(error) - 1);
+    free(broken);
+
+    static result_t expected, result;
+    assert_int_equal(parse_file(&expected, path, 1), ZONE_SYNTAX_ERROR);
+    assert_int_equal(parse_file(&result, path, 4), ZONE_SYNTAX_ERROR);
+    assert_true(expected.error_line > 1);
+    assert_int_equal(result.error_line, expected.error_line);
+    release_result(&expected);
+    release_result(&result);
+  }
+
+  remove(path);
+  free(path);
+  free(text);
+}
@@ -0,0 +1,134 @@
+/*
+ * pipeline.c -- test scanning files on a separate thread
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "tools.h"
+
+static int32_t parse_file(
+  digest_t *digest, const char *path, bool pipeline, size_t limit)
+{
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  initialize_options(&options);
+  options.accept.callback = &digest_rr;
+  options.log.callback = &log_line;
+  options.pipeline = pipeline;
+
+  initialize_digest(digest);
+  digest->limit = limit;
+  return zone_parse(&parser, &options, &buffers, path, digest);
+}
+
+/*!cmocka */
+void pipeline_records(void **state)
+{
+  (void)state;
+
+  // included file is large enough to be scanned ahead too
+  size_t length;
+  char *include = get_tempnam(NULL, "zone");
+  assert_non_null(include);
+  char *text = generate_zone(&length, 40000, NULL);
+  write_file(include, text, length);
+  free(text);
+
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+  text = generate_zone(&length, 40000, include);
+  write_file(path, text, length);
+  free(text);
+
+  digest_t expected, digest;
+  assert_int_equal(parse_file(&expected, path, false, 0), ZONE_SUCCESS);
+  assert_true(expected.records > 80000);
+  assert_int_equal(parse_file(&digest, path, true, 0), ZONE_SUCCESS);
+  assert_int_equal(digest.records, expected.records);
+  assert_true(digest.hash == expected.hash);
+
+  // scanner is stopped if the parser stops early
+  assert_int_equal(parse_file(&digest, path, true, 1000), ZONE_BAD_PARAMETER);
+  assert_int_equal(digest.records, 1000);
+
+  // records are pulled from files scanned ahead
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+  zone_rr_t rr;
+  int32_t code;
+  initialize_options(&options);
+  options.pipeline = true;
+  assert_int_equal(
+    zone_open(&parser, &options, &buffers, path, NULL), ZONE_SUCCESS);
+  size_t records = 0;
+  while ((code = zone_next(&parser, &rr)) > 0)
+    records++;
+  zone_close(&parser);
+  assert_int_equal(code, ZONE_SUCCESS);
+  assert_int_equal(records, expected.records);
+
+  remove(path);
+  free(path);
+  remove(include);
+  free(include);
+}
+
+/*!cmocka */
+void pipeline_errors(void **state)
+{
+  (void)state;
+
+  size_t length;
+  char *text = generate_zone(&length, 40000, NULL);
+  char *path = get_tempnam(NULL, "zone");
+  assert_non_null(path);
+
+  // errors are reported on the right line
+  char *address = strstr(text + length / 2, "192.0.2.");
+  assert_non_null(address);
+  address[7] = 'x';
+  write_file(path, text, length);
+  address[7] = '.';
+
+  digest_t expected, digest;
+  assert_int_equal(parse_file(&expected, path, false, 0), ZONE_SYNTAX_ERROR);
+  assert_true(expected.error_line > 1);
+  assert_int_equal(parse_file(&digest, path, true, 0), ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.error_line, expected.error_line);
+  assert_int_equal(digest.records, expected.records);
+
+  // missing quote is reported once the file is scanned
+  static const char unterminated[] = "foo TXT \"bar\n";
+  char *broken = malloc(length + sizeof(unterminated));
+  assert_non_null(broken);
+  memcpy(broken, text, length);
+  memcpy(broken + length, unterminated, sizeof(unterminated) - 1);
+  write_file(path, broken, length + sizeof(unterminated) - 1);
+  free(broken);
+
+  assert_int_equal(parse_file(&expected, path, false, 0), ZONE_SYNTAX_ERROR);
+  assert_int_equal(parse_file(&digest, path, true, 0), ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.error_line, expected.error_line);
+  assert_int_equal(digest.records, expected.records);
+
+  remove(path);
+  free(path);
+  free(text);
+}
@@ -0,0 +1,236 @@
+/*
+ * reader.c -- test parsing input provided by readers
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+
+typedef struct source source_t;
+struct source {
+  zone_reader_t reader;
+  const char *text;
+  size_t length, offset;
+  // number of bytes per read, to split tokens across refills
+  size_t chunk;
+  // offset at which reading fails, if any
+  size_t fail;
+  size_t *closed;
+};
+
+static int32_t read_source(
+  zone_reader_t *reader, char *data, size_t size, size_t *count)
+{
+  source_t *source = (source_t *)reader;
+
+  size_t length = source->length - source->offset;
+  if (length > size)
+    length = size;
+  if (length > source->chunk)
+    length = source->chunk;
+  if (source->fail && source->offset + length >= source->fail)
+    return ZONE_READ_ERROR;
+  memcpy(data, source->text + source->offset, length);
+  source->offset += length;
+  *count = length;
+  return 0;
+}
+
+static int32_t map_source(
+  zone_reader_t *reader, const char **data, size_t *length)
+{
+  source_t *source = (source_t *)reader;
+  *data = source->text;
+  *length = source->length;
+  return 1;
+}
+
+static int32_t no_read(
+  zone_reader_t *reader, char *data, size_t size, size_t *count)
+{
+  (void)reader;
+  (void)data;
+  (void)size;
+  (void)count;
+  fail_msg("Input handed over by reader must not be read");
+  return ZONE_READ_ERROR;
+}
+
+static void close_source(zone_reader_t *reader)
+{
+  source_t *source = (source_t *)reader;
+  *source->closed += 1;
+}
+
+static void initialize_source(
+  source_t *source, const char *text, size_t chunk, size_t *closed)
+{
+  memset(source, 0, sizeof(*source));
+  source->reader.read = &read_source;
+  source->reader.close = &close_source;
+  source->text = text;
+  source->length = strlen(text);
+  source->chunk = chunk;
+  source->closed = closed;
+}
+
+typedef struct context context_t;
+struct context {
+  size_t records;
+  size_t closed;
+  source_t include;
+  int32_t open_code;
+};
+
+static int32_t count_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  (void)parser;
+  (void)owner;
+  (void)type;
+  (void)class;
+  (void)ttl;
+  (void)rdlength;
+  (void)rdata;
+  ((context_t *)user_data)->records++;
+  return ZONE_SUCCESS;
+}
+
+static int32_t open_include(
+  zone_parser_t *parser,
+  const char *name,
+  zone_reader_t **reader,
+  void *user_data)
+{
+  context_t *context = user_data;
+  (void)parser;
+  if (context->open_code)
+    return context->open_code;
+  if (strcmp(name, "included.zone") != 0)
+    return ZONE_NOT_A_FILE;
+  *reader = &context->include.reader;
+  return 0;
+}
+
+static const uint8_t origin[] =
+  { 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0 };
+
+static int32_t parse_source(
+  context_t *context, source_t *source)
+{
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  memset(&options, 0, sizeof(options));
+  options.accept.callback = &count_rr;
+  options.include.open = &open_include;
+  options.origin.octets = origin;
+  options.origin.length = sizeof(origin);
+  options.default_ttl = 3600;
+  options.default_class = ZONE_CLASS_IN;
+
+  return zone_parse_reader(
+    &parser, &options, &buffers, "source.zone", &source->reader, context);
+}
+
+static const char includer[] =
+  "foo.example.com. TXT \"first record\"\n"
+  "$INCLUDE included.zone\n"
+  "bar.example.com. TXT ( \"record that spans\"\n"
+  "                       \"multiple lines\" )\n";
+
+static const char included[] =
+  "baz.example.com. A 192.0.2.1\n"
+  "baz.example.com. AAAA 2001:db8::1\n";
+
+/*!cmocka */
+void reader_input(void **state)
+{
+  (void)state;
+
+  // read in chunks of various sizes to split tokens across refills
+  const size_t chunks[] = { 1, 7, 64, 4096 };
+  for (size_t i=0; i < sizeof(chunks)/sizeof(chunks[0]); i++) {
+    context_t context;
+    source_t source;
+    memset(&context, 0, sizeof(context));
+    initialize_source(&source, includer, chunks[i], &context.closed);
+    initialize_source(&context.include, included, chunks[i], &context.closed);
+    source.reader.window_size = 1024 * 1024;
+    assert_int_equal(parse_source(&context, &source), ZONE_SUCCESS);
+    assert_int_equal(context.records, 4);
+    assert_int_equal(context.closed, 2);
+  }
+}
+
+/*!cmocka */
+void mapped_reader_input(void **state)
+{
+  (void)state;
+
+  char text[sizeof(includer) + ZONE_BLOCK_SIZE];
+  memset(text, 0, sizeof(text));
+  memcpy(text, includer, sizeof(includer));
+
+  context_t context;
+  source_t source;
+  memset(&context, 0, sizeof(context));
+  initialize_source(&source, text, 7, &context.closed);
+  source.reader.read = &no_read;
+  source.reader.map = &map_source;
+  initialize_source(&context.include, included, 7, &context.closed);
+  assert_int_equal(parse_source(&context, &source), ZONE_SUCCESS);
+  assert_int_equal(context.records, 4);
+  assert_int_equal(context.closed, 2);
+}
+
+/*!cmocka */
+void reader_errors(void **state)
+{
+  (void)state;
+
+  context_t context;
+  source_t source;
+
+  // read errors are propagated and readers are closed
+  memset(&context, 0, sizeof(context));
+  initialize_source(&source, includer, 7, &context.closed);
+  initialize_source(&context.include, included, 7, &context.closed);
+  context.include.fail = 40;
+  assert_int_equal(parse_source(&context, &source), ZONE_READ_ERROR);
+  assert_int_equal(context.records, 1);
+  assert_int_equal(context.closed, 2);
+
+  // errors opening included files are propagated
+  memset(&context, 0, sizeof(context));
+  initialize_source(&source, includer, 7, &context.closed);
+  context.open_code = ZONE_NOT_PERMITTED;
+  assert_int_equal(parse_source(&context, &source), ZONE_NOT_PERMITTED);
+  assert_int_equal(context.records, 1);
+  assert_int_equal(context.closed, 1);
+
+  // readers must be able to read
+  memset(&context, 0, sizeof(context));
+  initialize_source(&source, includer, 7, &context.closed);
+  source.reader.read = NULL;
+  assert_int_equal(parse_source(&context, &source), ZONE_BAD_PARAMETER);
+  assert_int_equal(context.closed, 1);
+}
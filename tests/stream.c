@@ -0,0 +1,297 @@
+/*
+ * stream.c -- test parsing input pushed by the application
+ *
+ * Copyright (c) 2024, NLnet Labs. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include "zone.h"
+#include "tools.h"
+
+static void initialize_stream_options(zone_options_t *options)
+{
+  initialize_options(options);
+  options->accept.callback = &digest_rr;
+  options->log.mask = ZONE_ERROR | ZONE_WARNING | ZONE_INFO;
+  options->log.callback = &log_line;
+}
+
+static const char records[] =
+  "$TTL 300\n"
+  "@ SOA ns hostmaster ( 2024010101 ; serial\n"
+  "                      3600 900 604800 86400 )\n"
+  "  NS ns.example.com.\n"
+  "ns A 192.0.2.1 ; comment with a \"quote\n"
+  "  AAAA 2001:db8::1\n"
+  "\n"
+  "; comment on a line of its own\n"
+  "foo\\.bar 60 TXT \"text with \\\"escaped\\\" quotes\" \"and ; no comment\"\n"
+  "$ORIGIN sub.example.com.\n"
+  "www CNAME @\n"
+  "txt TXT ( \"text that spans\"\n"
+  "          \"multiple lines\" )\n"
+  "\\065\\066c MX 10 mail.example.com.\n"
+  "last A 192.0.2.2";
+
+static int32_t parse_string(digest_t *digest, const char *text)
+{
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  initialize_stream_options(&options);
+  initialize_digest(digest);
+
+  size_t length = strlen(text);
+  char *padded = calloc(length + 1 + ZONE_BLOCK_SIZE, 1);
+  assert_non_null(padded);
+  memcpy(padded, text, length);
+  int32_t code = zone_parse_string(
+    &parser, &options, &buffers, padded, length, digest);
+  free(padded);
+  return code;
+}
+
+static int32_t feed_string(digest_t *digest, const char *text, size_t chunk)
+{
+  int32_t code;
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  initialize_stream_options(&options);
+  initialize_digest(digest);
+
+  if ((code = zone_stream_open(&parser, &options, &buffers, digest)) < 0)
+    return code;
+
+  // chunks are copied so that reading past a chunk is detected by
+  // address sanitizer and chunks are released before the next is fed
+  const size_t length = strlen(text);
+  for (size_t offset=0; offset < length; offset += chunk) {
+    size_t size = length - offset < chunk ? length - offset : chunk;
+    char *data = malloc(size);
+    assert_non_null(data);
+    memcpy(data, text + offset, size);
+    code = zone_stream_feed(&parser, data, size);
+    free(data);
+    if (code < 0)
+      return code;
+  }
+
+  return zone_stream_finish(&parser);
+}
+
+/*!cmocka */
+void stream_chunks(void **state)
+{
+  (void)state;
+
+  digest_t expected, digest;
+  assert_int_equal(parse_string(&expected, records), ZONE_SUCCESS);
+  assert_int_equal(expected.records, 9);
+
+  // split records, tokens, escape sequences and comments everywhere
+  for (size_t chunk=1; chunk <= sizeof(records); chunk++) {
+    assert_int_equal(feed_string(&digest, records, chunk), ZONE_SUCCESS);
+    assert_int_equal(digest.records, expected.records);
+    assert_true(digest.hash == expected.hash);
+  }
+}
+
+/*!cmocka */
+void stream_large_records(void **state)
+{
+  (void)state;
+
+  // records larger than the window must be retained across chunks
+  const size_t count = 4;
+  size_t length = 0;
+  char *text = malloc(count * (2 * ZONE_WINDOW_SIZE));
+  assert_non_null(text);
+  for (size_t i=0; i < count; i++) {
+    const char owner[] = "foo TXT";
+    memcpy(text + length, owner, sizeof(owner) - 1);
+    length += sizeof(owner) - 1;
+    // character-strings are limited to 255 octets
+    for (size_t j=0; j < 200; j++) {
+      const char string[] = " \"0123456789abcdef0123456789abcdef\"";
+      memcpy(text + length, string, sizeof(string) - 1);
+      length += sizeof(string) - 1;
+    }
+    text[length++] = '\n';
+  }
+  text[length] = '\0';
+  assert_true(length > ZONE_WINDOW_SIZE);
+
+  digest_t expected, digest;
+  assert_int_equal(parse_string(&expected, text), ZONE_SUCCESS);
+  assert_int_equal(expected.records, count);
+
+  const size_t chunks[] = { 61, 4096, ZONE_WINDOW_SIZE + 1 };
+  for (size_t i=0; i < sizeof(chunks)/sizeof(chunks[0]); i++) {
+    assert_int_equal(feed_string(&digest, text, chunks[i]), ZONE_SUCCESS);
+    assert_int_equal(digest.records, expected.records);
+    assert_true(digest.hash == expected.hash);
+  }
+
+  free(text);
+}
+
+/*!cmocka */
+void stream_many_tokens(void **state)
+{
+  (void)state;
+
+  // tokens of records that take up more than half of the tape are not kept
+  // across chunks, such records are scanned again
+  const size_t strings = ZONE_TAPE_SIZE / 2 + 100;
+  char *text = malloc(2 * (strings * 4 + 16));
+  assert_non_null(text);
+  size_t length = 0;
+  for (size_t i=0; i < 2; i++) {
+    const char owner[] = "foo TXT";
+    memcpy(text + length, owner, sizeof(owner) - 1);
+    length += sizeof(owner) - 1;
+    for (size_t j=0; j < strings; j++) {
+      memcpy(text + length, " \"x\"", 4);
+      length += 4;
+    }
+    text[length++] = '\n';
+  }
+  text[length] = '\0';
+
+  digest_t expected, digest;
+  assert_int_equal(parse_string(&expected, text), ZONE_SUCCESS);
+  assert_int_equal(expected.records, 2);
+
+  const size_t chunks[] = { 61, 1000, 4096 };
+  for (size_t i=0; i < sizeof(chunks)/sizeof(chunks[0]); i++) {
+    assert_int_equal(feed_string(&digest, text, chunks[i]), ZONE_SUCCESS);
+    assert_int_equal(digest.records, expected.records);
+    assert_true(digest.hash == expected.hash);
+  }
+
+  free(text);
+}
+
+/*!cmocka */
+void stream_errors(void **state)
+{
+  (void)state;
+
+  digest_t digest;
+
+  // records that precede a syntax error are accepted
+  assert_int_equal(
+    feed_string(&digest, "foo A 192.0.2.1\nbar A 192.0.2\nbaz A 192.0.2.3\n", 20),
+    ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.records, 1);
+
+  // incomplete records are reported once the stream is finished
+  assert_int_equal(
+    feed_string(&digest, "foo A 192.0.2.1\nbar TXT \"missing quote\n", 8),
+    ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.records, 1);
+  assert_int_equal(
+    feed_string(&digest, "foo A 192.0.2.1\nbar A ( 192.0.2.2\n", 8),
+    ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.records, 1);
+
+  // input cannot be fed after the stream is finished
+  zone_parser_t parser;
+  zone_name_buffer_t owner;
+  zone_rdata_buffer_t rdata;
+  zone_buffers_t buffers = { 1, &owner, &rdata };
+  zone_options_t options;
+
+  initialize_stream_options(&options);
+  assert_int_equal(
+    zone_stream_open(&parser, &options, &buffers, &digest), ZONE_SUCCESS);
+  assert_int_equal(zone_stream_finish(&parser), ZONE_SUCCESS);
+  assert_int_equal(
+    zone_stream_feed(&parser, "foo A 192.0.2.1\n", 16), ZONE_BAD_PARAMETER);
+  assert_int_equal(zone_stream_finish(&parser), ZONE_BAD_PARAMETER);
+}
+
+static void assert_same_result(
+  const char *text, size_t chunk, const digest_t *expected, int32_t code)
+{
+  digest_t digest;
+  const int32_t result = feed_string(&digest, text, chunk);
+  if (result != code || digest.records != expected->records)
+    fprintf(stderr, "INPUT (%zu byte chunks): %s\n", chunk, text);
+  assert_int_equal(result, code);
+  assert_int_equal(digest.records, expected->records);
+  assert_true(digest.hash == expected->hash);
+  assert_int_equal(digest.error_line, expected->error_line);
+}
+
+/*!cmocka */
+void stream_truncated(void **state)
+{
+  (void)state;
+
+  // truncated and invalid input must yield the records and the error of
+  // parsing the input in one go, wherever it is split. input that ends in
+  // the last full block scanned is of particular interest
+  static const char invalid[] =
+    "N A 2.0.2.3\n"
+    "e IN DS 60485 5 1 ( 2BB183AF5F22588179A53B0A98631FAD1A292118 )\n"
+    "f";
+  char dnskey[512];
+  int length = snprintf(dnskey, sizeof(dnskey),
+    "k DNSKEY 256 3 8 AwEAAa%s Uk IN AAAA ::ffff:1",
+    "cWkYJPv1HcvWQzBsSVTlQuwDzyDBSeWmFRKqdv5EsYo8udUadHSUkiamfKrxvKRZwV"
+    "gkKcDnDbKMl1FzvnPRsDfzx2LqbKs0e7fsDB1CO2dmujM0tSCmfwyUSd5J0AwnFYu"
+    "lv9IDtBLDJ8nxJ7eVwvzrFtMs8cdEgRyF7SNnqdLnn0DU9OSVLPFRZwY43BhQ5vOe");
+  assert_true(length > 0 && (size_t)length < sizeof(dnskey));
+
+  // last token must not be dropped if input ends with a full block
+  digest_t digest;
+  assert_int_equal(strlen(invalid + 12), ZONE_BLOCK_SIZE);
+  assert_int_equal(parse_string(&digest, invalid + 12), ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.records, 1);
+  assert_int_equal(parse_string(&digest, invalid), ZONE_SYNTAX_ERROR);
+  assert_int_equal(digest.records, 2);
+  assert_int_equal(parse_string(&digest, dnskey), ZONE_SYNTAX_ERROR);
+
+  const char *texts[] = { records, invalid, dnskey };
+  const size_t chunks[] = { 1, 3, 7, 50, 64, 65, 100, 128 };
+
+  for (size_t i=0; i < sizeof(texts)/sizeof(texts[0]); i++) {
+    char text[1024];
+    const size_t size = strlen(texts[i]);
+    assert_true(size < sizeof(text));
+
+    // empty strings are rejected by zone_parse_string
+    for (size_t end=1; end <= size; end++) {
+      digest_t expected;
+      memcpy(text, texts[i], end);
+      text[end] = '\0';
+      const int32_t code = parse_string(&expected, text);
+      for (size_t j=0; j < sizeof(chunks)/sizeof(chunks[0]); j++)
+        assert_same_result(text, chunks[j], &expected, code);
+      assert_same_result(text, end, &expected, code);
+    }
+
+    // split at every offset
+    digest_t expected;
+    memcpy(text, texts[i], size + 1);
+    const int32_t code = parse_string(&expected, text);
+    for (size_t chunk=1; chunk <= size; chunk++)
+      assert_same_result(text, chunk, &expected, code);
+  }
+}
@@ -204,6 +204,10 @@ void strings(void **state)
 
   static const uint8_t rdata_foo_bar[] = { 7, 'f', 'o', 'o', ' ', 'b', 'a', 'r' };
 
+  static const uint8_t rdata_escapes[] = {
+    20, 'a', 0xff, 'b', 0x80, 'c', '\\', '\\', 'd', ';', 'e', 0x01, 0x7f, 0xfe,
+        'f', 0x00, 'g', 'h', '"', 'i', '.' };
+
   static const struct strings_test tests[] = {
     // contiguous too long
     { TEXT256, ZONE_SYNTAX_ERROR, { 0, NULL } },
@@ -234,7 +238,73 @@ void strings(void **state)
     // contiguous with escaped space
     { "foo\\ bar", 0, { 8, rdata_foo_bar } },
     // quoted with space
-    { "\"foo bar\"", 0, { 8, rdata_foo_bar } }
+    { "\"foo bar\"", 0, { 8, rdata_foo_bar } },
+    // contiguous with escapes crossing 16 byte boundaries
+    { "a\\255b\\128c\\\\\\\\d\\;e\\001\\127\\254f\\000gh\\\"i\\.", 0, { 21, rdata_escapes } },
+    // quoted with escapes crossing 16 byte boundaries
+    { "\"a\\255b\\128c\\\\\\\\d;e\\001\\127\\254f\\000gh\\\"i.\"", 0, { 21, rdata_escapes } },
+    // decimal escape out of range
+    { "foo\\256", ZONE_SYNTAX_ERROR, { 0, NULL } },
+    // decimal escape with non-digit
+    { "foo\\2e1", ZONE_SYNTAX_ERROR, { 0, NULL } },
+    // decimal escape cut short in quoted string
+    { "\"foo\\25\"", ZONE_SYNTAX_ERROR, { 0, NULL } }
+  };
+
+  static const uint8_t origin[] = { 3, 'f', 'o', 'o', 0 };
+
+  for (size_t i=0, n=sizeof(tests)/sizeof(tests[0]); i < n; i++) {
+    zone_parser_t parser;
+    zone_name_buffer_t name;
+    zone_rdata_buffer_t rdata;
+    zone_buffers_t buffers = { 1, &name, &rdata };
+    zone_options_t options;
+    char input[512] = { 0 };
+    size_t length;
+    int32_t code;
+
+    (void)snprintf(input, sizeof(input), "foo. TXT %s", tests[i].text);
+    length = strlen(input);
+
+    memset(&options, 0, sizeof(options));
+    options.accept.callback = strings_callback;
+    options.origin.octets = origin;
+    options.origin.length = sizeof(origin);
+    options.default_ttl = 3600;
+    options.default_class = ZONE_CLASS_IN;
+
+    fprintf(stderr, "INPUT: '%s'\n", input);
+    code = zone_parse_string(&parser, &options, &buffers, input, length, (void *)&tests[i]);
+    assert_int_equal(code, tests[i].code);
+  }
+}
+
+/*!cmocka */
+void comments(void **state)
+{
+  (void)state;
+
+  static const uint8_t rdata_foo[] = { 3, 'f', 'o', 'o' };
+
+  static const uint8_t rdata_foo_bar[] = { 7, 'f', 'o', 'o', ';', 'b', 'a', 'r' };
+
+  static const uint8_t rdata_foo_bar_[] = { 3, 'f', 'o', 'o', 4, 'b', 'a', 'r', ';' };
+
+  static const struct strings_test tests[] = {
+    // quoted with semicolon
+    { "\"foo;bar\" ; comment", 0, { 8, rdata_foo_bar } },
+    // comment with quoted
+    { "foo ; \"comment\"", 0, { 4, rdata_foo } },
+    // comment with quote
+    { "foo ; \" comment", 0, { 4, rdata_foo } },
+    // comment with quote and semicolon
+    { "foo ; \";\" ; ;", 0, { 4, rdata_foo } },
+    // comment with quote followed by quoted with semicolon
+    { "( foo ; \" ;\n \"bar;\" ) ; \"", 0, { 9, rdata_foo_bar_ } },
+    // comment with quotes spanning blocks
+    { "( foo ; " TEXT16 "\"" TEXT16 "\"" TEXT16 "\"" TEXT16 "\"" TEXT16 "\n"
+      "\"bar;\" ; " TEXT16 "\"" TEXT16 ";" TEXT16 "\n)",
+      0, { 9, rdata_foo_bar_ } }
   };
 
   static const uint8_t origin[] = { 3, 'f', 'o', 'o', 0 };
@@ -411,6 +481,10 @@ void names(void **state)
     29,'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f',
        '0','1','2','3','4','5','6','7','8','9','a','b','c',
     0 };
+  static const char escaped_labels[] = "a\\.b\\255\\046c.\\100\\101\\102\\103\\104.e\\\\f.";
+  static const uint8_t owner_escaped_labels[] = {
+    6, 'a', '.', 'b', 0xff, '.', 'c', 5, 'd', 'e', 'f', 'g', 'h', 3, 'e', '\\', 'f', 0
+  };
   static const uint8_t owner_star_dot_3[] = {
     1, '*', 1, '*', 1, '*', 5, 'w', 'c', 'e', 'n', 't', 9, 'n', 'l', 'n', 'e', 't', 'l', 'a', 'b', 's', 2, 'n', 'l', 0
   };
@@ -438,7 +512,10 @@ void names(void **state)
     { "foo\\000\\000.",         0, { 7, owner_abs_foo00 } },
     { "foo\\..",                0, { 6, owner_abs_foodot } },
     { "foo\\.",                 0, { 10, owner_rel_foodot } },
-    { star_dot_3,               0, { sizeof(owner_star_dot_3), owner_star_dot_3 } }
+    { star_dot_3,               0, { sizeof(owner_star_dot_3), owner_star_dot_3 } },
+    { escaped_labels,           0, { sizeof(owner_escaped_labels), owner_escaped_labels } },
+    { "foo\\256.",              ZONE_SYNTAX_ERROR, { 0, NULL } },
+    { "foo\\1a1.",              ZONE_SYNTAX_ERROR, { 0, NULL } }
   };
 
   static const uint8_t origin[] = { 3, 'f', 'o', 'o', 0 };
@@ -516,7 +593,20 @@ void ttls(void **state)
     { PAD("foo. 4294967295 A 192.168.0.1"), true, false, ZONE_SUCCESS, 4294967295 },
     { PAD("foo. 4294967296 A 192.168.0.1"), true, false, ZONE_SYNTAX_ERROR, 0 },
     { PAD("foo. 1d A 192.168.0.1"), false, false, ZONE_SYNTAX_ERROR, 0 },
-    { PAD("foo. 1d A 192.168.0.1"), false, true, ZONE_SUCCESS, 86400 }
+    { PAD("foo. 1d A 192.168.0.1"), false, true, ZONE_SUCCESS, 86400 },
+    { PAD("foo. 1H30M A 192.168.0.1"), false, true, ZONE_SUCCESS, 5400 },
+    { PAD("foo. 1h30 A 192.168.0.1"), false, true, ZONE_SUCCESS, 3630 },
+    { PAD("foo. 1w2d3h4m5s A 192.168.0.1"), false, true, ZONE_SUCCESS, 788645 },
+    { PAD("foo. 3550w1d A 192.168.0.1"), false, true, ZONE_SUCCESS, 2147126400 },
+    { PAD("foo. 7102w A 192.168.0.1"), false, true, ZONE_SYNTAX_ERROR, 0 },
+    { PAD("foo. 4294967295s A 192.168.0.1"), true, true, ZONE_SUCCESS, 4294967295 },
+    { PAD("foo. 4294967296s A 192.168.0.1"), true, true, ZONE_SYNTAX_ERROR, 0 },
+    // greater units must precede smaller units
+    { PAD("foo. 30m1h A 192.168.0.1"), false, true, ZONE_SYNTAX_ERROR, 0 },
+    { PAD("foo. 1m1m A 192.168.0.1"), false, true, ZONE_SYNTAX_ERROR, 0 },
+    { PAD("foo. 1s1 A 192.168.0.1"), false, true, ZONE_SYNTAX_ERROR, 0 },
+    { PAD("foo. 1hh A 192.168.0.1"), false, true, ZONE_SYNTAX_ERROR, 0 },
+    { PAD("foo. h1 A 192.168.0.1"), false, true, ZONE_SYNTAX_ERROR, 0 }
   };
 
   static const uint8_t origin[] = { 3, 'f', 'o', 'o', 0 };
@@ -703,6 +793,70 @@ void no_famous_last_words(void **state)
   assert_true(count == 0);
 }
 
+/*!cmocka */
+void last_words_on_block_boundary(void **state)
+{
+  (void)state;
+
+  // input that ends exactly on a block boundary without a trailing newline
+  // must not lose the last token
+  static const char record[] = "\nfoo. A 192.0.2.1";
+
+  for (size_t blocks=1; blocks <= 3; blocks++) {
+    int32_t code;
+    size_t count = 0;
+    const size_t length = blocks * ZONE_BLOCK_SIZE;
+    char *text = calloc(length + 1 + ZONE_BLOCK_SIZE, 1);
+    assert_non_null(text);
+    memset(text, 'x', length);
+    text[0] = ';';
+    memcpy(text + length - (sizeof(record) - 1), record, sizeof(record) - 1);
+
+    code = parse(text, &count);
+    assert_int_equal(code, ZONE_SUCCESS);
+    assert_true(count == 1);
+
+    count = 0;
+    code = parse_as_include(text, &count);
+    assert_int_equal(code, ZONE_SUCCESS);
+    assert_true(count == 1);
+    free(text);
+  }
+}
+
+/*!cmocka */
+void blank_after_multiline_token(void **state)
+{
+  (void)state;
+
+  // start of line is determined by the character that follows the line
+  // feed, also if the line feed follows a token that spans lines
+  static const char *quoted = PAD("foo. TXT \"multi\nline\"\n"
+                                  "  A 192.0.2.1\n"
+                                  "bar. A 192.0.2.2");
+  static const char *escaped = PAD("foo. TXT multi\\\nline\n"
+                                   "  A 192.0.2.1\n"
+                                   "bar. A 192.0.2.2");
+  static const char *parenthesized = PAD("foo. TXT ( \"multi\"\n\"line\" )\n"
+                                         "  A 192.0.2.1\n"
+                                         "bar. A 192.0.2.2");
+  const char *texts[] = { quoted, escaped, parenthesized };
+
+  for (size_t i=0; i < sizeof(texts)/sizeof(texts[0]); i++) {
+    int32_t code;
+    size_t count = 0;
+
+    code = parse(texts[i], &count);
+    assert_int_equal(code, ZONE_SUCCESS);
+    assert_true(count == 3);
+
+    count = 0;
+    code = parse_as_include(texts[i], &count);
+    assert_int_equal(code, ZONE_SUCCESS);
+    assert_true(count == 3);
+  }
+}
+
 /*!cmocka */
 void bad_a_rrs(void **state)
 {
@@ -742,6 +896,36 @@ void bad_ttls(void **state)
   assert_int_equal(code, ZONE_SYNTAX_ERROR);
 }
 
+/*!cmocka */
+void bad_numbers(void **state)
+{
+  (void)state;
+
+  static const struct {
+    const char *text;
+    int32_t code;
+  } tests[] = {
+    { PAD("foo. MX 65535 bar."), ZONE_SUCCESS },
+    { PAD("foo. MX 65536 bar."), ZONE_SYNTAX_ERROR },
+    { PAD("foo. MX 000010 bar."), ZONE_SYNTAX_ERROR },
+    { PAD("foo. MX 1O bar."), ZONE_SYNTAX_ERROR },
+    { PAD("foo. SRV 0 255 65535 bar."), ZONE_SUCCESS },
+    { PAD("foo. SRV 0 99999 1 bar."), ZONE_SYNTAX_ERROR },
+    { PAD("foo. SSHFP 255 1 0123456789abcdef0123456789abcdef01234567"), ZONE_SUCCESS },
+    { PAD("foo. SSHFP 256 1 0123456789abcdef0123456789abcdef01234567"), ZONE_SYNTAX_ERROR },
+    { PAD("foo. SOA ns hostmaster 4294967295 0 0 0 0"), ZONE_SUCCESS },
+    { PAD("foo. SOA ns hostmaster 4294967296 0 0 0 0"), ZONE_SYNTAX_ERROR },
+    { PAD("foo. SOA ns hostmaster 9999999999 0 0 0 0"), ZONE_SYNTAX_ERROR },
+    { PAD("foo. SOA ns hostmaster 04294967295 0 0 0 0"), ZONE_SYNTAX_ERROR }
+  };
+
+  for (size_t i=0, n=sizeof(tests)/sizeof(tests[0]); i < n; i++) {
+    size_t count = 0;
+    const int32_t code = parse(tests[i].text, &count);
+    assert_int_equal(code, tests[i].code);
+  }
+}
+
 /*!cmocka */
 void bad_origins(void **state)
 {
@@ -6,10 +6,14 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 #include <assert.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <cmocka.h>
 #if _WIN32
 #include <process.h>
 #include <sys/types.h>
@@ -24,6 +28,7 @@
 #endif
 
 #include "diagnostic.h"
+#include "tools.h"
 
 static bool is_dir(const char *dir)
 {
@@ -78,12 +83,15 @@ diagnostic_pop()
   for (unsigned int i = 0; i < 1000; i++) {
     char tmp[16];
     int rnd = rand();
-    int len = snprintf(tmp, sizeof(tmp), "%s/%s.%d", tmpdir, pfx, rnd);
+    // seeds of tests that run concurrently may overlap, the process id
+    // keeps names unique
+    int len = snprintf(tmp, sizeof(tmp), "%s/%s.%u.%d", tmpdir, pfx, pid, rnd);
     assert(len >= 0);
     char *tmpfile = malloc((unsigned int)len + 1);
     if (!tmpfile)
       return NULL;
-    (void)snprintf(tmpfile, (unsigned int)len + 1, "%s/%s.%d", tmpdir, pfx, rnd);
+    (void)snprintf(
+      tmpfile, (unsigned int)len + 1, "%s/%s.%u.%d", tmpdir, pfx, pid, rnd);
     struct stat sb;
     if (stat(tmpfile, &sb) == -1)
       return tmpfile;
@@ -92,3 +100,276 @@ diagnostic_pop()
 
   return NULL;
 }
+
+void write_file(const char *path, const char *data, size_t length)
+{
+  FILE *handle = fopen(path, "wb");
+  assert_non_null(handle);
+  assert_int_equal(fwrite(data, 1, length, handle), length);
+  (void)fclose(handle);
+}
+
+void initialize_options(zone_options_t *options)
+{
+  static const uint8_t origin[] =
+    { 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0 };
+
+  memset(options, 0, sizeof(*options));
+  options->origin.octets = origin;
+  options->origin.length = sizeof(origin);
+  options->default_ttl = 3600;
+  options->default_class = ZONE_CLASS_IN;
+}
+
+uint64_t hash(uint64_t digest, const uint8_t *data, size_t length)
+{
+  for (size_t i=0; i < length; i++) {
+    digest ^= data[i];
+    digest *= 0x100000001b3llu;
+  }
+  return digest;
+}
+
+uint64_t hash_record(
+  uint64_t digest,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata)
+{
+  digest = hash(digest, owner->octets, owner->length);
+  digest = hash(digest, (const uint8_t *)&type, sizeof(type));
+  digest = hash(digest, (const uint8_t *)&class, sizeof(class));
+  digest = hash(digest, (const uint8_t *)&ttl, sizeof(ttl));
+  return hash(digest, rdata, rdlength);
+}
+
+void initialize_digest(digest_t *digest)
+{
+  memset(digest, 0, sizeof(*digest));
+  digest->hash = HASH_SEED;
+}
+
+int32_t digest_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  digest_t *digest = user_data;
+
+  (void)parser;
+  if (digest->limit && digest->records == digest->limit)
+    return ZONE_BAD_PARAMETER;
+  digest->records++;
+  digest->hash = hash_record(
+    digest->hash, owner, type, class, ttl, rdlength, rdata);
+  return ZONE_SUCCESS;
+}
+
+static void set_error_line(size_t *error_line, uint32_t priority, size_t line)
+{
+  if (priority == ZONE_ERROR && !*error_line)
+    *error_line = line;
+}
+
+char *generate_zone(size_t *length, size_t count, const char *include)
+{
+  assert_true(count >= 100);
+  char *text = malloc(count * 256 + 1024);
+  assert_non_null(text);
+
+  *length = 0;
+  for (size_t i=0; i < count; i++) {
+    char *line = text + *length;
+    if (i == count / 2 && include)
+      line += sprintf(line, "$INCLUDE \"%s\" sub.example.com.\n", include);
+    if (i == count / 3)
+      line += sprintf(line, "$TTL 300\n");
+    if (i % (count / 20) == (count / 20) - 1)
+      line += sprintf(line, "$ORIGIN zone%zu.example.com.\n", i);
+    if (i % (count / 32) == (count / 32) - 1)
+      line += sprintf(line, "ch%zu CH TXT \"chaos\"\nin%zu IN TXT \"in\"\n", i, i);
+    switch (i % 6) {
+      case 0:
+        line += sprintf(line, "host%zu %zu A 192.0.2.%zu\n", i, i % 7200, i % 256);
+        break;
+      case 1:
+        line += sprintf(line, "host%zu A 192.0.2.%zu\n  AAAA 2001:db8::%zx\n",
+          i, i % 256, i % 65536);
+        break;
+      case 2:
+        line += sprintf(line, "text%zu TXT \"multi\nfake%zu A 192.0.2.1\n"
+          "line\" ; comment\n", i, i);
+        // owner is inherited on the line that follows the quoted newline
+        if (i % 3 == 0)
+          line += sprintf(line, "  IN A 192.0.2.4\n");
+        break;
+      case 3:
+        line += sprintf(line, "soa%zu SOA ns hostmaster (\n%zu\n3600\n"
+          "900 604800\n86400 )\n", i, i);
+        break;
+      case 4:
+        line += sprintf(line, "mx%zu IN 60 MX 10 mail%zu\n", i, i);
+        break;
+      default:
+        line += sprintf(line, "escaped%zu TXT foo\\\nbar\n", i);
+        break;
+    }
+    *length = (size_t)(line - text);
+  }
+
+  return text;
+}
+
+int32_t append(list_t *list, uint64_t digest)
+{
+  if (list->count == list->size) {
+    list->size = list->size ? list->size * 2 : 1024;
+    list->hashes = realloc(list->hashes, list->size * sizeof(*list->hashes));
+    if (!list->hashes)
+      return ZONE_OUT_OF_MEMORY;
+  }
+  list->hashes[list->count++] = digest;
+  return 0;
+}
+
+void release_list(list_t *list)
+{
+  free(list->hashes);
+  memset(list, 0, sizeof(*list));
+}
+
+void assert_same_list(const list_t *expected, const list_t *list)
+{
+  assert_int_equal(list->count, expected->count);
+  for (size_t i=0; i < expected->count; i++)
+    assert_true(list->hashes[i] == expected->hashes[i]);
+}
+
+int32_t hash_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  (void)parser;
+  return append(user_data, hash_record(
+    HASH_SEED, owner, type, class, ttl, rdlength, rdata));
+}
+
+void log_list_line(
+  zone_parser_t *parser,
+  uint32_t priority,
+  const char *file,
+  size_t line,
+  const char *message,
+  void *user_data)
+{
+  list_t *list = user_data;
+
+  (void)parser;
+  (void)file;
+  (void)message;
+  set_error_line(&list->error_line, priority, line);
+}
+
+void release_result(result_t *result)
+{
+  for (size_t i=0; i < MAXIMUM_CHUNKS; i++)
+    free(result->chunks[i].hashes);
+  free(result->records.hashes);
+}
+
+void assert_same_chunks(const result_t *expected, const result_t *result)
+{
+  size_t chunk = 0, index = 0;
+
+  assert_int_equal(expected->chunks[1].count, 0);
+  for (size_t i=0; i < expected->chunks[0].count; i++) {
+    while (chunk < MAXIMUM_CHUNKS && index == result->chunks[chunk].count)
+      chunk++, index = 0;
+    assert_true(chunk < MAXIMUM_CHUNKS);
+    assert_true(result->chunks[chunk].hashes[index++] ==
+                expected->chunks[0].hashes[i]);
+  }
+
+  while (chunk < MAXIMUM_CHUNKS && index == result->chunks[chunk].count)
+    chunk++, index = 0;
+  assert_int_equal(chunk, MAXIMUM_CHUNKS);
+}
+
+int32_t hash_chunk_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data)
+{
+  const zone_chunk_t *chunk = user_data;
+  result_t *result = chunk->user_data;
+  const uint64_t digest =
+    hash_record(HASH_SEED, owner, type, class, ttl, rdlength, rdata);
+  int32_t code;
+
+  (void)parser;
+  if (chunk->sequence >= MAXIMUM_CHUNKS)
+    return ZONE_BAD_PARAMETER;
+  if (result->threads && chunk->thread >= result->threads)
+    return ZONE_BAD_PARAMETER;
+  if ((code = append(&result->chunks[chunk->sequence], digest)) < 0)
+    return code;
+  // only safe if records are delivered one chunk after the other
+  if (!result->ordered)
+    return 0;
+  if (chunk->sequence < result->last_sequence)
+    result->out_of_order = true;
+  result->last_sequence = chunk->sequence;
+  return append(&result->records, digest);
+}
+
+void log_chunk_line(
+  zone_parser_t *parser,
+  uint32_t priority,
+  const char *file,
+  size_t line,
+  const char *message,
+  void *user_data)
+{
+  const zone_chunk_t *chunk = user_data;
+  result_t *result = chunk->user_data;
+
+  (void)parser;
+  (void)file;
+  (void)message;
+  set_error_line(&result->error_line, priority, line);
+}
+
+void log_line(
+  zone_parser_t *parser,
+  uint32_t priority,
+  const char *file,
+  size_t line,
+  const char *message,
+  void *user_data)
+{
+  digest_t *digest = user_data;
+
+  (void)parser;
+  (void)file;
+  (void)message;
+  set_error_line(&digest->error_line, priority, line);
+}
@@ -9,8 +9,146 @@
 #ifndef TOOLS_H
 #define TOOLS_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "zone.h"
+
 // this is not safe to use in a production environment, but it's good enough
 // for tests
 char *get_tempnam(const char *dir, const char *prefix);
 
+void write_file(const char *path, const char *data, size_t length);
+
+// origin is example.com., default TTL is 3600 and default class is IN,
+// callbacks are left to the test
+void initialize_options(zone_options_t *options);
+
+#define HASH_SEED (0xcbf29ce484222325llu)
+
+// fnv-1a, to compare records without storing them
+uint64_t hash(uint64_t digest, const uint8_t *data, size_t length);
+
+uint64_t hash_record(
+  uint64_t digest,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata);
+
+// all records hashed into one digest, for parsing on a single thread
+typedef struct digest digest_t;
+struct digest {
+  size_t records;
+  uint64_t hash;
+  size_t error_line;
+  // accept callback fails once limit records are accepted, if not zero
+  size_t limit;
+};
+
+void initialize_digest(digest_t *digest);
+
+// user data is the digest
+int32_t digest_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data);
+
+void log_line(
+  zone_parser_t *parser,
+  uint32_t priority,
+  const char *file,
+  size_t line,
+  const char *message,
+  void *user_data);
+
+// entries that make it hard to guess where chunks start and which context
+// applies, i.e. lines inside quoted sections and parentheses that look like
+// records, records that inherit owner, TTL and class and origin changes.
+// include, if not NULL, is included halfway with sub.example.com. as origin
+char *generate_zone(size_t *length, size_t count, const char *include);
+
+// records are hashed individually so that records parsed out of order can
+// be put back in order and compared against the records of a sequential parse
+typedef struct list list_t;
+struct list {
+  size_t count, size;
+  uint64_t *hashes;
+  size_t error_line;
+};
+
+int32_t append(list_t *list, uint64_t digest);
+
+void release_list(list_t *list);
+
+void assert_same_list(const list_t *expected, const list_t *list);
+
+// user data is the list
+int32_t hash_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data);
+
+void log_list_line(
+  zone_parser_t *parser,
+  uint32_t priority,
+  const char *file,
+  size_t line,
+  const char *message,
+  void *user_data);
+
+#define MAXIMUM_CHUNKS (256)
+
+// records are kept per chunk, chunks are put back in order to compare
+// against the records of a sequential parse
+typedef struct result result_t;
+struct result {
+  list_t chunks[MAXIMUM_CHUNKS];
+  // chunks are parsed on one of threads, if not zero
+  size_t threads;
+  /** records in order of delivery, if records are delivered in order */
+  bool ordered;
+  list_t records;
+  size_t last_sequence;
+  bool out_of_order;
+  size_t error_line;
+};
+
+void release_result(result_t *result);
+
+// expected is the result of a sequential parse, i.e. a single chunk
+void assert_same_chunks(const result_t *expected, const result_t *result);
+
+// user data is the chunk, user data of the chunk is the result
+int32_t hash_chunk_rr(
+  zone_parser_t *parser,
+  const zone_name_t *owner,
+  uint16_t type,
+  uint16_t class,
+  uint32_t ttl,
+  uint16_t rdlength,
+  const uint8_t *rdata,
+  void *user_data);
+
+void log_chunk_line(
+  zone_parser_t *parser,
+  uint32_t priority,
+  const char *file,
+  size_t line,
+  const char *message,
+  void *user_data);
+
 #endif // TOOLS_H